@@ -0,0 +1,644 @@
+#ifndef BTREESET_PRIVATE_HPP_INCLUDED
+
+#define BTREESET_PRIVATE_HPP_INCLUDED
+
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+#include <utility>
+
+using namespace std;
+
+template <typename T>
+BTreeSet<T>::BTreeSet() : root_(nullptr) { }
+
+template <typename T>
+template <typename InputIt, typename>
+BTreeSet<T>::BTreeSet(InputIt first, InputIt last) : root_(nullptr) {
+    for (; first != last; ++first) {
+        insert(*first);
+    }
+}
+
+template <typename T>
+BTreeSet<T>::~BTreeSet() {
+    // only delete if tree actually exists
+    if (root_ != nullptr) {
+        deleteHelper(root_);
+    }
+}
+
+template <typename T>
+BTreeSet<T>::Node::Node(bool leaf)
+    : NodeHeader{0, leaf, nullptr, 0} {
+    // keys_ are filled in as the node is used
+}
+
+template <typename T>
+BTreeSet<T>::Internal::Internal() : Node(false), children_{} {
+    // children_ start out null
+}
+
+template <typename T>
+typename BTreeSet<T>::Internal* BTreeSet<T>::internal(Node* node) {
+    return static_cast<Internal*>(node);
+}
+
+template <typename T>
+const typename BTreeSet<T>::Internal*
+BTreeSet<T>::internal(const Node* node) {
+    return static_cast<const Internal*>(node);
+}
+
+template <typename T>
+void BTreeSet<T>::deleteHelper(Node* tree) {
+    if (tree->leaf_) {
+        delete tree;
+    } else {
+        // delete every child before the node that points at them
+        Internal* in = internal(tree);
+        for (size_t i = 0; i <= in->count_; ++i) {
+            deleteHelper(in->children_[i]);
+        }
+        delete in;
+    }
+}
+
+template <typename T>
+size_t BTreeSet<T>::size() const {
+    if (root_ == nullptr) {
+        return 0;
+    }
+    return root_->size_;
+}
+
+template <typename T>
+size_t BTreeSet<T>::keyIndex(const Node* node, const T& val) {
+    return std::lower_bound(node->keys_, node->keys_ + node->count_, val)
+           - node->keys_;
+}
+
+template <typename T>
+size_t BTreeSet<T>::childIndex(const Node* node) {
+    const Internal* parent = internal(node->parent_);
+    size_t i = 0;
+    while (parent->children_[i] != node) {
+        ++i;
+    }
+    return i;
+}
+
+template <typename T>
+void BTreeSet<T>::splitChild(Internal* parent, size_t i) {
+    Node* full = parent->children_[i];
+    Node* sibling = full->leaf_ ? new Node(true) : new Internal();
+
+    // the upper MIN_DEGREE - 1 keys (and their children) move to sibling
+    sibling->count_ = MIN_DEGREE - 1;
+    std::copy(full->keys_ + MIN_DEGREE, full->keys_ + MAX_KEYS,
+              sibling->keys_);
+    sibling->size_ = sibling->count_;
+    if (!full->leaf_) {
+        Internal* from = internal(full);
+        Internal* to = internal(sibling);
+        for (size_t j = 0; j < MIN_DEGREE; ++j) {
+            to->children_[j] = from->children_[j + MIN_DEGREE];
+            to->children_[j]->parent_ = to;
+            to->size_ += to->children_[j]->size_;
+        }
+    }
+    full->count_ = MIN_DEGREE - 1;
+    full->size_ -= sibling->size_ + 1;
+
+    // the median key moves up to sit between full and sibling
+    std::copy_backward(parent->keys_ + i, parent->keys_ + parent->count_,
+                       parent->keys_ + parent->count_ + 1);
+    std::copy_backward(parent->children_ + i + 1,
+                       parent->children_ + parent->count_ + 1,
+                       parent->children_ + parent->count_ + 2);
+    parent->keys_[i] = full->keys_[MIN_DEGREE - 1];
+    parent->children_[i + 1] = sibling;
+    sibling->parent_ = parent;
+    ++parent->count_;
+}
+
+template <typename T>
+pair<typename BTreeSet<T>::iterator, bool> BTreeSet<T>::insert(const T& val) {
+    if (root_ == nullptr) {
+        root_ = new Node(true);
+    } else if (root_->count_ == MAX_KEYS) {
+        // a full root splits under a new root; the tree grows one level
+        Internal* newRoot = new Internal();
+        newRoot->children_[0] = root_;
+        newRoot->size_ = root_->size_;
+        root_->parent_ = newRoot;
+        root_ = newRoot;
+        splitChild(newRoot, 0);
+    }
+    // split full nodes on the way down so a leaf always has room
+    Node* cur = root_;
+    while (true) {
+        size_t i = keyIndex(cur, val);
+        if (i < cur->count_ && !(val < cur->keys_[i])) {  // already present
+            return {Iterator(cur, i, this), false};
+        }
+        if (cur->leaf_) {
+            std::copy_backward(cur->keys_ + i, cur->keys_ + cur->count_,
+                               cur->keys_ + cur->count_ + 1);
+            cur->keys_[i] = val;
+            ++cur->count_;
+            // every node on the path gains one key
+            for (Node* up = cur; up != nullptr; up = up->parent_) {
+                ++up->size_;
+            }
+            return {Iterator(cur, i, this), true};
+        }
+        Internal* in = internal(cur);
+        if (in->children_[i]->count_ == MAX_KEYS) {
+            splitChild(in, i);
+            // the promoted median decides which half to enter
+            if (in->keys_[i] < val) {
+                ++i;
+            } else if (!(val < in->keys_[i])) {
+                return {Iterator(cur, i, this), false};
+            }
+        }
+        cur = in->children_[i];
+    }
+}
+
+template <typename T>
+void BTreeSet<T>::mergeChildren(Internal* parent, size_t i) {
+    Node* left = parent->children_[i];
+    Node* right = parent->children_[i + 1];
+
+    // the separating key comes down between the two halves
+    left->keys_[left->count_] = parent->keys_[i];
+    std::copy(right->keys_, right->keys_ + right->count_,
+              left->keys_ + left->count_ + 1);
+    if (!left->leaf_) {
+        Internal* to = internal(left);
+        Internal* from = internal(right);
+        for (size_t j = 0; j <= right->count_; ++j) {
+            to->children_[left->count_ + 1 + j] = from->children_[j];
+            from->children_[j]->parent_ = to;
+        }
+    }
+    left->count_ += right->count_ + 1;
+    left->size_ += right->size_ + 1;
+
+    std::copy(parent->keys_ + i + 1, parent->keys_ + parent->count_,
+              parent->keys_ + i);
+    std::copy(parent->children_ + i + 2,
+              parent->children_ + parent->count_ + 1,
+              parent->children_ + i + 1);
+    --parent->count_;
+
+    if (right->leaf_) {
+        delete right;
+    } else {
+        delete internal(right);
+    }
+}
+
+template <typename T>
+void BTreeSet<T>::borrowFromLeft(Internal* parent, size_t i) {
+    Node* child = parent->children_[i];
+    Node* sibling = parent->children_[i - 1];
+
+    // parent's key moves down to the front, sibling's last key moves up
+    std::copy_backward(child->keys_, child->keys_ + child->count_,
+                       child->keys_ + child->count_ + 1);
+    child->keys_[0] = parent->keys_[i - 1];
+    parent->keys_[i - 1] = sibling->keys_[sibling->count_ - 1];
+    size_t moved = 1;
+    if (!child->leaf_) {
+        Internal* to = internal(child);
+        Internal* from = internal(sibling);
+        std::copy_backward(to->children_, to->children_ + child->count_ + 1,
+                           to->children_ + child->count_ + 2);
+        to->children_[0] = from->children_[sibling->count_];
+        to->children_[0]->parent_ = to;
+        moved += to->children_[0]->size_;
+    }
+    ++child->count_;
+    --sibling->count_;
+    child->size_ += moved;
+    sibling->size_ -= moved;
+}
+
+template <typename T>
+void BTreeSet<T>::borrowFromRight(Internal* parent, size_t i) {
+    Node* child = parent->children_[i];
+    Node* sibling = parent->children_[i + 1];
+
+    // parent's key moves down to the back, sibling's first key moves up
+    child->keys_[child->count_] = parent->keys_[i];
+    parent->keys_[i] = sibling->keys_[0];
+    std::copy(sibling->keys_ + 1, sibling->keys_ + sibling->count_,
+              sibling->keys_);
+    size_t moved = 1;
+    if (!child->leaf_) {
+        Internal* to = internal(child);
+        Internal* from = internal(sibling);
+        to->children_[child->count_ + 1] = from->children_[0];
+        to->children_[child->count_ + 1]->parent_ = to;
+        moved += from->children_[0]->size_;
+        std::copy(from->children_ + 1, from->children_ + sibling->count_ + 1,
+                  from->children_);
+    }
+    ++child->count_;
+    --sibling->count_;
+    child->size_ += moved;
+    sibling->size_ -= moved;
+}
+
+template <typename T>
+size_t BTreeSet<T>::erase(const T& val) {
+    // knowing the key is there lets each node's size drop on the way down
+    if (!exists(val)) {
+        return 0;
+    }
+    T target = val;
+    Node* cur = root_;
+    // every node entered below the root has a key to spare, so removing
+    // from a leaf or fixing a child never has to walk back up
+    while (true) {
+        --cur->size_;
+        size_t i = keyIndex(cur, target);
+        bool here = i < cur->count_ && !(target < cur->keys_[i]);
+        if (cur->leaf_) {
+            std::copy(cur->keys_ + i + 1, cur->keys_ + cur->count_,
+                      cur->keys_ + i);
+            --cur->count_;
+            break;
+        }
+        Internal* in = internal(cur);
+        if (here) {
+            Node* before = in->children_[i];
+            Node* after = in->children_[i + 1];
+            if (before->count_ >= MIN_DEGREE) {
+                // replace the key with its predecessor, then remove that
+                Node* pred = before;
+                while (!pred->leaf_) {
+                    pred = internal(pred)->children_[pred->count_];
+                }
+                in->keys_[i] = pred->keys_[pred->count_ - 1];
+                target = in->keys_[i];
+                cur = before;
+            } else if (after->count_ >= MIN_DEGREE) {
+                Node* succ = after;
+                while (!succ->leaf_) {
+                    succ = internal(succ)->children_[0];
+                }
+                in->keys_[i] = succ->keys_[0];
+                target = in->keys_[i];
+                cur = after;
+            } else {
+                // both neighbours are minimal; the key sinks into a merge
+                mergeChildren(in, i);
+                cur = before;
+            }
+            continue;
+        }
+        Node* child = in->children_[i];
+        if (child->count_ < MIN_DEGREE) {
+            if (i > 0 && in->children_[i - 1]->count_ >= MIN_DEGREE) {
+                borrowFromLeft(in, i);
+            } else if (i < in->count_ &&
+                       in->children_[i + 1]->count_ >= MIN_DEGREE) {
+                borrowFromRight(in, i);
+            } else if (i < in->count_) {
+                mergeChildren(in, i);
+            } else {
+                mergeChildren(in, i - 1);
+                child = in->children_[i - 1];
+            }
+        }
+        cur = child;
+    }
+
+    // a merge can empty the root; its only child takes over
+    if (root_->count_ == 0) {
+        Node* old = root_;
+        root_ = old->leaf_ ? nullptr : internal(old)->children_[0];
+        if (root_ != nullptr) {
+            root_->parent_ = nullptr;
+        }
+        if (old->leaf_) {
+            delete old;
+        } else {
+            delete internal(old);
+        }
+    }
+    return 1;
+}
+
+template <typename T>
+bool BTreeSet<T>::exists(const T& val) const {
+    const Node* cur = root_;
+    while (cur != nullptr) {
+        size_t i = keyIndex(cur, val);
+        if (i < cur->count_ && !(val < cur->keys_[i])) {
+            return true;
+        }
+        cur = cur->leaf_ ? nullptr : internal(cur)->children_[i];
+    }
+    return false;
+}
+
+template <typename T>
+typename BTreeSet<T>::iterator BTreeSet<T>::select(size_t k) const {
+    Node* cur = root_;
+    // skip whole children using their sizes until k lands on a key
+    while (cur != nullptr) {
+        if (cur->leaf_) {
+            return (k < cur->count_) ? Iterator(cur, k, this) : end();
+        }
+        Internal* in = internal(cur);
+        Node* next = nullptr;
+        for (size_t j = 0; j <= in->count_ && next == nullptr; ++j) {
+            size_t childSize = in->children_[j]->size_;
+            if (k < childSize) {
+                next = in->children_[j];
+            } else if (j < in->count_) {
+                k -= childSize;
+                if (k == 0) {
+                    return Iterator(cur, j, this);
+                }
+                --k;
+            }
+        }
+        cur = next;
+    }
+    return end();
+}
+
+template <typename T>
+size_t BTreeSet<T>::countBelow(const T& val, bool inclusive) const {
+    size_t count = 0;
+    const Node* cur = root_;
+    while (cur != nullptr) {
+        const T* keys = cur->keys_;
+        size_t i = inclusive
+                 ? std::upper_bound(keys, keys + cur->count_, val) - keys
+                 : std::lower_bound(keys, keys + cur->count_, val) - keys;
+        // keys before i and every child to their left are below val
+        count += i;
+        if (cur->leaf_) {
+            break;
+        }
+        const Internal* in = internal(cur);
+        for (size_t j = 0; j < i; ++j) {
+            count += in->children_[j]->size_;
+        }
+        cur = in->children_[i];
+    }
+    return count;
+}
+
+template <typename T>
+size_t BTreeSet<T>::rank(const T& val) const {
+    return countBelow(val, false);
+}
+
+template <typename T>
+size_t BTreeSet<T>::countBetween(const T& lo, const T& hi) const {
+    if (hi < lo) {
+        return 0;
+    }
+    return countBelow(hi, true) - countBelow(lo, false);
+}
+
+template <typename T>
+typename BTreeSet<T>::iterator BTreeSet<T>::lower_bound(const T& val) const {
+    iterator candidate = end();
+    Node* cur = root_;
+    while (cur != nullptr) {
+        size_t i = keyIndex(cur, val);
+        if (i < cur->count_) {  // best so far; a child may hold a smaller one
+            candidate = Iterator(cur, i, this);
+            if (!(val < cur->keys_[i])) {
+                break;
+            }
+        }
+        cur = cur->leaf_ ? nullptr : internal(cur)->children_[i];
+    }
+    return candidate;
+}
+
+template <typename T>
+typename BTreeSet<T>::iterator BTreeSet<T>::upper_bound(const T& val) const {
+    iterator candidate = end();
+    Node* cur = root_;
+    while (cur != nullptr) {
+        size_t i = std::upper_bound(cur->keys_, cur->keys_ + cur->count_, val)
+                   - cur->keys_;
+        if (i < cur->count_) {
+            candidate = Iterator(cur, i, this);
+        }
+        cur = cur->leaf_ ? nullptr : internal(cur)->children_[i];
+    }
+    return candidate;
+}
+
+template <typename T>
+int BTreeSet<T>::height() const {
+    // every leaf is at the same depth, so follow the leftmost path
+    int h = -1;
+    for (const Node* cur = root_; cur != nullptr;
+         cur = cur->leaf_ ? nullptr : internal(cur)->children_[0]) {
+        ++h;
+    }
+    return h;
+}
+
+template <typename T>
+void BTreeSet<T>::statsHelper(const Node* tree, size_t depth, size_t& nodes,
+                              double& totalDepth) const {
+    ++nodes;
+    totalDepth += static_cast<double>(depth) * tree->count_;
+    if (!tree->leaf_) {
+        const Internal* in = internal(tree);
+        for (size_t i = 0; i <= in->count_; ++i) {
+            statsHelper(in->children_[i], depth + 1, nodes, totalDepth);
+        }
+    }
+}
+
+template <typename T>
+double BTreeSet<T>::averageDepth() const {
+    if (root_ == nullptr) {
+        return 0.0;
+    }
+    size_t nodes = 0;
+    double totalDepth = 0;
+    statsHelper(root_, 0, nodes, totalDepth);
+    return totalDepth / static_cast<double>(root_->size_);
+}
+
+template <typename T>
+ostream& BTreeSet<T>::showStatistics(ostream& os) const {
+    size_t nodes = 0;
+    double totalDepth = 0;
+    if (root_ != nullptr) {
+        statsHelper(root_, 0, nodes, totalDepth);
+    }
+    os << size() << " keys, " << nodes << " nodes, height " << height()
+       << ", average depth " << averageDepth() << endl;
+    return os;
+}
+
+template <typename T>
+ostream& BTreeSet<T>::printerHelper(const Node* tree, ostream& os) const {
+    // keys are printed between the children that surround them
+    os << "(";
+    for (size_t i = 0; i < tree->count_; ++i) {
+        if (!tree->leaf_) {
+            printerHelper(internal(tree)->children_[i], os);
+            os << ", ";
+        }
+        os << tree->keys_[i];
+        if (i + 1 < tree->count_ || !tree->leaf_) {
+            os << ", ";
+        }
+    }
+    if (!tree->leaf_) {
+        printerHelper(internal(tree)->children_[tree->count_], os);
+    }
+    os << ")";
+    return os;
+}
+
+template <typename T>
+ostream& BTreeSet<T>::print(ostream& os) const {
+    // print nothing if tree is empty
+    if (root_ == nullptr) {
+        os << "-";
+        return os;
+    }
+    return printerHelper(root_, os);
+}
+
+template <typename T>
+ostream& operator<<(ostream& os, const BTreeSet<T>& t) {
+    return t.print(os);
+}
+
+template <typename T>
+bool BTreeSet<T>::operator==(const BTreeSet<T>& rhs) const {
+    // walk both sets in order side by side, stopping at the first mismatch
+    return size() == rhs.size() && std::equal(begin(), end(), rhs.begin());
+}
+
+template <typename T>
+bool BTreeSet<T>::operator!=(const BTreeSet<T>& rhs) const {
+    return !operator==(rhs);
+}
+
+template <typename T>
+typename BTreeSet<T>::iterator BTreeSet<T>::begin() const {
+    if (root_ == nullptr) {
+        return end();
+    }
+    Node* cur = root_;
+    while (!cur->leaf_) {
+        cur = internal(cur)->children_[0];
+    }
+    return Iterator(cur, 0, this);
+}
+
+template <typename T>
+typename BTreeSet<T>::iterator BTreeSet<T>::end() const {
+    return Iterator(nullptr, 0, this);
+}
+
+template <typename T>
+BTreeSet<T>::Iterator::Iterator(Node* node, size_t index,
+                                const BTreeSet* tree)
+    : node_(node), index_(index), tree_(tree) {
+    // Nothing else to do.
+}
+
+template <typename T>
+typename BTreeSet<T>::Iterator& BTreeSet<T>::Iterator::operator++() {
+    if (!node_->leaf_) {  // successor is leftmost in the next child
+        node_ = internal(node_)->children_[index_ + 1];
+        while (!node_->leaf_) {
+            node_ = internal(node_)->children_[0];
+        }
+        index_ = 0;
+        return *this;
+    }
+    ++index_;
+    // past the last key of a node: climb until a key is to our right
+    while (index_ == node_->count_) {
+        if (node_->parent_ == nullptr) {
+            node_ = nullptr;
+            index_ = 0;
+            break;
+        }
+        index_ = childIndex(node_);
+        node_ = node_->parent_;
+    }
+    return *this;
+}
+
+template <typename T>
+typename BTreeSet<T>::Iterator BTreeSet<T>::Iterator::operator++(int) {
+    Iterator old = *this;
+    ++*this;
+    return old;
+}
+
+template <typename T>
+typename BTreeSet<T>::Iterator& BTreeSet<T>::Iterator::operator--() {
+    if (node_ == nullptr || !node_->leaf_) {
+        // predecessor is rightmost in the child before this key (or in
+        // the whole tree when stepping back from end())
+        node_ = (node_ == nullptr) ? tree_->root_
+                                   : internal(node_)->children_[index_];
+        while (!node_->leaf_) {
+            node_ = internal(node_)->children_[node_->count_];
+        }
+        index_ = node_->count_ - 1;
+        return *this;
+    }
+    // before the first key of a node: climb until a key is to our left
+    while (index_ == 0) {
+        index_ = childIndex(node_);
+        node_ = node_->parent_;
+    }
+    --index_;
+    return *this;
+}
+
+template <typename T>
+typename BTreeSet<T>::Iterator BTreeSet<T>::Iterator::operator--(int) {
+    Iterator old = *this;
+    --*this;
+    return old;
+}
+
+template <typename T>
+const T& BTreeSet<T>::Iterator::operator*() const {
+    return node_->keys_[index_];
+}
+
+template <typename T>
+const T* BTreeSet<T>::Iterator::operator->() const {
+    return &(**this);
+}
+
+template <typename T>
+bool BTreeSet<T>::Iterator::operator==(const Iterator& rhs) const {
+    return (node_ == rhs.node_) && (index_ == rhs.index_);
+}
+
+template <typename T>
+bool BTreeSet<T>::Iterator::operator!=(const Iterator& rhs) const {
+    // Idiomatic code: leverage == to implement !=
+    return !(*this == rhs);
+}
+
+#endif
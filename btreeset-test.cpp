@@ -0,0 +1,246 @@
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+#include <iterator>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Include the testing-logger library from
+// the CS70 system directory in Docker.
+#include <cs70/testinglogger.hpp>
+
+#include "btreeset.hpp"
+
+using namespace std;
+
+///////////////////////////////////////////////////////////
+//  TESTING
+///////////////////////////////////////////////////////////
+
+
+bool insertTest() {
+    TestingLogger log("insert");
+
+    BTreeSet<string> mySet;
+
+    auto first = mySet.insert("Isaac");
+    affirm(first.second);
+    affirm(*first.first == "Isaac");
+    affirm(mySet.size() == 1);
+
+    mySet.insert("Tejus");
+    affirm(mySet.exists("Tejus") == true);
+    affirm(mySet.size() == 2);
+
+    auto again = mySet.insert("Isaac");
+    affirm(!again.second);
+    affirm(*again.first == "Isaac");
+    affirm(mySet.size() == 2);
+
+    return log.summarize();
+}
+
+bool manyInsertTest() {
+    TestingLogger log("many insert");
+
+    // enough keys to split leaves and the root several times
+    BTreeSet<int> mySet;
+    for (int i = 0; i < 20000; ++i) {
+        mySet.insert((i * 7919) % 20000);
+    }
+
+    affirm(mySet.size() == 20000);
+    affirm(mySet.exists(0));
+    affirm(mySet.exists(19999));
+    affirm(!mySet.exists(20000));
+    affirm(mySet.height() <= 3);
+
+    int expected = 0;
+    for (int value : mySet) {
+        affirm(value == expected);
+        ++expected;
+    }
+    affirm(expected == 20000);
+
+    return log.summarize();
+}
+
+bool eraseTest() {
+    TestingLogger log("erase");
+
+    // mirror inserts and erases in std::set; erasing borrows keys from
+    // siblings and merges nodes, so check order and sizes after each round
+    BTreeSet<int> mySet;
+    std::set<int> model;
+    for (int round = 0; round < 20; ++round) {
+        for (int i = 0; i < 2000; ++i) {
+            int key = (round * 7919 + i * 104729) % 5000;
+            if ((i + round) % 3 == 0) {
+                affirm(mySet.erase(key) == model.erase(key));
+            } else {
+                affirm(mySet.insert(key).second == model.insert(key).second);
+            }
+        }
+        affirm(mySet.size() == model.size());
+        affirm(std::equal(model.begin(), model.end(), mySet.begin()));
+        size_t below = std::distance(model.begin(), model.lower_bound(2500));
+        affirm(mySet.rank(2500) == below);
+    }
+
+    // emptying the set shrinks it level by level down to nothing
+    for (int key : vector<int>(model.begin(), model.end())) {
+        affirm(mySet.erase(key) == 1);
+    }
+    affirm(mySet.size() == 0);
+    affirm(mySet.height() == -1);
+    affirm(mySet.begin() == mySet.end());
+    affirm(mySet.erase(1) == 0);
+
+    return log.summarize();
+}
+
+bool iteratorMinusTest() {
+    TestingLogger log("iterator minus");
+
+    BTreeSet<int> mySet;
+    for (int i = 0; i < 500; ++i) {
+        mySet.insert(i);
+    }
+
+    BTreeSet<int>::iterator iter = mySet.end();
+    for (int expected = 499; expected >= 0; --expected) {
+        --iter;
+        affirm(*iter == expected);
+    }
+    affirm(iter == mySet.begin());
+
+    return log.summarize();
+}
+
+bool orderStatisticsTest() {
+    TestingLogger log("order statistics");
+
+    BTreeSet<int> mySet;
+    for (int i = 0; i < 1000; ++i) {
+        mySet.insert((i * 13) % 1000 * 2);  // even numbers 0..1998
+    }
+
+    affirm(*mySet.select(0) == 0);
+    affirm(*mySet.select(500) == 1000);
+    affirm(*mySet.select(999) == 1998);
+    affirm(mySet.select(1000) == mySet.end());
+
+    affirm(mySet.rank(0) == 0);
+    affirm(mySet.rank(1000) == 500);
+    affirm(mySet.rank(1001) == 501);
+    affirm(mySet.rank(5000) == 1000);
+
+    affirm(mySet.countBetween(10, 20) == 6);
+    affirm(mySet.countBetween(20, 10) == 0);
+
+    return log.summarize();
+}
+
+bool boundsTest() {
+    TestingLogger log("bounds");
+
+    BTreeSet<int> mySet;
+    for (int i = 0; i < 300; ++i) {
+        mySet.insert(i * 10);
+    }
+
+    affirm(*mySet.lower_bound(30) == 30);
+    affirm(*mySet.lower_bound(31) == 40);
+    affirm(*mySet.upper_bound(30) == 40);
+    affirm(*mySet.lower_bound(-5) == 0);
+    affirm(mySet.lower_bound(2991) == mySet.end());
+    affirm(mySet.upper_bound(2990) == mySet.end());
+
+    return log.summarize();
+}
+
+bool printTest() {
+    TestingLogger log("print");
+
+    BTreeSet<double> mySet;
+
+    stringstream empty;
+    empty << mySet;
+    affirm(empty.str() == "-");
+
+    mySet.insert(2.1);
+    mySet.insert(1.5);
+
+    stringstream ss;
+    ss << mySet;
+    affirm(ss.str() == "(1.5, 2.1)");
+
+    return log.summarize();
+}
+
+bool treeEqualsTest() {
+    TestingLogger log("tree equals");
+
+    vector<int> forward = {41, 42, 43};
+    vector<int> backward = {43, 42, 41, 42};
+    BTreeSet<int> mySetOne(forward.begin(), forward.end());
+    BTreeSet<int> mySetTwo(backward.begin(), backward.end());
+
+    affirm(mySetOne == mySetTwo);
+
+    mySetOne.insert(44);
+    affirm(mySetOne != mySetTwo);
+
+    return log.summarize();
+}
+
+bool showStatisticsTest() {
+    TestingLogger log("statistics");
+
+    BTreeSet<int> mySet;
+    stringstream ss;
+    mySet.showStatistics(ss);
+    affirm(ss.str() == "0 keys, 0 nodes, height -1, average depth 0\n");
+
+    mySet.insert(1);
+    mySet.insert(2);
+    stringstream one;
+    mySet.showStatistics(one);
+    affirm(one.str() == "2 keys, 1 nodes, height 0, average depth 0\n");
+
+    return log.summarize();
+}
+
+/*
+ * Test the BTreeSet
+ */
+int main(int, char**) {
+    TestingLogger alltests("All tests");
+
+
+    affirm(insertTest());
+
+    affirm(manyInsertTest());
+
+    affirm(eraseTest());
+
+    affirm(iteratorMinusTest());
+
+    affirm(orderStatisticsTest());
+
+    affirm(boundsTest());
+
+    affirm(printTest());
+
+    affirm(treeEqualsTest());
+
+    affirm(showStatisticsTest());
+
+    if (alltests.summarize(true)) {
+        return 0;  // Error code of 0 == Success!
+    } else {
+        return 2;  // Arbitrarily chosen exit code of 2 means tests failed.
+    }
+}
@@ -0,0 +1,313 @@
+#ifndef BTREESET_HPP_INCLUDED
+
+#define BTREESET_HPP_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <iostream>
+#include <utility>
+
+using namespace std;
+
+/**
+* \brief Sorted set stored in a B-tree whose nodes span a few cache lines
+*
+* Each node holds many sorted keys plus the number of keys in its subtree,
+* so lookups touch far fewer nodes than a binary TreeSet and rank queries
+* still run in O(height). T must be default constructible and assignable.
+**/
+template <typename T>
+class BTreeSet {
+ private:
+    // Forward declaration of private class.
+    class Iterator;
+
+ public:
+    // allow users to iterate through the set in sorted order
+    using iterator = Iterator;
+
+    BTreeSet();
+    ~BTreeSet();
+
+    /**
+    * \brief Build a set from a range of elements
+    * \param first, last range to copy; duplicates are dropped
+    **/
+    template <typename InputIt, typename = typename
+              std::iterator_traits<InputIt>::iterator_category>
+    BTreeSet(InputIt first, InputIt last);
+
+    BTreeSet(const BTreeSet& orig) = delete;
+    BTreeSet& operator=(const BTreeSet& rhs) = delete;
+
+    // member functions
+    /**
+    * \brief Calculate size of set
+    * \param None
+    * \returns number of keys
+    **/
+    size_t size() const;
+
+    /**
+    * \brief Insert element into set unless already present
+    * \param T to insert
+    * \returns iterator to the element, and whether it was inserted
+    **/
+    pair<iterator, bool> insert(const T& t);
+
+    /**
+    * \brief Remove element from set if present
+    * \param T to remove
+    * \returns number of elements removed (0 or 1)
+    *
+    * Keys shift within and between nodes, so every iterator into the set
+    * is invalidated.
+    **/
+    size_t erase(const T& t);
+
+    /**
+    * \brief Check whether T exists in set
+    * \param T to check
+    * \returns boolean whether element exists or not
+    **/
+    bool exists(const T& t) const;
+
+    /**
+    * \brief Find the element with k smaller elements (0-based k-th smallest)
+    * \param k position in sorted order
+    * \returns iterator to that element, or end() if k >= size()
+    **/
+    iterator select(size_t k) const;
+
+    /**
+    * \brief Count the elements that are strictly less than T
+    * \param T to rank
+    * \returns number of elements less than T
+    **/
+    size_t rank(const T& t) const;
+
+    /**
+    * \brief Count the elements in the closed range [lo, hi]
+    * \param lo and hi bounds of the range
+    * \returns number of elements e with lo <= e <= hi
+    **/
+    size_t countBetween(const T& lo, const T& hi) const;
+
+    /**
+    * \brief Find the first element that is not less than T
+    * \param T to search for
+    * \returns iterator to that element, or end() if there is none
+    **/
+    iterator lower_bound(const T& t) const;
+
+    /**
+    * \brief Find the first element that is greater than T
+    * \param T to search for
+    * \returns iterator to that element, or end() if there is none
+    **/
+    iterator upper_bound(const T& t) const;
+
+    /**
+    * \brief Calculate height of set, counted in nodes
+    * \param None
+    * \returns height of the B-tree (-1 when empty)
+    **/
+    int height() const;
+
+    /**
+    * \brief Calculate average depth of the node holding each key
+    * \param None
+    * \returns average key depth
+    **/
+    double averageDepth() const;
+
+    /**
+    * \brief Print set with each node's keys between its children
+    * \param os stream to print into
+    * \returns ostream&
+    **/
+    ostream& print(ostream& os) const;
+
+    /**
+    * \brief Calculate and print out statistics for the set
+    * \param os stream to print to
+    * \returns ostream with printed statistics
+    **/
+    ostream& showStatistics(ostream& os) const;
+
+    // An iterator that refers to the smallest element
+    iterator begin() const;
+    // An iterator that refers to just past the largest element
+    iterator end() const;
+
+    // operators
+    bool operator==(const BTreeSet& rhs) const;
+    bool operator!=(const BTreeSet& rhs) const;
+
+ private:
+    struct Node;
+
+    // The fields every node keeps in front of its keys
+    struct NodeHeader {
+        uint32_t count_;  // keys in use
+        bool leaf_;  // whether the node has children
+        Node* parent_;  // node above this one, nullptr at the root
+        size_t size_;  // keys in the subtree rooted here
+    };
+
+    // Keys per node are picked so a full leaf, header included, fills
+    // NODE_LINES cache lines; nodes start on a line boundary, so it
+    // touches no more. A node with MAX_KEYS keys is full and gets split.
+    static constexpr size_t CACHE_LINE = 64;
+    static constexpr size_t NODE_LINES = 4;
+    static constexpr size_t HEADER_BYTES =
+        (sizeof(NodeHeader) + alignof(T) - 1) / alignof(T) * alignof(T);
+    static constexpr size_t KEY_BYTES = NODE_LINES * CACHE_LINE - HEADER_BYTES;
+    static constexpr size_t KEYS_THAT_FIT = KEY_BYTES / sizeof(T);
+    static constexpr size_t MIN_DEGREE =
+        (KEYS_THAT_FIT < 3) ? 2 : (KEYS_THAT_FIT + 1) / 2;
+    static constexpr size_t MAX_KEYS = 2 * MIN_DEGREE - 1;
+
+    struct alignas(CACHE_LINE) Node : NodeHeader {
+        T keys_[MAX_KEYS];  // sorted keys
+
+        explicit Node(bool leaf);
+        Node(const Node&) = delete;
+        Node& operator=(const Node&) = delete;
+        ~Node() = default;
+    };
+
+    // only keys too large for three to a node can spill past NODE_LINES
+    static_assert(KEYS_THAT_FIT < 3 ||
+                  sizeof(Node) <= NODE_LINES * CACHE_LINE,
+                  "a full leaf should fit in NODE_LINES cache lines");
+
+    // Leaves skip the child array, which is most of an internal node
+    struct Internal : Node {
+        Node* children_[MAX_KEYS + 1];  // children between and around keys
+
+        Internal();
+    };
+
+    Node* root_;  // root node of the B-tree
+
+    /**
+    * \brief View a node as an internal node
+    * \param node that is not a leaf
+    * \returns the same node with its children visible
+    **/
+    static Internal* internal(Node* node);
+    static const Internal* internal(const Node* node);
+
+    /**
+    * \brief Find the first key in a node that is not less than T
+    * \param node to search, T to search for
+    * \returns index of that key, or count_ if all keys are less
+    **/
+    static size_t keyIndex(const Node* node, const T& t);
+
+    /**
+    * \brief Find where a node sits among its parent's children
+    * \param node with a parent
+    * \returns index in parent's children_
+    **/
+    static size_t childIndex(const Node* node);
+
+    /**
+    * \brief Split the full i-th child of a node into two half-full nodes
+    * \param parent (not full) and index of its full child
+    * \returns void
+    **/
+    void splitChild(Internal* parent, size_t i);
+
+    /**
+    * \brief Merge the i-th child of a node, the key after it, and the
+    *        next child into the i-th child
+    * \param parent and index of the left child; both children hold
+    *        MIN_DEGREE - 1 keys
+    * \returns void
+    **/
+    void mergeChildren(Internal* parent, size_t i);
+
+    /**
+    * \brief Rotate a key into the i-th child from its left sibling
+    * \param parent and index of the child; the sibling has a key to spare
+    * \returns void
+    **/
+    void borrowFromLeft(Internal* parent, size_t i);
+
+    /**
+    * \brief Rotate a key into the i-th child from its right sibling
+    * \param parent and index of the child; the sibling has a key to spare
+    * \returns void
+    **/
+    void borrowFromRight(Internal* parent, size_t i);
+
+    /**
+    * \brief Count keys below T using subtree sizes
+    * \param T to compare with, whether keys equal to T also count
+    * \returns number of keys < T (or <= T if inclusive)
+    **/
+    size_t countBelow(const T& t, bool inclusive) const;
+
+    /**
+    * \brief Delete a subtree
+    * \param root of the subtree
+    * \returns void
+    **/
+    void deleteHelper(Node* tree);
+
+    /**
+    * \brief Print a subtree
+    * \param root of the subtree, os stream to print into
+    * \returns ostream&
+    **/
+    ostream& printerHelper(const Node* tree, ostream& os) const;
+
+    /**
+    * \brief Add up node count and key depths of a subtree
+    * \param root of the subtree, its depth, running totals
+    * \returns void
+    **/
+    void statsHelper(const Node* tree, size_t depth, size_t& nodes,
+                     double& totalDepth) const;
+
+    class Iterator {
+     public:
+        using value_type = T;
+        using reference = const value_type&;
+        using pointer = const value_type*;
+        using difference_type = std::ptrdiff_t;
+        using iterator_category = std::bidirectional_iterator_tag;
+
+        Iterator() = default;
+        Iterator(const Iterator&) = default;
+        Iterator& operator=(const Iterator&) = default;
+        ~Iterator() = default;
+
+        Iterator& operator++();
+        Iterator operator++(int);
+        Iterator& operator--();
+        Iterator operator--(int);
+        reference operator*() const;
+        pointer operator->() const;
+        bool operator==(const Iterator& rhs) const;
+        bool operator!=(const Iterator& rhs) const;
+
+     private:
+        friend class BTreeSet;
+        Iterator(Node* node, size_t index, const BTreeSet* tree);
+        // Friends create non-default iterators
+        Node* node_;  // node holding the current key, nullptr at end()
+        size_t index_;  // position of the current key within node_
+        const BTreeSet* tree_;  // set we walk, so --end() can find the max
+    };
+};
+
+template <typename T>
+std::ostream& operator<<(std::ostream& os, const BTreeSet<T>& c);
+
+#endif  // BTREESET_HPP_INCLUDED
+
+#include "btreeset-private.hpp"
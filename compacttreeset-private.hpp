@@ -0,0 +1,1816 @@
+#ifndef COMPACTTREESET_PRIVATE_HPP_INCLUDED
+
+#define COMPACTTREESET_PRIVATE_HPP_INCLUDED
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+template <typename T, typename Compare>
+CompactTreeSet<T, Compare>::CompactTreeSet()
+    : root_(NIL), type_(treetype::LEAF), randomState_(0), comp_() { }
+
+template <typename T, typename Compare>
+CompactTreeSet<T, Compare>::CompactTreeSet(treetype t)
+    : root_(NIL), type_(t), randomState_(0), comp_() { }
+
+template <typename T, typename Compare>
+CompactTreeSet<T, Compare>::CompactTreeSet(treetype t, size_t s)
+    : root_(NIL), type_(t), randomState_(s), comp_() { }
+
+template <typename T, typename Compare>
+CompactTreeSet<T, Compare>::CompactTreeSet(treetype t, size_t s,
+                                           const Compare& comp)
+    : root_(NIL), type_(t), randomState_(s), comp_(comp) { }
+
+template <typename T, typename Compare>
+template <typename InputIt, typename>
+CompactTreeSet<T, Compare>::CompactTreeSet(InputIt first, InputIt last,
+                                           treetype t, size_t s,
+                                           const Compare& comp)
+    : root_(NIL), type_(t), randomState_(s), comp_(comp) {
+    assign(first, last);
+}
+
+template <typename T, typename Compare>
+template <typename... Args>
+CompactTreeSet<T, Compare>::Node::Node(std::in_place_t, Args&&... args)
+    : value_(std::forward<Args>(args)...), left_(NIL), right_(NIL),
+      size_(1) {
+    // nothing else to do
+}
+
+template <typename T, typename Compare>
+uint32_t CompactTreeSet<T, Compare>::nextBits() {
+    randomState_ += 0x9E3779B97F4A7C15ULL;
+    uint64_t z = randomState_;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return static_cast<uint32_t>((z ^ (z >> 31)) >> 32);
+}
+
+template <typename T, typename Compare>
+uint32_t CompactTreeSet<T, Compare>::nextRandom(uint32_t bound) {
+    // scale 32 random bits into [0, bound) without a division
+    return static_cast<uint32_t>((uint64_t(nextBits()) * bound) >> 32);
+}
+
+template <typename T, typename Compare>
+uint32_t CompactTreeSet<T, Compare>::sizeOf(uint32_t tree) const {
+    return (tree == NIL) ? 0 : nodes_[tree].size_;
+}
+
+template <typename T, typename Compare>
+void CompactTreeSet<T, Compare>::setSize(uint32_t node) const {
+    Node& cur = nodes_[node];
+    cur.size_ = 1 + sizeOf(cur.left_) + sizeOf(cur.right_);
+}
+
+template <typename T, typename Compare>
+void CompactTreeSet<T, Compare>::checkRoom() const {
+    if (nodes_.size() >= NIL) {
+        throw std::length_error("CompactTreeSet holds 2^32 - 1 elements");
+    }
+}
+
+template <typename T, typename Compare>
+bool CompactTreeSet<T, Compare>::splays() const {
+    return type_ == treetype::SPLAY || type_ == treetype::SEMI_SPLAY;
+}
+
+template <typename T, typename Compare>
+size_t CompactTreeSet<T, Compare>::size() const {
+    return nodes_.size();
+}
+
+template <typename T, typename Compare>
+uint32_t& CompactTreeSet<T, Compare>::linkAt(const vector<uint32_t>& path,
+                                             size_t i, uint32_t& top) const {
+    if (i == 0) {
+        return top;
+    }
+    Node& parent = nodes_[path[i - 1]];
+    return (parent.left_ == path[i]) ? parent.left_ : parent.right_;
+}
+
+template <typename T, typename Compare>
+uint32_t& CompactTreeSet<T, Compare>::linkTo(uint32_t node) {
+    // one comparison a level is enough: we stop on the index, not on an
+    // equal value
+    const T& val = nodes_[node].value_;
+    uint32_t* link = &root_;
+    while (*link != node) {
+        Node& cur = nodes_[*link];
+        link = comp_(val, cur.value_) ? &cur.left_ : &cur.right_;
+    }
+    return *link;
+}
+
+template <typename T, typename Compare>
+void CompactTreeSet<T, Compare>::rotate(uint32_t& link, bool leftUp) const {
+    uint32_t down = link;
+    Node& node = nodes_[down];
+    uint32_t up = leftUp ? node.left_ : node.right_;
+    Node& child = nodes_[up];
+    if (leftUp) {
+        node.left_ = child.right_;
+        child.right_ = down;
+    } else {
+        node.right_ = child.left_;
+        child.left_ = down;
+    }
+    setSize(down);
+    setSize(up);
+    link = up;
+}
+
+template <typename T, typename Compare>
+void CompactTreeSet<T, Compare>::rotateOnPath(vector<uint32_t>& path,
+                                              size_t i, bool leftUp,
+                                              uint32_t& top) const {
+    uint32_t down = path[i];
+    uint32_t up = leftUp ? nodes_[down].left_ : nodes_[down].right_;
+    uint32_t inner = leftUp ? nodes_[up].right_ : nodes_[up].left_;
+    bool upOnPath = i + 1 < path.size() && path[i + 1] == up;
+    bool innerOnPath = i + 2 < path.size() && path[i + 2] == inner;
+    rotate(linkAt(path, i, top), leftUp);
+    if (!upOnPath) {
+        path.insert(path.begin() + i, up);
+    } else if (innerOnPath) {
+        std::swap(path[i], path[i + 1]);
+    } else {
+        path.erase(path.begin() + i);
+    }
+}
+
+template <typename T, typename Compare>
+void CompactTreeSet<T, Compare>::splay(vector<uint32_t>& path) const {
+    if (!splays() || path.empty()) {
+        return;
+    }
+    // the node being moved up sits at path[k]; each step lifts it two
+    // levels (or, semi-splaying a straight line, moves on to its parent)
+    size_t k = path.size() - 1;
+    while (k > 0) {
+        bool nodeLeft = nodes_[path[k - 1]].left_ == path[k];
+        if (k == 1) {  // zig: the parent is the root
+            rotateOnPath(path, 0, nodeLeft, root_);
+            break;
+        }
+        bool parentLeft = nodes_[path[k - 2]].left_ == path[k - 1];
+        if (nodeLeft == parentLeft) {  // zig-zig: the parent goes first
+            rotateOnPath(path, k - 2, parentLeft, root_);
+            if (type_ == treetype::SPLAY) {
+                rotateOnPath(path, k - 2, nodeLeft, root_);
+            }
+        } else {  // zig-zag: the node goes up twice
+            rotateOnPath(path, k - 1, nodeLeft, root_);
+            rotateOnPath(path, k - 2, parentLeft, root_);
+        }
+        k -= 2;
+    }
+}
+
+template <typename T, typename Compare>
+void CompactTreeSet<T, Compare>::rebalanceAt(vector<uint32_t>& path,
+                                             size_t i, uint32_t& top) {
+    uint32_t cur = path[i];
+    setSize(cur);
+    const Node& node = nodes_[cur];
+    size_t leftWeight = size_t(sizeOf(node.left_)) + 1;
+    size_t rightWeight = size_t(sizeOf(node.right_)) + 1;
+    if (rightWeight > WEIGHT_DELTA * leftWeight) {
+        uint32_t child = node.right_;
+        const Node& heavy = nodes_[child];
+        // an inner grandchild that outweighs the outer one comes up first
+        if (size_t(sizeOf(heavy.left_)) + 1 >=
+            WEIGHT_GAMMA * (size_t(sizeOf(heavy.right_)) + 1)) {
+            if (i + 1 < path.size() && path[i + 1] == child) {
+                rotateOnPath(path, i + 1, true, top);
+            } else {
+                rotate(nodes_[cur].right_, true);
+            }
+        }
+        rotateOnPath(path, i, false, top);
+    } else if (leftWeight > WEIGHT_DELTA * rightWeight) {
+        uint32_t child = node.left_;
+        const Node& heavy = nodes_[child];
+        if (size_t(sizeOf(heavy.right_)) + 1 >=
+            WEIGHT_GAMMA * (size_t(sizeOf(heavy.left_)) + 1)) {
+            if (i + 1 < path.size() && path[i + 1] == child) {
+                rotateOnPath(path, i + 1, false, top);
+            } else {
+                rotate(nodes_[cur].left_, false);
+            }
+        }
+        rotateOnPath(path, i, true, top);
+    }
+}
+
+template <typename T, typename Compare>
+void CompactTreeSet<T, Compare>::rebalancePath(vector<uint32_t>& path,
+                                               uint32_t& top) {
+    // a rotation leaves the new subtree root at the same index, so the
+    // indices above it are unaffected
+    for (size_t i = path.size(); i > 0; --i) {
+        rebalanceAt(path, i - 1, top);
+    }
+}
+
+template <typename T, typename Compare>
+template <typename K>
+bool CompactTreeSet<T, Compare>::descend(const K& key,
+                                         vector<uint32_t>& path,
+                                         uint32_t cur,
+                                         bool& lastRight) const {
+    size_t match = 0;  // path length down to the last node we went left at
+    while (cur != NIL) {
+        path.push_back(cur);
+        const Node& node = nodes_[cur];
+        lastRight = comp_(node.value_, key);
+        if (lastRight) {
+            cur = node.right_;
+        } else {
+            match = path.size();
+            cur = node.left_;
+        }
+    }
+    // only the last node we went left at can be equal to key
+    if (match != 0 && !comp_(key, nodes_[path[match - 1]].value_)) {
+        path.resize(match);
+        return true;
+    }
+    return false;
+}
+
+template <typename T, typename Compare>
+template <typename Make>
+pair<typename CompactTreeSet<T, Compare>::iterator, bool>
+CompactTreeSet<T, Compare>::insertAt(Iterator& found, bool lastRight,
+                                     Make& make) {
+    vector<uint32_t>& path = found.path_;
+    // pick the depth where the new node goes: below the whole path for
+    // LEAF, WEIGHT_BALANCED and the splay types, which fix things up after
+    size_t depth = path.size();
+    uint32_t priority = 0;
+    if (type_ == treetype::ROOT) {
+        depth = 0;
+    } else if (type_ == treetype::RANDOMIZED) {
+        // each subtree on the path gets the new node as its root with
+        // chance 1/(size + 1), as if the elements had arrived in random
+        // order
+        depth = 0;
+        while (depth < path.size() &&
+               nextRandom(nodes_[path[depth]].size_ + 1) != 0) {
+            ++depth;
+        }
+    } else if (type_ == treetype::TREAP) {
+        // above the first node with a lower priority, as rotating it up
+        // from a leaf would leave it
+        priority = nextBits();
+        depth = 0;
+        while (depth < path.size() && priorities_[path[depth]] >= priority) {
+            ++depth;
+        }
+        priorities_.push_back(priority);
+    }
+    uint32_t fresh;
+    try {
+        fresh = make();
+    } catch (...) {
+        if (type_ == treetype::TREAP) {
+            priorities_.pop_back();
+        }
+        throw;
+    }
+
+    if (depth == 0) {
+        splitPath(path, depth, lastRight, fresh);
+        root_ = fresh;
+    } else {
+        Node& parent = nodes_[path[depth - 1]];
+        bool right = (depth < path.size()) ? parent.right_ == path[depth]
+                                           : lastRight;
+        splitPath(path, depth, lastRight, fresh);
+        (right ? parent.right_ : parent.left_) = fresh;
+    }
+    for (size_t i = 0; i < depth; ++i) {
+        ++nodes_[path[i]].size_;
+    }
+    path.resize(depth);
+    path.push_back(fresh);
+
+    if (type_ == treetype::WEIGHT_BALANCED) {
+        rebalancePath(path, root_);
+    } else {
+        splay(path);
+    }
+    return {found, true};
+}
+
+template <typename T, typename Compare>
+void CompactTreeSet<T, Compare>::splitPath(const vector<uint32_t>& path,
+                                           size_t from, bool lastRight,
+                                           uint32_t fresh) {
+    // nodes below T hang off each other's right links, nodes above T off
+    // each other's left links, in the order the search met them
+    uint32_t* less = &nodes_[fresh].left_;
+    uint32_t* greater = &nodes_[fresh].right_;
+    for (size_t i = from; i < path.size(); ++i) {
+        Node& node = nodes_[path[i]];
+        bool right = (i + 1 < path.size()) ? node.right_ == path[i + 1]
+                                           : lastRight;
+        if (right) {
+            *less = path[i];
+            less = &node.right_;
+        } else {
+            *greater = path[i];
+            greater = &node.left_;
+        }
+    }
+    *less = NIL;
+    *greater = NIL;
+    // each node's new children are below it on the path, so fix sizes
+    // from the bottom up
+    for (size_t i = path.size(); i > from; --i) {
+        setSize(path[i - 1]);
+    }
+    setSize(fresh);
+}
+
+template <typename T, typename Compare>
+pair<typename CompactTreeSet<T, Compare>::iterator, bool>
+CompactTreeSet<T, Compare>::insert(const T& val) {
+    // one search from the root, recorded in the iterator we hand back
+    Iterator found(this);
+    bool lastRight = false;  // which side of the last node T belongs on
+    if (descend(val, found.path_, root_, lastRight)) {
+        splay(found.path_);
+        return {found, false};
+    }
+    checkRoom();
+    auto make = [&]() {
+        nodes_.emplace_back(std::in_place, val);
+        return static_cast<uint32_t>(nodes_.size() - 1);
+    };
+    return insertAt(found, lastRight, make);
+}
+
+template <typename T, typename Compare>
+pair<typename CompactTreeSet<T, Compare>::iterator, bool>
+CompactTreeSet<T, Compare>::insert(T&& val) {
+    Iterator found(this);
+    bool lastRight = false;
+    if (descend(val, found.path_, root_, lastRight)) {
+        splay(found.path_);
+        return {found, false};
+    }
+    checkRoom();
+    auto make = [&]() {
+        nodes_.emplace_back(std::in_place, std::move(val));
+        return static_cast<uint32_t>(nodes_.size() - 1);
+    };
+    return insertAt(found, lastRight, make);
+}
+
+template <typename T, typename Compare>
+pair<typename CompactTreeSet<T, Compare>::iterator, bool>
+CompactTreeSet<T, Compare>::insert(node_type&& handle) {
+    if (handle.empty()) {
+        return {end(), false};
+    }
+    pair<iterator, bool> result = insert(std::move(handle.value()));
+    if (result.second) {
+        handle = node_type();
+    }
+    return result;
+}
+
+template <typename T, typename Compare>
+typename CompactTreeSet<T, Compare>::iterator
+CompactTreeSet<T, Compare>::insert(iterator hint, const T& val) {
+    if (root_ == NIL) {
+        return insert(val).first;
+    }
+    Iterator found = hint;
+    vector<uint32_t>& path = found.path_;
+    if (path.empty()) {  // the largest element stands in for end()
+        found.pushRight(root_);
+    }
+    const T& near = nodes_[path.back()].value_;
+    bool right = comp_(near, val);
+    if (!right && !comp_(val, near)) {
+        splay(path);
+        return found;
+    }
+    // climb past the ancestors T lies beyond, stopping at the first one it
+    // does not; T belongs below the last one passed (or the hint)
+    size_t start = path.size() - 1;
+    for (size_t i = path.size() - 1; i > 0; --i) {
+        const Node& up = nodes_[path[i - 1]];
+        if ((up.left_ == path[i]) != right) {
+            continue;  // on the near side of the hint, so T is beyond it
+        }
+        if (right ? comp_(val, up.value_) : comp_(up.value_, val)) {
+            break;
+        } else if (right ? !comp_(up.value_, val) : !comp_(val, up.value_)) {
+            path.resize(i);
+            splay(path);
+            return found;
+        }
+        start = i - 1;
+    }
+    path.resize(start + 1);
+    const Node& top = nodes_[path.back()];
+    bool lastRight = right;
+    if (descend(val, path, right ? top.right_ : top.left_, lastRight)) {
+        splay(path);
+        return found;
+    }
+    checkRoom();
+    auto make = [&]() {
+        nodes_.emplace_back(std::in_place, val);
+        return static_cast<uint32_t>(nodes_.size() - 1);
+    };
+    return insertAt(found, lastRight, make).first;
+}
+
+template <typename T, typename Compare>
+template <typename InputIt>
+void CompactTreeSet<T, Compare>::appendSorted(InputIt first, InputIt last) {
+    iterator hint = end();
+    for (; first != last; ++first) {
+        hint = insert(hint, *first);
+    }
+}
+
+template <typename T, typename Compare>
+template <typename... Args>
+pair<typename CompactTreeSet<T, Compare>::iterator, bool>
+CompactTreeSet<T, Compare>::emplace(Args&&... args) {
+    checkRoom();
+    nodes_.emplace_back(std::in_place, std::forward<Args>(args)...);
+    uint32_t fresh = static_cast<uint32_t>(nodes_.size() - 1);
+    Iterator found(this);
+    bool lastRight = false;
+    if (descend(nodes_[fresh].value_, found.path_, root_, lastRight)) {
+        nodes_.pop_back();
+        splay(found.path_);
+        return {found, false};
+    }
+    auto make = [fresh]() { return fresh; };
+    return insertAt(found, lastRight, make);
+}
+
+template <typename T, typename Compare>
+uint32_t CompactTreeSet<T, Compare>::detachMin(uint32_t& tree) {
+    vector<uint32_t> spine;  // from tree down to the minimum's parent
+    uint32_t* link = &tree;
+    while (nodes_[*link].left_ != NIL) {
+        spine.push_back(*link);
+        --nodes_[*link].size_;
+        link = &nodes_[*link].left_;
+    }
+    uint32_t min = *link;
+    *link = nodes_[min].right_;
+    nodes_[min].right_ = NIL;
+    nodes_[min].size_ = 1;
+    if (type_ == treetype::WEIGHT_BALANCED) {
+        rebalancePath(spine, tree);
+    }
+    return min;
+}
+
+template <typename T, typename Compare>
+uint32_t CompactTreeSet<T, Compare>::joinRandom(uint32_t left,
+                                                uint32_t right) {
+    uint32_t result = NIL;
+    uint32_t* link = &result;
+    // zip down the inner spines; whichever root is picked takes the whole
+    // of the other tree into its inner subtree
+    while (left != NIL && right != NIL) {
+        uint32_t leftSize = nodes_[left].size_;
+        uint32_t rightSize = nodes_[right].size_;
+        if (nextRandom(leftSize + rightSize) < leftSize) {
+            nodes_[left].size_ += rightSize;
+            *link = left;
+            link = &nodes_[left].right_;
+            left = *link;
+        } else {
+            nodes_[right].size_ += leftSize;
+            *link = right;
+            link = &nodes_[right].left_;
+            right = *link;
+        }
+    }
+    *link = (left == NIL) ? right : left;
+    return result;
+}
+
+template <typename T, typename Compare>
+uint32_t CompactTreeSet<T, Compare>::joinByPriority(uint32_t left,
+                                                    uint32_t right) {
+    uint32_t result = NIL;
+    uint32_t* link = &result;
+    // the same zip as joinRandom, led by priorities instead of coin flips
+    while (left != NIL && right != NIL) {
+        uint32_t leftSize = nodes_[left].size_;
+        uint32_t rightSize = nodes_[right].size_;
+        if (priorities_[left] >= priorities_[right]) {
+            nodes_[left].size_ += rightSize;
+            *link = left;
+            link = &nodes_[left].right_;
+            left = *link;
+        } else {
+            nodes_[right].size_ += leftSize;
+            *link = right;
+            link = &nodes_[right].left_;
+            right = *link;
+        }
+    }
+    *link = (left == NIL) ? right : left;
+    return result;
+}
+
+template <typename T, typename Compare>
+uint32_t CompactTreeSet<T, Compare>::joinByWeight(uint32_t left,
+                                                  uint32_t mid,
+                                                  uint32_t right) {
+    size_t leftWeight = size_t(sizeOf(left)) + 1;
+    size_t rightWeight = size_t(sizeOf(right)) + 1;
+    // mid goes down the heavier tree's inner spine until the lighter tree
+    // balances the subtree there; only that spine needs fixing afterwards
+    vector<uint32_t> spine;
+    uint32_t tree = NIL;
+    if (leftWeight > WEIGHT_DELTA * rightWeight) {
+        tree = left;
+        for (uint32_t cur = left;
+             size_t(sizeOf(cur)) + 1 > WEIGHT_DELTA * rightWeight;
+             cur = nodes_[cur].right_) {
+            spine.push_back(cur);
+        }
+        left = nodes_[spine.back()].right_;
+        nodes_[spine.back()].right_ = mid;
+    } else if (rightWeight > WEIGHT_DELTA * leftWeight) {
+        tree = right;
+        for (uint32_t cur = right;
+             size_t(sizeOf(cur)) + 1 > WEIGHT_DELTA * leftWeight;
+             cur = nodes_[cur].left_) {
+            spine.push_back(cur);
+        }
+        right = nodes_[spine.back()].left_;
+        nodes_[spine.back()].left_ = mid;
+    }
+    nodes_[mid].left_ = left;
+    nodes_[mid].right_ = right;
+    setSize(mid);
+    if (tree == NIL) {
+        return mid;
+    }
+    rebalancePath(spine, tree);
+    return tree;
+}
+
+template <typename T, typename Compare>
+uint32_t CompactTreeSet<T, Compare>::joinSubtrees(uint32_t left,
+                                                  uint32_t right) {
+    if (type_ == treetype::RANDOMIZED) {
+        return joinRandom(left, right);
+    } else if (type_ == treetype::TREAP) {
+        return joinByPriority(left, right);
+    }
+    if (left == NIL) {
+        return right;
+    } else if (right == NIL) {
+        return left;
+    }
+    uint32_t min = detachMin(right);
+    if (type_ == treetype::WEIGHT_BALANCED) {
+        return joinByWeight(left, min, right);
+    }
+    // the successor takes over both subtrees
+    nodes_[min].left_ = left;
+    nodes_[min].right_ = right;
+    setSize(min);
+    return min;
+}
+
+template <typename T, typename Compare>
+uint32_t CompactTreeSet<T, Compare>::joinWithRoot(uint32_t left,
+                                                  uint32_t mid,
+                                                  uint32_t right) {
+    if (type_ == treetype::WEIGHT_BALANCED) {
+        return joinByWeight(left, mid, right);
+    }
+    nodes_[mid].left_ = NIL;
+    nodes_[mid].right_ = NIL;
+    nodes_[mid].size_ = 1;
+    if (type_ == treetype::RANDOMIZED || type_ == treetype::TREAP) {
+        // mid must not land on top regardless of its priority or odds
+        return joinSubtrees(joinSubtrees(left, mid), right);
+    }
+    nodes_[mid].left_ = left;
+    nodes_[mid].right_ = right;
+    setSize(mid);
+    return mid;
+}
+
+template <typename T, typename Compare>
+uint32_t CompactTreeSet<T, Compare>::splitHelper(uint32_t tree,
+                                                 const T& key,
+                                                 uint32_t& less,
+                                                 uint32_t& greater) {
+    if (type_ == treetype::WEIGHT_BALANCED) {
+        return splitByWeight(tree, key, less, greater);
+    }
+    // the descent insertAt makes for ROOT, relinking the two sides
+    uint32_t* lessLink = &less;
+    uint32_t* greaterLink = &greater;
+    vector<uint32_t> relinked;
+    uint32_t match = NIL;
+    while (tree != NIL) {
+        Node& node = nodes_[tree];
+        if (comp_(node.value_, key)) {
+            *lessLink = tree;
+            lessLink = &node.right_;
+            relinked.push_back(tree);
+            tree = node.right_;
+        } else if (comp_(key, node.value_)) {
+            *greaterLink = tree;
+            greaterLink = &node.left_;
+            relinked.push_back(tree);
+            tree = node.left_;
+        } else {
+            match = tree;
+            break;
+        }
+    }
+    *lessLink = (match == NIL) ? NIL : nodes_[match].left_;
+    *greaterLink = (match == NIL) ? NIL : nodes_[match].right_;
+    if (match != NIL) {
+        nodes_[match].left_ = NIL;
+        nodes_[match].right_ = NIL;
+        nodes_[match].size_ = 1;
+    }
+    // each node's new children are below it on the descent
+    for (size_t i = relinked.size(); i > 0; --i) {
+        setSize(relinked[i - 1]);
+    }
+    return match;
+}
+
+template <typename T, typename Compare>
+uint32_t CompactTreeSet<T, Compare>::splitByWeight(uint32_t tree,
+                                                   const T& key,
+                                                   uint32_t& less,
+                                                   uint32_t& greater) {
+    vector<pair<uint32_t, bool>> path;  // nodes met, and whether below key
+    uint32_t match = NIL;
+    while (tree != NIL) {
+        const Node& node = nodes_[tree];
+        if (comp_(node.value_, key)) {
+            path.push_back({tree, true});
+            tree = node.right_;
+        } else if (comp_(key, node.value_)) {
+            path.push_back({tree, false});
+            tree = node.left_;
+        } else {
+            match = tree;
+            break;
+        }
+    }
+    less = (match == NIL) ? NIL : nodes_[match].left_;
+    greater = (match == NIL) ? NIL : nodes_[match].right_;
+    if (match != NIL) {
+        nodes_[match].left_ = NIL;
+        nodes_[match].right_ = NIL;
+        nodes_[match].size_ = 1;
+    }
+    // from the bottom up, join each node with its subtree on the far side
+    for (size_t i = path.size(); i > 0; --i) {
+        uint32_t node = path[i - 1].first;
+        if (path[i - 1].second) {
+            less = joinByWeight(nodes_[node].left_, node, less);
+        } else {
+            greater = joinByWeight(greater, node, nodes_[node].right_);
+        }
+    }
+    return match;
+}
+
+template <typename T, typename Compare>
+void CompactTreeSet<T, Compare>::detachAt(vector<uint32_t>& path) {
+    size_t last = path.size() - 1;
+    uint32_t doomed = path[last];
+    for (size_t i = 0; i < last; ++i) {
+        --nodes_[path[i]].size_;
+    }
+    uint32_t replacement = joinSubtrees(nodes_[doomed].left_,
+                                        nodes_[doomed].right_);
+    linkAt(path, last, root_) = replacement;
+    path.pop_back();
+    if (type_ == treetype::WEIGHT_BALANCED) {
+        rebalancePath(path, root_);
+    } else {
+        splay(path);
+    }
+}
+
+template <typename T, typename Compare>
+void CompactTreeSet<T, Compare>::moveSlot(uint32_t from, uint32_t to) {
+    nodes_[to] = std::move(nodes_[from]);
+    if (type_ == treetype::TREAP) {
+        priorities_[to] = priorities_[from];
+    }
+}
+
+template <typename T, typename Compare>
+void CompactTreeSet<T, Compare>::removeSlots(vector<uint32_t>& holes) {
+    if (holes.empty()) {
+        return;
+    }
+    size_t levels = 0;
+    for (size_t n = nodes_.size(); n != 0; n >>= 1) {
+        ++levels;
+    }
+    if (holes.size() * levels < nodes_.size()) {
+        // fill the lowest hole from the end of the vector, unless the end
+        // is itself a hole
+        std::sort(holes.begin(), holes.end());
+        size_t first = 0;
+        size_t last = holes.size();
+        while (first < last) {
+            uint32_t end = static_cast<uint32_t>(nodes_.size() - 1);
+            if (holes[last - 1] == end) {
+                --last;
+            } else {
+                uint32_t hole = holes[first++];
+                linkTo(end) = hole;
+                moveSlot(end, hole);
+            }
+            nodes_.pop_back();
+            if (type_ == treetype::TREAP) {
+                priorities_.pop_back();
+            }
+        }
+        return;
+    }
+    // slide every live node down over the holes, then renumber the links
+    vector<uint32_t> renumbered(nodes_.size(), 0);
+    for (uint32_t hole : holes) {
+        renumbered[hole] = NIL;
+    }
+    uint32_t next = 0;
+    for (uint32_t i = 0; i < nodes_.size(); ++i) {
+        if (renumbered[i] == NIL) {
+            continue;
+        }
+        renumbered[i] = next;
+        if (next != i) {
+            moveSlot(i, next);
+        }
+        ++next;
+    }
+    nodes_.erase(nodes_.begin() + next, nodes_.end());
+    if (type_ == treetype::TREAP) {
+        priorities_.resize(next);
+    }
+    for (Node& node : nodes_) {
+        node.left_ = (node.left_ == NIL) ? NIL : renumbered[node.left_];
+        node.right_ = (node.right_ == NIL) ? NIL : renumbered[node.right_];
+    }
+    root_ = (root_ == NIL) ? NIL : renumbered[root_];
+}
+
+template <typename T, typename Compare>
+size_t CompactTreeSet<T, Compare>::erase(const T& val) {
+    Iterator found(this);
+    bool lastRight = false;
+    if (!descend(val, found.path_, root_, lastRight)) {
+        splay(found.path_);
+        return 0;
+    }
+    vector<uint32_t> holes = {found.path_.back()};
+    detachAt(found.path_);
+    removeSlots(holes);
+    return 1;
+}
+
+template <typename T, typename Compare>
+typename CompactTreeSet<T, Compare>::iterator
+CompactTreeSet<T, Compare>::erase(iterator pos) {
+    Iterator next = pos;
+    ++next;
+    uint32_t after = next.path_.empty() ? NIL : next.path_.back();
+    uint32_t last = static_cast<uint32_t>(nodes_.size() - 1);
+    vector<uint32_t> holes = {pos.path_.back()};
+    detachAt(pos.path_);
+    removeSlots(holes);
+    if (after == NIL) {
+        return end();
+    }
+    // the tree may have changed shape, and the last node moved into the
+    // hole, so find the successor's path afresh
+    return pathTo(after == last ? holes[0] : after);
+}
+
+template <typename T, typename Compare>
+typename CompactTreeSet<T, Compare>::node_type
+CompactTreeSet<T, Compare>::extract(const T& val) {
+    Iterator found(this);
+    bool lastRight = false;
+    if (!descend(val, found.path_, root_, lastRight)) {
+        splay(found.path_);
+        return node_type();
+    }
+    return extract(found);
+}
+
+template <typename T, typename Compare>
+typename CompactTreeSet<T, Compare>::node_type
+CompactTreeSet<T, Compare>::extract(iterator pos) {
+    vector<uint32_t> holes = {pos.path_.back()};
+    detachAt(pos.path_);
+    node_type handle(std::move(nodes_[holes[0]].value_));
+    removeSlots(holes);
+    return handle;
+}
+
+template <typename T, typename Compare>
+vector<uint32_t> CompactTreeSet<T, Compare>::inOrder(uint32_t tree) const {
+    vector<uint32_t> order;
+    order.reserve(sizeOf(tree));
+    vector<uint32_t> pending;
+    uint32_t cur = tree;
+    while (cur != NIL || !pending.empty()) {
+        for (; cur != NIL; cur = nodes_[cur].left_) {
+            pending.push_back(cur);
+        }
+        cur = pending.back();
+        pending.pop_back();
+        order.push_back(cur);
+        cur = nodes_[cur].right_;
+    }
+    return order;
+}
+
+template <typename T, typename Compare>
+void CompactTreeSet<T, Compare>::split(const T& key,
+                                       CompactTreeSet& greater) {
+    if (&greater == this) {
+        return;
+    }
+    greater.clear();
+    uint32_t less = NIL;
+    uint32_t above = NIL;
+    uint32_t match = splitHelper(root_, key, less, above);
+    uint32_t upper = (match == NIL) ? above : joinWithRoot(NIL, match, above);
+    root_ = less;
+    if (upper == NIL) {
+        return;
+    }
+
+    vector<uint32_t> moved = inOrder(upper);
+    if (greater.type_ != type_) {
+        vector<T> values;
+        values.reserve(moved.size());
+        for (uint32_t node : moved) {
+            values.push_back(std::move(nodes_[node].value_));
+        }
+        greater.rebuildSorted(values);
+    } else {
+        // copy top down so each node's parent already has its new index
+        greater.nodes_.reserve(moved.size());
+        struct Pending {
+            uint32_t from;  // our index of the node
+            uint32_t parent;  // greater's index of its parent, or NIL
+            bool right;  // which child of that parent it is
+        };
+        vector<Pending> pending = {{upper, NIL, false}};
+        while (!pending.empty()) {
+            Pending step = pending.back();
+            pending.pop_back();
+            Node& from = nodes_[step.from];
+            uint32_t to = static_cast<uint32_t>(greater.nodes_.size());
+            greater.nodes_.emplace_back(std::in_place,
+                                        std::move(from.value_));
+            greater.nodes_[to].size_ = from.size_;
+            if (type_ == treetype::TREAP) {
+                greater.priorities_.push_back(priorities_[step.from]);
+            }
+            if (step.parent == NIL) {
+                greater.root_ = to;
+            } else {
+                Node& parent = greater.nodes_[step.parent];
+                (step.right ? parent.right_ : parent.left_) = to;
+            }
+            if (from.right_ != NIL) {
+                pending.push_back({from.right_, to, true});
+            }
+            if (from.left_ != NIL) {
+                pending.push_back({from.left_, to, false});
+            }
+        }
+    }
+    removeSlots(moved);
+}
+
+template <typename T, typename Compare>
+uint32_t CompactTreeSet<T, Compare>::takeNodes(CompactTreeSet& other) {
+    if (nodes_.size() + other.nodes_.size() > NIL) {
+        throw std::length_error("CompactTreeSet holds 2^32 - 1 elements");
+    }
+    uint32_t base = static_cast<uint32_t>(nodes_.size());
+    uint32_t taken;
+    nodes_.reserve(nodes_.size() + other.nodes_.size());
+    if (other.type_ == type_) {
+        // append in place, shifting every index by our size
+        for (Node& node : other.nodes_) {
+            nodes_.emplace_back(std::in_place, std::move(node.value_));
+            Node& copy = nodes_.back();
+            copy.left_ = (node.left_ == NIL) ? NIL : node.left_ + base;
+            copy.right_ = (node.right_ == NIL) ? NIL : node.right_ + base;
+            copy.size_ = node.size_;
+        }
+        if (type_ == treetype::TREAP) {
+            priorities_.insert(priorities_.end(), other.priorities_.begin(),
+                               other.priorities_.end());
+        }
+        taken = other.root_ + base;
+    } else {
+        // another treetype's shape need not suit ours, so relink in order
+        for (uint32_t node : other.inOrder(other.root_)) {
+            nodes_.emplace_back(std::in_place,
+                                std::move(other.nodes_[node].value_));
+        }
+        taken = linkBalanced(base, static_cast<uint32_t>(nodes_.size()));
+        if (type_ == treetype::TREAP) {
+            priorities_.resize(nodes_.size());
+            assignHeapPriorities(taken);
+        }
+    }
+    other.clear();
+    return taken;
+}
+
+template <typename T, typename Compare>
+void CompactTreeSet<T, Compare>::join(CompactTreeSet& right) {
+    if (&right == this || right.root_ == NIL) {
+        return;
+    }
+    if (root_ != NIL) {
+        uint32_t max = root_;
+        while (nodes_[max].right_ != NIL) {
+            max = nodes_[max].right_;
+        }
+        uint32_t min = right.root_;
+        while (right.nodes_[min].left_ != NIL) {
+            min = right.nodes_[min].left_;
+        }
+        if (!comp_(nodes_[max].value_, right.nodes_[min].value_)) {
+            setUnion(right);
+            return;
+        }
+    }
+    uint32_t taken = takeNodes(right);
+    root_ = joinSubtrees(root_, taken);
+}
+
+template <typename T, typename Compare>
+void CompactTreeSet<T, Compare>::mergeWith(setop op,
+                                           CompactTreeSet& other) {
+    vector<uint32_t> mine = inOrder(root_);
+    vector<uint32_t> theirs = other.inOrder(other.root_);
+    vector<T> merged;
+    merged.reserve(op == UNION ? mine.size() + theirs.size() : mine.size());
+    size_t i = 0;
+    size_t j = 0;
+    while (i < mine.size() && j < theirs.size()) {
+        T& ours = nodes_[mine[i]].value_;
+        T& its = other.nodes_[theirs[j]].value_;
+        if (comp_(ours, its)) {
+            if (op != INTERSECTION) {
+                merged.push_back(std::move(ours));
+            }
+            ++i;
+        } else if (comp_(its, ours)) {
+            if (op == UNION) {
+                merged.push_back(std::move(its));
+            }
+            ++j;
+        } else {
+            if (op != DIFFERENCE) {
+                merged.push_back(std::move(ours));
+            }
+            ++i;
+            ++j;
+        }
+    }
+    for (; op != INTERSECTION && i < mine.size(); ++i) {
+        merged.push_back(std::move(nodes_[mine[i]].value_));
+    }
+    for (; op == UNION && j < theirs.size(); ++j) {
+        merged.push_back(std::move(other.nodes_[theirs[j]].value_));
+    }
+    if (merged.size() >= NIL) {
+        throw std::length_error("CompactTreeSet holds 2^32 - 1 elements");
+    }
+    other.clear();
+    rebuildSorted(merged);
+}
+
+template <typename T, typename Compare>
+void CompactTreeSet<T, Compare>::setUnion(CompactTreeSet& other) {
+    if (&other == this) {
+        return;
+    }
+    size_t levels = 1;
+    for (size_t n = size(); n != 0; n >>= 1) {
+        ++levels;
+    }
+    if (other.size() * levels < size() + other.size()) {
+        // few enough to insert one by one; order does not matter
+        for (Node& node : other.nodes_) {
+            insert(std::move(node.value_));
+        }
+        other.clear();
+    } else {
+        mergeWith(UNION, other);
+    }
+}
+
+template <typename T, typename Compare>
+void CompactTreeSet<T, Compare>::setIntersection(CompactTreeSet& other) {
+    if (&other == this) {
+        return;
+    }
+    CompactTreeSet& small = (other.size() < size()) ? other : *this;
+    CompactTreeSet& large = (other.size() < size()) ? *this : other;
+    size_t levels = 1;
+    for (size_t n = large.size(); n != 0; n >>= 1) {
+        ++levels;
+    }
+    if (small.size() * levels >= size() + other.size()) {
+        mergeWith(INTERSECTION, other);
+        return;
+    }
+    // look the smaller set's elements up in the larger one
+    vector<T> kept;
+    for (uint32_t node : small.inOrder(small.root_)) {
+        T& val = small.nodes_[node].value_;
+        uint32_t found = large.lowerBoundIndex(val);
+        if (found != NIL && !comp_(val, large.nodes_[found].value_)) {
+            kept.push_back(std::move(val));
+        }
+    }
+    other.clear();
+    rebuildSorted(kept);
+}
+
+template <typename T, typename Compare>
+void CompactTreeSet<T, Compare>::setDifference(CompactTreeSet& other) {
+    if (&other == this) {
+        clear();
+        return;
+    }
+    size_t levels = 1;
+    for (size_t n = size(); n != 0; n >>= 1) {
+        ++levels;
+    }
+    if (other.size() * levels < size() + other.size()) {
+        for (const Node& node : other.nodes_) {
+            erase(node.value_);
+        }
+        other.clear();
+        return;
+    }
+    levels = 1;
+    for (size_t n = other.size(); n != 0; n >>= 1) {
+        ++levels;
+    }
+    if (size() * levels >= size() + other.size()) {
+        mergeWith(DIFFERENCE, other);
+        return;
+    }
+    // we are the smaller set: keep what the other set lacks
+    vector<T> kept;
+    for (uint32_t node : inOrder(root_)) {
+        T& val = nodes_[node].value_;
+        uint32_t found = other.lowerBoundIndex(val);
+        if (found == NIL || comp_(val, other.nodes_[found].value_)) {
+            kept.push_back(std::move(val));
+        }
+    }
+    other.clear();
+    rebuildSorted(kept);
+}
+
+template <typename T, typename Compare>
+uint32_t CompactTreeSet<T, Compare>::linkBalanced(uint32_t lo, uint32_t hi) {
+    if (lo == hi) {
+        return NIL;
+    }
+    uint32_t mid = lo + (hi - lo) / 2;
+    Node& node = nodes_[mid];
+    node.left_ = linkBalanced(lo, mid);
+    node.right_ = linkBalanced(mid + 1, hi);
+    node.size_ = hi - lo;
+    return mid;
+}
+
+template <typename T, typename Compare>
+void CompactTreeSet<T, Compare>::assignHeapPriorities(uint32_t tree) {
+    std::vector<uint32_t> priorities(sizeOf(tree));
+    for (uint32_t& priority : priorities) {
+        priority = nextBits();
+    }
+    // every ancestor comes before its descendants in breadth-first order,
+    // so handing out priorities from high to low keeps heap order
+    std::sort(priorities.begin(), priorities.end(), std::greater<uint32_t>());
+    std::vector<uint32_t> level;
+    if (tree != NIL) {
+        level.push_back(tree);
+    }
+    for (size_t i = 0; i < level.size(); ++i) {
+        const Node& node = nodes_[level[i]];
+        priorities_[level[i]] = priorities[i];
+        if (node.left_ != NIL) {
+            level.push_back(node.left_);
+        }
+        if (node.right_ != NIL) {
+            level.push_back(node.right_);
+        }
+    }
+}
+
+template <typename T, typename Compare>
+void CompactTreeSet<T, Compare>::rebuildSorted(vector<T>& values) {
+    clear();
+    nodes_.reserve(values.size());
+    for (T& val : values) {
+        nodes_.emplace_back(std::in_place, std::move(val));
+    }
+    root_ = linkBalanced(0, static_cast<uint32_t>(nodes_.size()));
+    if (type_ == treetype::TREAP) {
+        priorities_.resize(nodes_.size());
+        assignHeapPriorities(root_);
+    }
+}
+
+template <typename T, typename Compare>
+template <typename InputIt>
+void CompactTreeSet<T, Compare>::assign(InputIt first, InputIt last) {
+    vector<T> values(first, last);
+    auto before = [this](const T& a, const T& b) { return comp_(a, b); };
+    if (!std::is_sorted(values.begin(), values.end(), before)) {
+        std::sort(values.begin(), values.end(), before);
+    }
+    auto same = [this](const T& a, const T& b) {
+        return !comp_(a, b) && !comp_(b, a);
+    };
+    values.erase(std::unique(values.begin(), values.end(), same),
+                 values.end());
+    if (values.size() >= NIL) {
+        throw std::length_error("CompactTreeSet holds 2^32 - 1 elements");
+    }
+    rebuildSorted(values);
+}
+
+template <typename T, typename Compare>
+void CompactTreeSet<T, Compare>::clear() {
+    // swap with empty vectors so the memory goes too
+    vector<Node>().swap(nodes_);
+    vector<uint32_t>().swap(priorities_);
+    root_ = NIL;
+}
+
+template <typename T, typename Compare>
+template <typename K>
+uint32_t CompactTreeSet<T, Compare>::lowerBoundIndex(const K& key) const {
+    uint32_t candidate = NIL;
+    uint32_t cur = root_;
+    while (cur != NIL) {
+        const Node& node = nodes_[cur];
+        if (comp_(node.value_, key)) {
+            cur = node.right_;
+        } else {
+            candidate = cur;
+            cur = node.left_;
+        }
+    }
+    return candidate;
+}
+
+template <typename T, typename Compare>
+bool CompactTreeSet<T, Compare>::exists(const T& val) const {
+    if (splays()) {
+        iterator found = bound(val, true, true);
+        return found != end() && !comp_(val, *found);
+    }
+    // no path to record, so no allocation
+    uint32_t found = lowerBoundIndex(val);
+    return found != NIL && !comp_(val, nodes_[found].value_);
+}
+
+template <typename T, typename Compare>
+template <typename K, typename C, typename>
+bool CompactTreeSet<T, Compare>::exists(const K& key) const {
+    if (splays()) {
+        iterator found = bound(key, true, true);
+        return found != end() && !comp_(key, *found);
+    }
+    uint32_t found = lowerBoundIndex(key);
+    return found != NIL && !comp_(key, nodes_[found].value_);
+}
+
+template <typename T, typename Compare>
+void CompactTreeSet<T, Compare>::lowerBoundNodes(
+        const T* keys, size_t count, vector<uint32_t>& found,
+        vector<iterator>* bounds) const {
+    found.assign(count, NIL);
+    if (bounds != nullptr) {
+        bounds->assign(count, end());
+    }
+    bool sorted = count > 1 &&
+                  std::is_sorted(keys, keys + count,
+                                 [this](const T& a, const T& b) {
+                                     return comp_(a, b);
+                                 });
+    // each lane searches its own run of keys
+    struct Lane {
+        size_t key;  // index of the key being searched for
+        size_t last;  // one past the lane's final key
+        uint32_t cur;  // next node to look at, NIL once the search ends
+        vector<uint32_t> path;  // nodes looked at so far
+        vector<size_t> lefts;  // path lengths at each left turn
+    };
+    Lane lanes[BATCH_LANES];
+    size_t active = 0;
+    size_t run = (count + BATCH_LANES - 1) / BATCH_LANES;
+    for (size_t first = 0; first < count; first += run) {
+        Lane& lane = lanes[active++];
+        lane.key = first;
+        lane.last = std::min(count, first + run);
+        lane.cur = root_;
+    }
+    while (active > 0) {
+        for (size_t i = 0; i < active;) {
+            Lane& lane = lanes[i];
+            if (lane.cur != NIL) {  // one level further down
+                const Node& node = nodes_[lane.cur];
+                lane.path.push_back(lane.cur);
+                if (comp_(node.value_, keys[lane.key])) {
+                    lane.cur = node.right_;
+                } else {
+                    lane.lefts.push_back(lane.path.size());
+                    lane.cur = node.left_;
+                }
+                if (lane.cur != NIL) {
+                    __builtin_prefetch(&nodes_[lane.cur]);
+                }
+                ++i;
+                continue;
+            }
+            // the last left turn is the bound
+            size_t depth = lane.lefts.empty() ? 0 : lane.lefts.back();
+            if (depth != 0) {
+                found[lane.key] = lane.path[depth - 1];
+                if (bounds != nullptr) {
+                    (*bounds)[lane.key].path_.assign(
+                        lane.path.begin(), lane.path.begin() + depth);
+                }
+            }
+            if (++lane.key == lane.last) {
+                std::swap(lane, lanes[--active]);
+                continue;
+            }
+            if (!sorted) {
+                lane.cur = root_;
+                lane.path.clear();
+                lane.lefts.clear();
+                ++i;
+                continue;
+            }
+            // left turns at nodes below the new key no longer bound it; the
+            // search goes on right of the highest of them, and if there is
+            // none the previous answer stands
+            size_t parted = 0;
+            while (!lane.lefts.empty() &&
+                   comp_(nodes_[lane.path[lane.lefts.back() - 1]].value_,
+                         keys[lane.key])) {
+                parted = lane.lefts.back();
+                lane.lefts.pop_back();
+            }
+            if (parted != 0) {
+                lane.path.resize(parted);
+                lane.cur = nodes_[lane.path.back()].right_;
+            }
+            ++i;
+        }
+    }
+}
+
+template <typename T, typename Compare>
+void CompactTreeSet<T, Compare>::existsBatch(const T* keys, size_t count,
+                                             vector<bool>& found) const {
+    vector<uint32_t> nodes;
+    lowerBoundNodes(keys, count, nodes, nullptr);
+    found.assign(count, false);
+    for (size_t i = 0; i < count; ++i) {
+        found[i] = nodes[i] != NIL && !comp_(keys[i], nodes_[nodes[i]].value_);
+    }
+}
+
+template <typename T, typename Compare>
+void CompactTreeSet<T, Compare>::lowerBoundBatch(
+        const T* keys, size_t count, vector<iterator>& bounds) const {
+    vector<uint32_t> nodes;
+    lowerBoundNodes(keys, count, nodes, &bounds);
+}
+
+template <typename T, typename Compare>
+typename CompactTreeSet<T, Compare>::iterator
+CompactTreeSet<T, Compare>::select(size_t k) const {
+    Iterator found(this);
+    uint32_t cur = root_;
+    // skip whole left subtrees using their sizes until k lands on a node
+    while (cur != NIL) {
+        const Node& node = nodes_[cur];
+        size_t leftSize = sizeOf(node.left_);
+        found.path_.push_back(cur);
+        if (k < leftSize) {
+            cur = node.left_;
+        } else if (k == leftSize) {
+            splay(found.path_);
+            return found;
+        } else {
+            k -= leftSize + 1;
+            cur = node.right_;
+        }
+    }
+    return end();
+}
+
+template <typename T, typename Compare>
+size_t CompactTreeSet<T, Compare>::countBelow(const T& val,
+                                              bool inclusive) const {
+    size_t count = 0;
+    uint32_t cur = root_;
+    while (cur != NIL) {
+        const Node& node = nodes_[cur];
+        // one comparison decides: < val, or <= val when inclusive
+        if (inclusive ? !comp_(val, node.value_) : comp_(node.value_, val)) {
+            // node and its left are all below val
+            count += sizeOf(node.left_) + 1;
+            cur = node.right_;
+        } else {
+            cur = node.left_;
+        }
+    }
+    return count;
+}
+
+template <typename T, typename Compare>
+size_t CompactTreeSet<T, Compare>::rank(const T& val) const {
+    return countBelow(val, false);
+}
+
+template <typename T, typename Compare>
+size_t CompactTreeSet<T, Compare>::countBetween(const T& lo,
+                                                const T& hi) const {
+    if (comp_(hi, lo)) {
+        return 0;
+    }
+    // elements <= hi, minus elements < lo
+    return countBelow(hi, true) - countBelow(lo, false);
+}
+
+template <typename T, typename Compare>
+template <typename K>
+typename CompactTreeSet<T, Compare>::iterator
+CompactTreeSet<T, Compare>::bound(const K& key, bool inclusive,
+                                  bool splaying) const {
+    Iterator found(this);
+    size_t depth = 0;  // path length down to the last node we went left at
+    uint32_t cur = root_;
+    while (cur != NIL) {
+        const Node& node = nodes_[cur];
+        found.path_.push_back(cur);
+        bool tooSmall = inclusive ? comp_(node.value_, key)
+                                  : !comp_(key, node.value_);
+        if (tooSmall) {
+            cur = node.right_;
+        } else {
+            depth = found.path_.size();
+            cur = node.left_;
+        }
+    }
+    if (splaying && splays()) {
+        // splay the bound, or with none the last node reached
+        if (depth == 0) {
+            splay(found.path_);
+            return end();
+        }
+        found.path_.resize(depth);
+        splay(found.path_);
+        return found;
+    }
+    // that node is the bound; with none, the path empties to end()
+    found.path_.resize(depth);
+    return found;
+}
+
+template <typename T, typename Compare>
+typename CompactTreeSet<T, Compare>::iterator
+CompactTreeSet<T, Compare>::pathTo(uint32_t node) const {
+    Iterator found(this);
+    const T& val = nodes_[node].value_;
+    for (uint32_t cur = root_; cur != node;) {
+        found.path_.push_back(cur);
+        cur = comp_(val, nodes_[cur].value_) ? nodes_[cur].left_
+                                             : nodes_[cur].right_;
+    }
+    found.path_.push_back(node);
+    return found;
+}
+
+template <typename T, typename Compare>
+typename CompactTreeSet<T, Compare>::iterator
+CompactTreeSet<T, Compare>::lower_bound(const T& val) const {
+    return bound(val, true, true);
+}
+
+template <typename T, typename Compare>
+template <typename K, typename C, typename>
+typename CompactTreeSet<T, Compare>::iterator
+CompactTreeSet<T, Compare>::lower_bound(const K& key) const {
+    return bound(key, true, true);
+}
+
+template <typename T, typename Compare>
+typename CompactTreeSet<T, Compare>::iterator
+CompactTreeSet<T, Compare>::upper_bound(const T& val) const {
+    return bound(val, false, true);
+}
+
+template <typename T, typename Compare>
+template <typename K, typename C, typename>
+typename CompactTreeSet<T, Compare>::iterator
+CompactTreeSet<T, Compare>::upper_bound(const K& key) const {
+    return bound(key, false, true);
+}
+
+template <typename T, typename Compare>
+pair<typename CompactTreeSet<T, Compare>::iterator,
+     typename CompactTreeSet<T, Compare>::iterator>
+CompactTreeSet<T, Compare>::equal_range(const T& val) const {
+    iterator first = lower_bound(val);
+    iterator last = first;
+    // elements are distinct, so at most one is equal
+    if (last != end() && !comp_(val, *last)) {
+        ++last;
+    }
+    return {first, last};
+}
+
+template <typename T, typename Compare>
+typename CompactTreeSet<T, Compare>::range_view
+CompactTreeSet<T, Compare>::range(const T& lo, const T& hi) const {
+    if (comp_(hi, lo)) {
+        return Range(end(), end());
+    }
+    return Range(bound(lo, true, false), bound(hi, false, false));
+}
+
+template <typename T, typename Compare>
+FrozenSet<T, Compare> CompactTreeSet<T, Compare>::freeze() const {
+    // in-order iteration hands FrozenSet the sorted, distinct range it needs
+    return FrozenSet<T, Compare>(begin(), end(), comp_);
+}
+
+template <typename T, typename Compare>
+TreeStatistics CompactTreeSet<T, Compare>::statistics() const {
+    TreeStatistics stats;
+    if (root_ == NIL) {
+        return stats;
+    }
+    double totalDepth = 0;
+    vector<pair<uint32_t, size_t>> pending = {{root_, 0}};
+    while (!pending.empty()) {
+        uint32_t cur = pending.back().first;
+        size_t depth = pending.back().second;
+        pending.pop_back();
+        if (depth >= stats.depthCounts.size()) {
+            stats.depthCounts.resize(depth + 1, 0);
+        }
+        ++stats.depthCounts[depth];
+        totalDepth += static_cast<double>(depth);
+        const Node& node = nodes_[cur];
+        if (node.left_ != NIL) {
+            pending.push_back({node.left_, depth + 1});
+        }
+        if (node.right_ != NIL) {
+            pending.push_back({node.right_, depth + 1});
+        }
+    }
+    stats.nodes = size();
+    stats.height = static_cast<int>(stats.depthCounts.size()) - 1;
+    stats.averageDepth = totalDepth / static_cast<double>(stats.nodes);
+    // a tree of n nodes needs at least bit-length(n) levels
+    size_t fewestLevels = 0;
+    for (size_t n = stats.nodes; n != 0; n >>= 1) {
+        ++fewestLevels;
+    }
+    stats.balance = static_cast<double>(stats.depthCounts.size()) /
+                    static_cast<double>(fewestLevels);
+    return stats;
+}
+
+template <typename T, typename Compare>
+int CompactTreeSet<T, Compare>::height() const {
+    return statistics().height;
+}
+
+template <typename T, typename Compare>
+double CompactTreeSet<T, Compare>::averageDepth() const {
+    return statistics().averageDepth;
+}
+
+template <typename T, typename Compare>
+size_t CompactTreeSet<T, Compare>::bytesUsed() const {
+    return nodes_.capacity() * sizeof(Node) +
+           priorities_.capacity() * sizeof(uint32_t);
+}
+
+template <typename T, typename Compare>
+ostream& CompactTreeSet<T, Compare>::showStatistics(ostream& os) const {
+    TreeStatistics stats = statistics();
+    os << stats.nodes << " nodes, height " << stats.height
+       << ", average depth " << stats.averageDepth << ", " << sizeof(Node)
+       << " bytes per node" << endl;
+    return os;
+}
+
+template <typename T, typename Compare>
+ostream& CompactTreeSet<T, Compare>::printerHelper(uint32_t tree,
+                                                   ostream& os,
+                                                   bool sizes) const {
+    const char* empty = sizes ? "0" : "-";
+    if (tree == NIL) {
+        return os << empty;
+    }
+    // stage 0 opens a node and its left side, 1 prints it and its right
+    // side, 2 closes it
+    vector<pair<uint32_t, int>> pending = {{tree, 0}};
+    while (!pending.empty()) {
+        uint32_t cur = pending.back().first;
+        int stage = pending.back().second;
+        pending.pop_back();
+        const Node& node = nodes_[cur];
+        if (stage == 0) {
+            os << "(";
+            pending.push_back({cur, 1});
+            if (node.left_ == NIL) {
+                os << empty;
+            } else {
+                pending.push_back({node.left_, 0});
+            }
+        } else if (stage == 1) {
+            os << ", ";
+            if (sizes) {
+                os << node.size_;
+            } else {
+                os << node.value_;
+            }
+            os << ", ";
+            pending.push_back({cur, 2});
+            if (node.right_ == NIL) {
+                os << empty;
+            } else {
+                pending.push_back({node.right_, 0});
+            }
+        } else {
+            os << ")";
+        }
+    }
+    return os;
+}
+
+template <typename T, typename Compare>
+ostream& CompactTreeSet<T, Compare>::print(ostream& os) const {
+    return printerHelper(root_, os, false);
+}
+
+template <typename T, typename Compare>
+ostream& CompactTreeSet<T, Compare>::printSizes(ostream& os) const {
+    return printerHelper(root_, os, true);
+}
+
+template <typename T, typename Compare>
+ostream& operator<<(ostream& os, const CompactTreeSet<T, Compare>& t) {
+    return t.print(os);
+}
+
+template <typename T, typename Compare>
+int CompactTreeSet<T, Compare>::compare(
+        const CompactTreeSet<T, Compare>& rhs) const {
+    iterator lhsIter = begin();
+    iterator rhsIter = rhs.begin();
+    // walk both sets in order until one differs or runs out
+    for (; lhsIter != end() && rhsIter != rhs.end(); ++lhsIter, ++rhsIter) {
+        if (comp_(*lhsIter, *rhsIter)) {
+            return -1;
+        } else if (comp_(*rhsIter, *lhsIter)) {
+            return 1;
+        }
+    }
+    if (lhsIter != end()) {  // rhs is a proper prefix of *this
+        return 1;
+    }
+    return (rhsIter != rhs.end()) ? -1 : 0;
+}
+
+template <typename T, typename Compare>
+bool CompactTreeSet<T, Compare>::operator==(
+        const CompactTreeSet<T, Compare>& rhs) const {
+    // walk both sets in order side by side, stopping at the first mismatch
+    return size() == rhs.size() && std::equal(begin(), end(), rhs.begin());
+}
+
+template <typename T, typename Compare>
+bool CompactTreeSet<T, Compare>::operator!=(
+        const CompactTreeSet<T, Compare>& rhs) const {
+    return !operator==(rhs);
+}
+
+template <typename T, typename Compare>
+bool CompactTreeSet<T, Compare>::operator<(
+        const CompactTreeSet<T, Compare>& rhs) const {
+    return compare(rhs) < 0;
+}
+
+template <typename T, typename Compare>
+bool CompactTreeSet<T, Compare>::operator<=(
+        const CompactTreeSet<T, Compare>& rhs) const {
+    return compare(rhs) <= 0;
+}
+
+template <typename T, typename Compare>
+bool CompactTreeSet<T, Compare>::operator>(
+        const CompactTreeSet<T, Compare>& rhs) const {
+    return compare(rhs) > 0;
+}
+
+template <typename T, typename Compare>
+bool CompactTreeSet<T, Compare>::operator>=(
+        const CompactTreeSet<T, Compare>& rhs) const {
+    return compare(rhs) >= 0;
+}
+
+template <typename T, typename Compare>
+typename CompactTreeSet<T, Compare>::iterator
+CompactTreeSet<T, Compare>::begin() const {
+    Iterator first(this);
+    first.pushLeft(root_);
+    return first;
+}
+
+template <typename T, typename Compare>
+typename CompactTreeSet<T, Compare>::iterator
+CompactTreeSet<T, Compare>::end() const {
+    return Iterator(this);
+}
+
+template <typename T, typename Compare>
+CompactTreeSet<T, Compare>::Iterator::Iterator(const CompactTreeSet* tree)
+    : tree_(tree) {
+    // an empty path is end()
+}
+
+template <typename T, typename Compare>
+void CompactTreeSet<T, Compare>::Iterator::pushLeft(uint32_t node) {
+    for (; node != NIL; node = tree_->nodes_[node].left_) {
+        path_.push_back(node);
+    }
+}
+
+template <typename T, typename Compare>
+void CompactTreeSet<T, Compare>::Iterator::pushRight(uint32_t node) {
+    for (; node != NIL; node = tree_->nodes_[node].right_) {
+        path_.push_back(node);
+    }
+}
+
+template <typename T, typename Compare>
+typename CompactTreeSet<T, Compare>::Iterator&
+CompactTreeSet<T, Compare>::Iterator::operator++() {
+    uint32_t cur = path_.back();
+    uint32_t right = tree_->nodes_[cur].right_;
+    if (right != NIL) {  // next is the smallest element of the right tree
+        pushLeft(right);
+        return *this;
+    }
+    // otherwise climb until we come up out of a left subtree
+    path_.pop_back();
+    while (!path_.empty() && tree_->nodes_[path_.back()].right_ == cur) {
+        cur = path_.back();
+        path_.pop_back();
+    }
+    return *this;
+}
+
+template <typename T, typename Compare>
+typename CompactTreeSet<T, Compare>::Iterator
+CompactTreeSet<T, Compare>::Iterator::operator++(int) {
+    Iterator old = *this;
+    ++(*this);
+    return old;
+}
+
+template <typename T, typename Compare>
+typename CompactTreeSet<T, Compare>::Iterator&
+CompactTreeSet<T, Compare>::Iterator::operator--() {
+    if (path_.empty()) {  // --end() is the largest element
+        pushRight(tree_->root_);
+        return *this;
+    }
+    uint32_t cur = path_.back();
+    uint32_t left = tree_->nodes_[cur].left_;
+    if (left != NIL) {  // previous is the largest element of the left tree
+        pushRight(left);
+        return *this;
+    }
+    // otherwise climb until we come up out of a right subtree
+    path_.pop_back();
+    while (!path_.empty() && tree_->nodes_[path_.back()].left_ == cur) {
+        cur = path_.back();
+        path_.pop_back();
+    }
+    return *this;
+}
+
+template <typename T, typename Compare>
+typename CompactTreeSet<T, Compare>::Iterator
+CompactTreeSet<T, Compare>::Iterator::operator--(int) {
+    Iterator old = *this;
+    --(*this);
+    return old;
+}
+
+template <typename T, typename Compare>
+const T& CompactTreeSet<T, Compare>::Iterator::operator*() const {
+    return tree_->nodes_[path_.back()].value_;
+}
+
+template <typename T, typename Compare>
+const T* CompactTreeSet<T, Compare>::Iterator::operator->() const {
+    return &(**this);
+}
+
+template <typename T, typename Compare>
+bool CompactTreeSet<T, Compare>::Iterator::operator==(
+        const Iterator& rhs) const {
+    // positions match when the current nodes do (both empty at end())
+    if (path_.empty() || rhs.path_.empty()) {
+        return path_.empty() == rhs.path_.empty();
+    }
+    return path_.back() == rhs.path_.back();
+}
+
+template <typename T, typename Compare>
+bool CompactTreeSet<T, Compare>::Iterator::operator!=(
+        const Iterator& rhs) const {
+    // Idiomatic code: leverage == to implement !=
+    return !(*this == rhs);
+}
+
+template <typename T, typename Compare>
+CompactTreeSet<T, Compare>::Range::Range(Iterator first, Iterator last)
+    : first_(first), last_(last) {
+    // Nothing else to do.
+}
+
+template <typename T, typename Compare>
+typename CompactTreeSet<T, Compare>::Iterator
+CompactTreeSet<T, Compare>::Range::begin() const {
+    return first_;
+}
+
+template <typename T, typename Compare>
+typename CompactTreeSet<T, Compare>::Iterator
+CompactTreeSet<T, Compare>::Range::end() const {
+    return last_;
+}
+
+template <typename T, typename Compare>
+bool CompactTreeSet<T, Compare>::Range::empty() const {
+    return first_ == last_;
+}
+
+#endif
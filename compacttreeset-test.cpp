@@ -0,0 +1,685 @@
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Include the testing-logger library from
+// the CS70 system directory in Docker.
+#include <cs70/testinglogger.hpp>
+
+#include "compacttreeset.hpp"
+
+using namespace std;
+
+///////////////////////////////////////////////////////////
+//  TESTING
+///////////////////////////////////////////////////////////
+
+// every treetype, for tests that should hold whatever the shape
+const treetype TYPES[] = {treetype::LEAF, treetype::ROOT,
+                          treetype::RANDOMIZED, treetype::TREAP,
+                          treetype::WEIGHT_BALANCED, treetype::SPLAY,
+                          treetype::SEMI_SPLAY};
+
+// whether a treetype keeps its height O(log n) whatever the input order
+bool balanced(treetype type) {
+    return type == treetype::RANDOMIZED || type == treetype::TREAP ||
+           type == treetype::WEIGHT_BALANCED;
+}
+
+
+bool insertTest() {
+    TestingLogger log("insert");
+
+    CompactTreeSet<string> mySet;
+
+    auto first = mySet.insert("Isaac");
+    affirm(first.second);
+    affirm(*first.first == "Isaac");
+    affirm(mySet.size() == 1);
+
+    mySet.insert("Tejus");
+    affirm(mySet.exists("Tejus") == true);
+    affirm(mySet.size() == 2);
+
+    auto again = mySet.insert("Isaac");
+    affirm(!again.second);
+    affirm(*again.first == "Isaac");
+    affirm(mySet.size() == 2);
+
+    return log.summarize();
+}
+
+bool manyInsertTest() {
+    TestingLogger log("many insert");
+
+    // sorted input would make a path of a plain BST; this one stays shallow
+    CompactTreeSet<int> mySet(treetype::RANDOMIZED, 7);
+    for (int i = 0; i < 20000; ++i) {
+        mySet.insert(i);
+    }
+
+    affirm(mySet.size() == 20000);
+    affirm(mySet.exists(0));
+    affirm(mySet.exists(19999));
+    affirm(!mySet.exists(20000));
+    affirm(mySet.height() < 60);
+
+    int expected = 0;
+    for (int value : mySet) {
+        affirm(value == expected);
+        ++expected;
+    }
+    affirm(expected == 20000);
+
+    return log.summarize();
+}
+
+bool iteratorMinusTest() {
+    TestingLogger log("iterator minus");
+
+    CompactTreeSet<int> mySet(treetype::RANDOMIZED, 5);
+    for (int i = 0; i < 500; ++i) {
+        mySet.insert((i * 7) % 500);
+    }
+
+    CompactTreeSet<int>::iterator iter = mySet.end();
+    for (int expected = 499; expected >= 0; --expected) {
+        --iter;
+        affirm(*iter == expected);
+    }
+    affirm(iter == mySet.begin());
+
+    // the iterator insert returns moves both ways, new element or not
+    auto added = mySet.insert(1000);
+    affirm(*added.first == 1000);
+    affirm(*--added.first == 499);
+    auto again = mySet.insert(250);
+    affirm(!again.second);
+    affirm(*++again.first == 251);
+    affirm(*--(--again.first) == 249);
+
+    return log.summarize();
+}
+
+bool eraseTest() {
+    TestingLogger log("erase");
+
+    // mirror random inserts and erases in std::set; erasing moves nodes
+    // around in the vector, so check order and sizes after each round
+    for (treetype type : TYPES) {
+        CompactTreeSet<int> mySet(type, 3);
+        std::set<int> model;
+        for (int round = 0; round < 20; ++round) {
+            for (int i = 0; i < 200; ++i) {
+                int key = (round * 7919 + i * 104729) % 500;
+                if ((i + round) % 3 == 0) {
+                    affirm(mySet.erase(key) == model.erase(key));
+                } else {
+                    affirm(mySet.insert(key).second ==
+                           model.insert(key).second);
+                }
+                affirm(mySet.exists(key) == (model.count(key) == 1));
+            }
+            affirm(mySet.size() == model.size());
+            affirm(std::equal(model.begin(), model.end(), mySet.begin()));
+            size_t below = std::distance(model.begin(),
+                                         model.lower_bound(250));
+            affirm(mySet.rank(250) == below);
+        }
+
+        for (int key : vector<int>(model.begin(), model.end())) {
+            affirm(mySet.erase(key) == 1);
+        }
+        affirm(mySet.size() == 0);
+        affirm(mySet.begin() == mySet.end());
+        affirm(mySet.erase(1) == 0);
+    }
+
+    return log.summarize();
+}
+
+bool orderStatisticsTest() {
+    TestingLogger log("order statistics");
+
+    CompactTreeSet<int> mySet;
+    for (int i = 0; i < 1000; ++i) {
+        mySet.insert((i * 13) % 1000 * 2);  // even numbers 0..1998
+    }
+
+    affirm(*mySet.select(0) == 0);
+    affirm(*mySet.select(500) == 1000);
+    affirm(*mySet.select(999) == 1998);
+    affirm(mySet.select(1000) == mySet.end());
+
+    // select hands back a working iterator, not just the element
+    CompactTreeSet<int>::iterator iter = mySet.select(10);
+    ++iter;
+    affirm(*iter == 22);
+
+    affirm(mySet.rank(0) == 0);
+    affirm(mySet.rank(1000) == 500);
+    affirm(mySet.rank(1001) == 501);
+    affirm(mySet.rank(5000) == 1000);
+
+    affirm(mySet.countBetween(10, 20) == 6);
+    affirm(mySet.countBetween(20, 10) == 0);
+
+    return log.summarize();
+}
+
+bool boundsTest() {
+    TestingLogger log("bounds");
+
+    CompactTreeSet<int> mySet;
+    for (int i = 0; i < 300; ++i) {
+        mySet.insert(i * 10);
+    }
+
+    affirm(*mySet.lower_bound(30) == 30);
+    affirm(*mySet.lower_bound(31) == 40);
+    affirm(*mySet.upper_bound(30) == 40);
+    affirm(*mySet.lower_bound(-5) == 0);
+    affirm(mySet.lower_bound(2991) == mySet.end());
+    affirm(mySet.upper_bound(2990) == mySet.end());
+
+    // iterating from a bound visits the rest in order
+    int expected = 2950;
+    for (auto iter = mySet.lower_bound(2945); iter != mySet.end(); ++iter) {
+        affirm(*iter == expected);
+        expected += 10;
+    }
+    affirm(expected == 3000);
+
+    return log.summarize();
+}
+
+bool comparatorTest() {
+    TestingLogger log("comparator");
+
+    CompactTreeSet<int, std::greater<int>> mySet(treetype::RANDOMIZED, 1,
+                                                std::greater<int>());
+    for (int i : {3, 1, 4, 1, 5, 9, 2, 6}) {
+        mySet.insert(i);
+    }
+    affirm(mySet.size() == 7);
+    affirm(*mySet.begin() == 9);
+    affirm(*mySet.lower_bound(7) == 6);
+    affirm(mySet.rank(4) == 3);
+
+    return log.summarize();
+}
+
+bool printTest() {
+    TestingLogger log("print");
+
+    CompactTreeSet<double> mySet;
+
+    stringstream empty;
+    empty << mySet;
+    affirm(empty.str() == "-");
+
+    mySet.insert(2.1);
+
+    stringstream ss;
+    ss << mySet;
+    affirm(ss.str() == "(-, 2.1, -)");
+
+    return log.summarize();
+}
+
+bool treeEqualsTest() {
+    TestingLogger log("tree equals");
+
+    vector<int> forward = {41, 42, 43};
+    vector<int> backward = {43, 42, 41, 42};
+    CompactTreeSet<int> mySetOne(forward.begin(), forward.end());
+    CompactTreeSet<int> mySetTwo(backward.begin(), backward.end());
+
+    affirm(mySetOne == mySetTwo);
+
+    mySetOne.insert(44);
+    affirm(mySetOne != mySetTwo);
+
+    return log.summarize();
+}
+
+bool compactnessTest() {
+    TestingLogger log("compactness");
+
+    CompactTreeSet<int> mySet;
+    stringstream ss;
+    mySet.showStatistics(ss);
+    affirm(ss.str() ==
+           "0 nodes, height -1, average depth 0, 16 bytes per node\n");
+
+    for (int i = 0; i < 1000; ++i) {
+        mySet.insert(i);
+    }
+    affirm(mySet.bytesUsed() >= 1000 * 16);
+    affirm(mySet.bytesUsed() <= 2048 * 16);
+
+    return log.summarize();
+}
+
+bool treetypeTest() {
+    TestingLogger log("treetypes");
+
+    for (treetype type : TYPES) {
+        CompactTreeSet<int> mySet(type, 11);
+        for (int i = 0; i < 2000; ++i) {
+            mySet.insert(i);
+        }
+        affirm(mySet.size() == 2000);
+        affirm(mySet.statistics().nodes == 2000);
+        if (balanced(type)) {
+            affirm(mySet.height() < 40);
+        }
+        // a splay tree built in order is a path, until a deep access
+        // folds it
+        if (type == treetype::SPLAY) {
+            affirm(mySet.height() == 1999);
+            affirm(mySet.exists(0));
+            affirm(mySet.height() < 1100);
+        }
+        int expected = 0;
+        for (int value : mySet) {
+            affirm(value == expected);
+            ++expected;
+        }
+        affirm(expected == 2000);
+    }
+
+    return log.summarize();
+}
+
+bool eraseIteratorTest() {
+    TestingLogger log("erase iterator");
+
+    for (treetype type : TYPES) {
+        vector<int> values;
+        for (int i = 0; i < 100; ++i) {
+            values.push_back(i);
+        }
+        CompactTreeSet<int> mySet(values.begin(), values.end(), type, 4);
+        // only the iterator erase hands back survives the move it makes
+        for (auto iter = mySet.begin(); iter != mySet.end();) {
+            if (*iter % 2 == 1) {
+                iter = mySet.erase(iter);
+            } else {
+                ++iter;
+            }
+        }
+        affirm(mySet.size() == 50);
+        int expected = 0;
+        for (int value : mySet) {
+            affirm(value == expected);
+            expected += 2;
+        }
+        affirm(mySet.erase(mySet.select(49)) == mySet.end());
+        affirm(*mySet.erase(mySet.begin()) == 2);
+        affirm(mySet.size() == 48);
+    }
+
+    return log.summarize();
+}
+
+bool handleTest() {
+    TestingLogger log("extract and emplace");
+
+    for (treetype type : TYPES) {
+        CompactTreeSet<string> mySet(type);
+        for (string name : {"Isaac", "Tejus", "Eliza", "Mo"}) {
+            mySet.insert(name);
+        }
+
+        auto handle = mySet.extract("Tejus");
+        affirm(!handle.empty());
+        affirm(mySet.size() == 3);
+        affirm(!mySet.exists("Tejus"));
+        affirm(mySet.extract("Nobody").empty());
+
+        // a handle's element can change before it goes back in
+        handle.value() = "Zara";
+        auto placed = mySet.insert(std::move(handle));
+        affirm(placed.second);
+        affirm(*placed.first == "Zara");
+        affirm(handle.empty());
+
+        // handles move between the two kinds of set
+        TreeSet<string> other;
+        other.insert(mySet.extract(mySet.begin()));
+        affirm(other.exists("Eliza"));
+        mySet.insert(other.extract("Eliza"));
+        affirm(mySet.exists("Eliza"));
+
+        auto built = mySet.emplace(3, 'x');
+        affirm(built.second);
+        affirm(*built.first == "xxx");
+        affirm(!mySet.emplace("Mo").second);
+        affirm(mySet.size() == 5);
+        affirm(std::is_sorted(mySet.begin(), mySet.end()));
+    }
+
+    return log.summarize();
+}
+
+bool hintTest() {
+    TestingLogger log("hinted insert");
+
+    for (treetype type : TYPES) {
+        CompactTreeSet<int> mySet(type, 2);
+        vector<int> values;
+        for (int i = 0; i < 1000; ++i) {
+            values.push_back(i * 2);
+        }
+        mySet.appendSorted(values.begin(), values.end());
+        affirm(mySet.size() == 1000);
+        if (balanced(type)) {
+            affirm(mySet.height() < 40);
+        }
+
+        // hints before, after and at the element all find its place
+        auto iter = mySet.insert(mySet.lower_bound(500), 501);
+        affirm(*iter == 501);
+        iter = mySet.insert(mySet.lower_bound(1200), 999);
+        affirm(*iter == 999);
+        iter = mySet.insert(mySet.lower_bound(20), 20);
+        affirm(*iter == 20);
+        iter = mySet.insert(mySet.end(), -1);
+        affirm(*iter == -1);
+        affirm(mySet.size() == 1003);
+        affirm(*++iter == 0);
+        affirm(std::is_sorted(mySet.begin(), mySet.end()));
+    }
+
+    return log.summarize();
+}
+
+bool splitJoinTest() {
+    TestingLogger log("split and join");
+
+    for (treetype t : TYPES) {
+        for (treetype u : TYPES) {
+            CompactTreeSet<int> lower(t, 1);
+            for (int i = 0; i < 1000; ++i) {
+                lower.insert((i * 7) % 1000);
+            }
+            CompactTreeSet<int> upper(u, 2);
+            upper.insert(-5);  // discarded by the split
+            lower.split(500, upper);
+            affirm(lower.size() == 500);
+            affirm(upper.size() == 500);
+            affirm(*--lower.end() == 499);
+            affirm(*upper.begin() == 500);
+            affirm(upper.rank(750) == 250);
+
+            // each part goes on growing with its own treetype's shape
+            for (int i = 1000; i < 1500; ++i) {
+                upper.insert(i);
+            }
+            if (balanced(u)) {
+                affirm(upper.height() < 40);
+            }
+
+            lower.join(upper);
+            affirm(upper.size() == 0);
+            affirm(lower.size() == 1500);
+            for (int i = 1500; i < 2000; ++i) {
+                lower.insert(i);
+            }
+            if (balanced(t)) {
+                affirm(lower.height() < 40);
+            }
+            int expected = 0;
+            for (int value : lower) {
+                affirm(value == expected);
+                ++expected;
+            }
+            affirm(expected == 2000);
+        }
+    }
+
+    // overlapping ranges fall back to a union
+    CompactTreeSet<int> left(treetype::TREAP);
+    CompactTreeSet<int> right(treetype::TREAP);
+    for (int i = 0; i < 10; ++i) {
+        left.insert(i * 2);
+        right.insert(i * 3);
+    }
+    left.join(right);
+    affirm(left.size() == 16);
+    affirm(right.size() == 0);
+
+    return log.summarize();
+}
+
+bool setAlgebraTest() {
+    TestingLogger log("set algebra");
+
+    // large against large merges; large against small goes one by one
+    for (size_t small : {1000, 10}) {
+        for (treetype t : TYPES) {
+            for (treetype u : TYPES) {
+                std::set<int> evens;
+                std::set<int> triples;
+                for (int i = 0; i < 1000; ++i) {
+                    evens.insert(i * 2);
+                }
+                for (size_t i = 0; i < small; ++i) {
+                    triples.insert(static_cast<int>(i) * 3);
+                }
+                vector<int> both;
+                vector<int> either;
+                vector<int> onlyEven;
+                std::set_intersection(evens.begin(), evens.end(),
+                                      triples.begin(), triples.end(),
+                                      std::back_inserter(both));
+                std::set_union(evens.begin(), evens.end(), triples.begin(),
+                               triples.end(), std::back_inserter(either));
+                std::set_difference(evens.begin(), evens.end(),
+                                    triples.begin(), triples.end(),
+                                    std::back_inserter(onlyEven));
+
+                CompactTreeSet<int> a(evens.begin(), evens.end(), t, 3);
+                CompactTreeSet<int> b(triples.begin(), triples.end(), u, 4);
+                a.setUnion(b);
+                affirm(b.size() == 0);
+                affirm(a.size() == either.size());
+                affirm(std::equal(either.begin(), either.end(), a.begin()));
+
+                CompactTreeSet<int> c(evens.begin(), evens.end(), t, 5);
+                CompactTreeSet<int> d(triples.begin(), triples.end(), u, 6);
+                c.setIntersection(d);
+                affirm(c.size() == both.size());
+                affirm(std::equal(both.begin(), both.end(), c.begin()));
+
+                CompactTreeSet<int> e(evens.begin(), evens.end(), t, 7);
+                CompactTreeSet<int> f(triples.begin(), triples.end(), u, 8);
+                e.setDifference(f);
+                affirm(e.size() == onlyEven.size());
+                affirm(std::equal(onlyEven.begin(), onlyEven.end(),
+                                  e.begin()));
+
+                // the results go on working as their own treetype
+                for (int i = 5000; i < 6000; ++i) {
+                    a.insert(i);
+                    e.insert(i);
+                }
+                if (balanced(t)) {
+                    affirm(a.height() < 40);
+                    affirm(e.height() < 40);
+                }
+            }
+        }
+    }
+
+    return log.summarize();
+}
+
+bool rangeTest() {
+    TestingLogger log("range and equal_range");
+
+    for (treetype type : TYPES) {
+        CompactTreeSet<int> mySet(type, 9);
+        for (int i = 0; i < 100; ++i) {
+            mySet.insert((i * 37) % 100 * 3);
+        }
+
+        vector<int> window;
+        for (int value : mySet.range(10, 30)) {
+            window.push_back(value);
+        }
+        affirm((window == vector<int>{12, 15, 18, 21, 24, 27, 30}));
+        affirm(mySet.range(31, 32).empty());
+        affirm(mySet.range(30, 10).empty());
+
+        auto hit = mySet.equal_range(42);
+        affirm(*hit.first == 42);
+        affirm(*hit.second == 45);
+        auto miss = mySet.equal_range(43);
+        affirm(miss.first == miss.second);
+        affirm(*miss.first == 45);
+    }
+
+    return log.summarize();
+}
+
+bool batchLookupTest() {
+    TestingLogger log("batch lookup");
+
+    for (treetype type : TYPES) {
+        CompactTreeSet<int> mySet(type, 12);
+        for (int i = 0; i < 3000; ++i) {
+            mySet.insert((i * 7919) % 3000 * 2);
+        }
+        vector<int> keys;
+        for (int i = 0; i < 500; ++i) {
+            keys.push_back((i * 104729) % 6100 - 50);
+        }
+        vector<int> sorted = keys;
+        std::sort(sorted.begin(), sorted.end());
+
+        for (const vector<int>* batch : {&keys, &sorted}) {
+            vector<bool> found;
+            vector<CompactTreeSet<int>::iterator> bounds;
+            mySet.existsBatch(batch->data(), batch->size(), found);
+            mySet.lowerBoundBatch(batch->data(), batch->size(), bounds);
+            affirm(found.size() == batch->size());
+            affirm(bounds.size() == batch->size());
+            for (size_t i = 0; i < batch->size(); ++i) {
+                int key = (*batch)[i];
+                bool present = key >= 0 && key < 6000 && key % 2 == 0;
+                affirm(found[i] == present);
+                int expected = std::max(0, key + (key & 1));
+                if (expected >= 6000) {
+                    affirm(bounds[i] == mySet.end());
+                } else {
+                    affirm(*bounds[i] == expected);
+                }
+            }
+        }
+    }
+
+    return log.summarize();
+}
+
+bool freezeTest() {
+    TestingLogger log("freeze");
+
+    CompactTreeSet<int> mySet(treetype::WEIGHT_BALANCED);
+    for (int i = 0; i < 200; ++i) {
+        mySet.insert(i * 5);
+    }
+    FrozenSet<int> frozen = mySet.freeze();
+    affirm(frozen.size() == 200);
+    affirm(frozen.exists(995));
+    affirm(!frozen.exists(996));
+    affirm(std::equal(frozen.begin(), frozen.end(), mySet.begin()));
+
+    return log.summarize();
+}
+
+bool compareTest() {
+    TestingLogger log("compare");
+
+    vector<int> shorter = {1, 2, 3};
+    vector<int> longer = {1, 2, 3, 4};
+    vector<int> bigger = {1, 5};
+    CompactTreeSet<int> a(shorter.begin(), shorter.end());
+    CompactTreeSet<int> b(longer.begin(), longer.end(), treetype::SPLAY);
+    CompactTreeSet<int> c(bigger.begin(), bigger.end(), treetype::TREAP);
+
+    affirm(a.compare(a) == 0);
+    affirm(a < b);
+    affirm(b < c);
+    affirm(c > a);
+    affirm(a <= a);
+    affirm(c >= b);
+
+    // a bulk build is perfectly balanced
+    stringstream ss;
+    b.printSizes(ss);
+    affirm(ss.str() == "(((0, 1, 0), 2, 0), 4, (0, 1, 0))");
+
+    return log.summarize();
+}
+
+/*
+ * Test the CompactTreeSet
+ */
+int main(int, char**) {
+    TestingLogger alltests("All tests");
+
+
+    affirm(insertTest());
+
+    affirm(manyInsertTest());
+
+    affirm(iteratorMinusTest());
+
+    affirm(eraseTest());
+
+    affirm(orderStatisticsTest());
+
+    affirm(boundsTest());
+
+    affirm(comparatorTest());
+
+    affirm(printTest());
+
+    affirm(treeEqualsTest());
+
+    affirm(compactnessTest());
+
+    affirm(treetypeTest());
+
+    affirm(eraseIteratorTest());
+
+    affirm(handleTest());
+
+    affirm(hintTest());
+
+    affirm(splitJoinTest());
+
+    affirm(setAlgebraTest());
+
+    affirm(rangeTest());
+
+    affirm(batchLookupTest());
+
+    affirm(freezeTest());
+
+    affirm(compareTest());
+
+    if (alltests.summarize(true)) {
+        return 0;  // Error code of 0 == Success!
+    } else {
+        return 2;  // Arbitrarily chosen exit code of 2 means tests failed.
+    }
+}
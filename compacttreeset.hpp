@@ -0,0 +1,830 @@
+#ifndef COMPACTTREESET_HPP_INCLUDED
+
+#define COMPACTTREESET_HPP_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include "frozenset.hpp"
+#include "treeset.hpp"
+
+using namespace std;
+
+/**
+* \brief Sorted set whose nodes sit side by side in one vector
+*
+* The public interface is TreeSet's, treetypes included; the two differ
+* only in how nodes are stored. Children are 32-bit indices into the
+* vector and subtree sizes are 32-bit counts, so a CompactTreeSet<int>
+* node takes 16 bytes where a TreeSet<int> node takes 40 (TREAP sets keep
+* a 4-byte priority per node in a second vector). The set holds at most
+* 2^32 - 1 elements, and the TREESET_INSTRUMENT counters are TreeSet's
+* alone.
+*
+* Nodes have no parent link, so an iterator holds the path from the root
+* to its element; it moves both ways, but copying one costs O(height).
+* Erasing moves the last node of the vector into the hole, so the vector
+* never has gaps. The cost is iterator stability: any insert or erase
+* (and, in SPLAY and SEMI_SPLAY sets, any lookup) may invalidate every
+* iterator into the set, not just those to the erased element. Use the
+* iterators that insert, erase and the lookups return.
+**/
+template <typename T, typename Compare = std::less<T>>
+class CompactTreeSet {
+ private:
+    // Forward declaration of private classes.
+    class Iterator;
+    class Range;
+
+ public:
+    // allow users to iterate through the set in sorted order
+    using iterator = Iterator;
+    // a window of the set that can be used in a range-based for loop
+    using range_view = Range;
+    // an element taken out of a set; handles move between CompactTreeSet
+    // and TreeSet
+    using node_type = typename TreeSet<T, Compare>::node_type;
+
+    CompactTreeSet();
+    ~CompactTreeSet() = default;
+    CompactTreeSet(treetype t);
+    CompactTreeSet(treetype t, size_t s);
+    CompactTreeSet(treetype t, size_t s, const Compare& comp);
+
+    /**
+    * \brief Build a perfectly balanced set from a range of elements
+    * \param first, last range to copy, treetype and seed for later inserts,
+    *        comparator that orders the elements
+    *
+    * Runs in linear time when the range is already sorted; otherwise the
+    * elements are sorted first. Duplicates are dropped.
+    **/
+    template <typename InputIt, typename = typename
+              std::iterator_traits<InputIt>::iterator_category>
+    CompactTreeSet(InputIt first, InputIt last, treetype t = treetype::LEAF,
+                   size_t s = 0, const Compare& comp = Compare());
+
+    CompactTreeSet(const CompactTreeSet& orig) = delete;
+    CompactTreeSet& operator=(const CompactTreeSet& rhs) = delete;
+
+    // member functions
+    /**
+    * \brief Calculate size of set
+    * \param None
+    * \returns number of elements
+    **/
+    size_t size() const;
+
+    /**
+    * \brief Insert element into set unless already present
+    * \param T to insert
+    * \returns iterator to the element, and whether it was inserted
+    *
+    * Throws std::length_error if the set already holds 2^32 - 1 elements.
+    **/
+    pair<iterator, bool> insert(const T& t);
+
+    /**
+    * \brief Insert element, moving it into the new node
+    * \param T to insert; left untouched if it is already present
+    * \returns iterator to the element, and whether it was inserted
+    **/
+    pair<iterator, bool> insert(T&& t);
+
+    /**
+    * \brief Insert an element taken out of a set by extract()
+    * \param handle to insert from; it keeps its element if not inserted
+    * \returns iterator to the element, and whether it was inserted
+    **/
+    pair<iterator, bool> insert(node_type&& handle);
+
+    /**
+    * \brief Insert element, searching outward from a nearby position
+    * \param hint iterator near where T belongs (end() is fine), T to add
+    * \returns iterator to the element, new or already present
+    *
+    * The search climbs the hint's path only past the elements T lies
+    * beyond, then descends from there, so a T next to the hint costs O(1)
+    * comparisons. Sizes along the path are still updated and the new node
+    * goes where a plain insert would put it, so the time is O(height), as
+    * for insert(t); see TreeSet::insert(hint, t).
+    **/
+    iterator insert(iterator hint, const T& t);
+
+    /**
+    * \brief Insert a range that is sorted, or nearly so
+    * \param first, last range to insert; duplicates are dropped
+    * \returns void
+    *
+    * Each element is inserted with the previous one as its hint.
+    **/
+    template <typename InputIt>
+    void appendSorted(InputIt first, InputIt last);
+
+    /**
+    * \brief Construct an element directly in a new node and insert it
+    * \param arguments for T's constructor
+    * \returns iterator to the element, and whether it was inserted
+    *
+    * The node is built at the end of the vector before the search, since
+    * the key is needed to find its place; it is popped again if the key
+    * is already present.
+    **/
+    template <typename... Args>
+    pair<iterator, bool> emplace(Args&&... args);
+
+    /**
+    * \brief Take an element out of the set without copying it
+    * \param T to remove
+    * \returns handle owning the element, empty if T was not present
+    **/
+    node_type extract(const T& t);
+
+    /**
+    * \brief Take the element at pos out of the set without copying it
+    * \param iterator to an element of this set (not end())
+    * \returns handle owning the element
+    **/
+    node_type extract(iterator pos);
+
+    /**
+    * \brief Remove element from set if present
+    * \param T to remove
+    * \returns number of elements removed (0 or 1)
+    **/
+    size_t erase(const T& t);
+
+    /**
+    * \brief Remove the element an iterator refers to
+    * \param iterator to a valid element (not end())
+    * \returns iterator to the element after the removed one
+    *
+    * The last node moves into the freed slot, so other iterators are
+    * invalidated; only the returned one is safe to use.
+    **/
+    iterator erase(iterator pos);
+
+    /**
+    * \brief Split set at a key
+    * \param T to split at, set that receives the elements not less than T
+    * \returns void; *this keeps only the elements less than T
+    *
+    * Any previous contents of greater are discarded. The tree is split in
+    * O(height), but the k moved nodes are then copied into greater's
+    * vector and the holes they leave are filled, so the whole takes
+    * O(k log n), or O(n) when k is large. A greater of another treetype
+    * gets its part rebuilt balanced.
+    **/
+    void split(const T& t, CompactTreeSet& greater);
+
+    /**
+    * \brief Append a set whose elements are all greater than ours
+    * \param set to move from; it is left empty
+    * \returns void
+    *
+    * Falls back to setUnion if the two key ranges overlap. Right's nodes
+    * are moved onto the end of our vector, in O(size of right); a right
+    * set of another treetype is rebuilt to suit ours on the way.
+    **/
+    void join(CompactTreeSet& right);
+
+    /**
+    * \brief Make set the union of itself and another set
+    * \param set to move elements from; it is left empty
+    * \returns void
+    *
+    * A set of m elements much smaller than our n is inserted one element
+    * at a time, in O(m log n); otherwise the two are merged in order and
+    * rebuilt balanced, in O(n + m).
+    **/
+    void setUnion(CompactTreeSet& other);
+
+    /**
+    * \brief Keep only the elements that are also in another set
+    * \param set to intersect with; it is left empty
+    * \returns void
+    *
+    * The smaller set's elements are looked up in the larger one when that
+    * is cheaper than merging; the result is rebuilt balanced.
+    **/
+    void setIntersection(CompactTreeSet& other);
+
+    /**
+    * \brief Remove every element that is also in another set
+    * \param set to subtract; it is left empty
+    * \returns void
+    **/
+    void setDifference(CompactTreeSet& other);
+
+    /**
+    * \brief Replace the contents of set with a balanced build of a range
+    * \param first, last range to copy
+    * \returns void
+    **/
+    template <typename InputIt>
+    void assign(InputIt first, InputIt last);
+
+    /**
+    * \brief Check whether T exists in set
+    * \param T to check
+    * \returns boolean whether element exists or not
+    **/
+    bool exists(const T& t) const;
+
+    /**
+    * \brief Check whether an element equivalent to key exists in set
+    * \param key of any type Compare can order against T
+    * \returns boolean whether element exists or not
+    *
+    * Only available when Compare is transparent (has is_transparent).
+    **/
+    template <typename K, typename C = Compare,
+              typename = typename C::is_transparent>
+    bool exists(const K& key) const;
+
+    /**
+    * \brief Check a whole batch of keys, running the searches in lockstep
+    * \param keys and count of keys to check, found to receive one bit each
+    * \returns void; found[i] is whether keys[i] exists
+    *
+    * The keys are cut into one run per descent, and the descents advance
+    * a level at a time in turn, each prefetching its next node. In a
+    * sorted batch each search resumes from the previous key's path where
+    * the two part, as in TreeSet::existsBatch.
+    **/
+    void existsBatch(const T* keys, size_t count, vector<bool>& found) const;
+
+    /**
+    * \brief Find the element with k smaller elements (0-based k-th smallest)
+    * \param k position in sorted order
+    * \returns iterator to that element, or end() if k >= size()
+    **/
+    iterator select(size_t k) const;
+
+    /**
+    * \brief Count the elements that are strictly less than T
+    * \param T to rank
+    * \returns number of elements less than T
+    **/
+    size_t rank(const T& t) const;
+
+    /**
+    * \brief Count the elements in the closed range [lo, hi]
+    * \param lo and hi bounds of the range
+    * \returns number of elements e with lo <= e <= hi
+    **/
+    size_t countBetween(const T& lo, const T& hi) const;
+
+    /**
+    * \brief Find the first element that is not less than T
+    * \param T to search for
+    * \returns iterator to that element, or end() if there is none
+    **/
+    iterator lower_bound(const T& t) const;
+    template <typename K, typename C = Compare,
+              typename = typename C::is_transparent>
+    iterator lower_bound(const K& key) const;
+
+    /**
+    * \brief lower_bound for a whole batch of keys, searched in lockstep
+    * \param keys and count of keys to search for, bounds to receive them
+    * \returns void; bounds[i] is lower_bound(keys[i])
+    **/
+    void lowerBoundBatch(const T* keys, size_t count,
+                         vector<iterator>& bounds) const;
+
+    /**
+    * \brief Find the first element that is greater than T
+    * \param T to search for
+    * \returns iterator to that element, or end() if there is none
+    **/
+    iterator upper_bound(const T& t) const;
+    template <typename K, typename C = Compare,
+              typename = typename C::is_transparent>
+    iterator upper_bound(const K& key) const;
+
+    /**
+    * \brief Find the elements equal to T
+    * \param T to search for
+    * \returns lower_bound(t) and upper_bound(t)
+    *
+    * Found with one search, so a splay cannot invalidate the first.
+    **/
+    pair<iterator, iterator> equal_range(const T& t) const;
+
+    /**
+    * \brief View of the elements in the closed range [lo, hi]
+    * \param lo and hi bounds of the range
+    * \returns range_view that visits only the elements in the window
+    *
+    * Neither bound splays, so both iterators stay valid.
+    **/
+    range_view range(const T& lo, const T& hi) const;
+
+    /**
+    * \brief Copy set into an immutable, cache-friendly snapshot
+    * \param None
+    * \returns FrozenSet with the same elements, laid out for fast lookups
+    **/
+    FrozenSet<T, Compare> freeze() const;
+
+    /**
+    * \brief Measure the shape of the set in a single walk
+    * \param None
+    * \returns node count, height, mean depth, nodes per depth, balance
+    **/
+    TreeStatistics statistics() const;
+
+    /**
+    * \brief Calculate height of set
+    * \param None
+    * \returns height of the tree (-1 when empty)
+    **/
+    int height() const;
+
+    /**
+    * \brief Calculate average depth of set
+    * \param None
+    * \returns average node depth
+    **/
+    double averageDepth() const;
+
+    /**
+    * \brief Print set using CS70 rules
+    * \param os stream to print into
+    * \returns ostream&
+    **/
+    ostream& print(ostream& os) const;
+
+    /**
+    * \brief Print subtree sizes using CS70 rules
+    * \param os stream to print into
+    * \returns ostream&
+    **/
+    ostream& printSizes(ostream& os) const;
+
+    /**
+    * \brief Bytes held by the node vectors, including spare capacity
+    * \param None
+    * \returns capacity times node size, plus any TREAP priorities
+    **/
+    size_t bytesUsed() const;
+
+    /**
+    * \brief Calculate and print out statistics for the set
+    * \param os stream to print to
+    * \returns ostream with printed statistics
+    **/
+    ostream& showStatistics(ostream& os) const;
+
+    // An iterator that refers to the smallest element
+    iterator begin() const;
+    // An iterator that refers to just past the largest element
+    iterator end() const;
+
+    /**
+    * \brief Compare two sets lexicographically by their sorted elements
+    * \param rhs set to compare against
+    * \returns negative, zero or positive as *this is less, equal or greater
+    **/
+    int compare(const CompactTreeSet& rhs) const;
+
+    // operators
+    bool operator==(const CompactTreeSet& rhs) const;
+    bool operator!=(const CompactTreeSet& rhs) const;
+    bool operator<(const CompactTreeSet& rhs) const;
+    bool operator<=(const CompactTreeSet& rhs) const;
+    bool operator>(const CompactTreeSet& rhs) const;
+    bool operator>=(const CompactTreeSet& rhs) const;
+
+ private:
+    // Index that stands for "no node"; also one more than the last index
+    static constexpr uint32_t NIL = UINT32_MAX;
+
+    struct Node {
+        T value_;  // T value at node
+        uint32_t left_;  // index of left Tree of node, or NIL
+        uint32_t right_;  // index of right Tree of node, or NIL
+        uint32_t size_;  // size of subtree with Node as root
+
+        template <typename... Args>
+        explicit Node(std::in_place_t, Args&&... args);
+    };
+
+    static_assert(!std::is_same<T, int>::value ||
+                  sizeof(Node) == 4 * sizeof(uint32_t),
+                  "CompactTreeSet<int> nodes should have no padding");
+
+    mutable vector<Node> nodes_;  // every node, no gaps; splays relink them
+    vector<uint32_t> priorities_;  // TREAP only: priority of nodes_[i]
+    mutable uint32_t root_;  // index of the root node, or NIL
+    treetype type_;
+    uint64_t randomState_;  // splitmix64 state for random choices
+    Compare comp_;  // orders the elements
+
+    // WEIGHT_BALANCED parameters, as in TreeSet
+    static constexpr size_t WEIGHT_DELTA = 3;
+    static constexpr size_t WEIGHT_GAMMA = 2;
+
+    // How many searches lowerBoundNodes keeps in flight at once
+    static constexpr size_t BATCH_LANES = 8;
+
+    // The set operations mergeWith can run
+    enum setop { UNION, INTERSECTION, DIFFERENCE };
+
+    /**
+    * \brief Draw 32 random bits
+    * \param None
+    * \returns next value of a splitmix64 generator
+    **/
+    uint32_t nextBits();
+
+    /**
+    * \brief Draw a random number below a bound
+    * \param bound, at least 1
+    * \returns value in [0, bound)
+    **/
+    uint32_t nextRandom(uint32_t bound);
+
+    /**
+    * \brief Size of a possibly empty subtree
+    * \param index of the subtree's root
+    * \returns its size_, or 0 for NIL
+    **/
+    uint32_t sizeOf(uint32_t tree) const;
+
+    /**
+    * \brief Reset size of node from its children
+    * \param index of the node
+    * \returns void
+    **/
+    void setSize(uint32_t node) const;
+
+    /**
+    * \brief Throw std::length_error if no index is left for a new node
+    * \param None
+    * \returns void
+    **/
+    void checkRoom() const;
+
+    /**
+    * \brief Whether lookups splay (SPLAY and SEMI_SPLAY)
+    * \param None
+    * \returns true for the splaying treetypes
+    **/
+    bool splays() const;
+
+    /**
+    * \brief Find the link that points at the node at path[i]
+    * \param path from the root of a tree, index into it, link holding the
+    *        root of that tree
+    * \returns top when i is 0, else the parent's left_ or right_
+    **/
+    uint32_t& linkAt(const vector<uint32_t>& path, size_t i,
+                     uint32_t& top) const;
+
+    /**
+    * \brief Find the link that points at a node by searching for its value
+    * \param index of a node in the tree
+    * \returns root_ or the parent's left_ / right_ that refers to it
+    **/
+    uint32_t& linkTo(uint32_t node);
+
+    /**
+    * \brief Rotate a child up over the node a link holds
+    * \param link holding the node, whether its left child comes up
+    * \returns void
+    **/
+    void rotate(uint32_t& link, bool leftUp) const;
+
+    /**
+    * \brief Rotate a child up over path[i], keeping path a valid path
+    * \param path from the root of a tree, index of the node to rotate
+    *        down, whether its left child comes up, link holding the root
+    * \returns void
+    *
+    * The child that comes up takes index i. If it was not on the path it
+    * is inserted; if it was, path[i] stays on the path only when the next
+    * node below was the child's inner child, which path[i] now holds.
+    **/
+    void rotateOnPath(vector<uint32_t>& path, size_t i, bool leftUp,
+                      uint32_t& top) const;
+
+    /**
+    * \brief Splay the last node of a path towards the root in SPLAY and
+    *        SEMI_SPLAY sets
+    * \param path from root_ to the node just accessed (empty, or any other
+    *        treetype, does nothing); it ends up as the path to that node
+    * \returns void
+    **/
+    void splay(vector<uint32_t>& path) const;
+
+    /**
+    * \brief Fix the size and weight balance of path[i]
+    * \param path from the root of a tree, index of a node whose subtrees
+    *        are already balanced, link holding the root
+    * \returns void
+    **/
+    void rebalanceAt(vector<uint32_t>& path, size_t i, uint32_t& top);
+
+    /**
+    * \brief Fix sizes and weight balance along a path, bottom up
+    * \param path from the root of a tree, link holding the root
+    * \returns void
+    **/
+    void rebalancePath(vector<uint32_t>& path, uint32_t& top);
+
+    /**
+    * \brief Search for a key, one comparison a level, recording the path
+    * \param key to search for, path to extend, subtree to search,
+    *        output for the side of the path's last node key belongs on
+    * \returns true with path ending at the node equal to key, or false
+    *          with path ending at the node key would hang from
+    **/
+    template <typename K>
+    bool descend(const K& key, vector<uint32_t>& path, uint32_t cur,
+                 bool& lastRight) const;
+
+    /**
+    * \brief Link a new node where this set's treetype puts it
+    * \param iterator whose path a failed descend left, the side of its last
+    *        node, make, called once to put the node in nodes_
+    * \returns iterator to the new node, and true
+    **/
+    template <typename Make>
+    pair<iterator, bool> insertAt(Iterator& found, bool lastRight,
+                                  Make& make);
+
+    /**
+    * \brief Split the subtree at path[from] around a new node
+    * \param path of T's search from the root, index into it, the side of
+    *        the path's last node T belongs on, and the new node, whose
+    *        children become the elements less and greater than T
+    * \returns void
+    *
+    * T's search already chose a side at every node below path[from], so
+    * the split makes no comparisons.
+    **/
+    void splitPath(const vector<uint32_t>& path, size_t from,
+                   bool lastRight, uint32_t fresh);
+
+    /**
+    * \brief Unlink the last node of a path and fix the tree above it
+    * \param path from root_ to the node; it ends as the path to its parent
+    * \returns void; the node stays in nodes_ until removeSlots
+    **/
+    void detachAt(vector<uint32_t>& path);
+
+    /**
+    * \brief Unlink the smallest node of a subtree, fixing sizes above it
+    * \param link holding the root of the subtree (not NIL)
+    * \returns index of the detached node
+    **/
+    uint32_t detachMin(uint32_t& tree);
+
+    /**
+    * \brief Join two subtrees, picking each root with chance by its size
+    * \param left and right subtrees, every left value below every right
+    * \returns index of the joined subtree's root
+    **/
+    uint32_t joinRandom(uint32_t left, uint32_t right);
+
+    /**
+    * \brief Join two treaps, keeping the higher priority on top
+    * \param left and right subtrees, every left value below every right
+    * \returns index of the joined subtree's root
+    **/
+    uint32_t joinByPriority(uint32_t left, uint32_t right);
+
+    /**
+    * \brief Join two weight-balanced subtrees around a middle node
+    * \param left subtree, detached middle node, right subtree
+    * \returns index of the joined subtree's root
+    **/
+    uint32_t joinByWeight(uint32_t left, uint32_t mid, uint32_t right);
+
+    /**
+    * \brief Join two subtrees, using the strategy for this treetype
+    * \param left and right subtrees, every left value below every right
+    * \returns index of the joined subtree's root
+    **/
+    uint32_t joinSubtrees(uint32_t left, uint32_t right);
+
+    /**
+    * \brief Join two subtrees around a single node that sits between them
+    * \param left subtree, detached middle node, right subtree
+    * \returns index of the joined subtree's root
+    **/
+    uint32_t joinWithRoot(uint32_t left, uint32_t mid, uint32_t right);
+
+    /**
+    * \brief Split a subtree into the parts less and greater than a key
+    * \param subtree to split, key, outputs for the two parts
+    * \returns detached node equal to the key, or NIL if there is none
+    **/
+    uint32_t splitHelper(uint32_t tree, const T& key, uint32_t& less,
+                         uint32_t& greater);
+
+    /**
+    * \brief Split a weight-balanced subtree, joining the pieces back up
+    * \param subtree to split, key, outputs for the two parts
+    * \returns detached node equal to the key, or NIL if there is none
+    **/
+    uint32_t splitByWeight(uint32_t tree, const T& key, uint32_t& less,
+                           uint32_t& greater);
+
+    /**
+    * \brief Move the node at one index to another, free, index
+    * \param from index to empty, to index to fill
+    * \returns void
+    **/
+    void moveSlot(uint32_t from, uint32_t to);
+
+    /**
+    * \brief Drop unlinked nodes from the vector, closing the gaps
+    * \param holes, indices of nodes no longer in the tree
+    * \returns void
+    *
+    * Few holes are filled from the end of the vector, finding each moved
+    * node's parent by its value; many are closed by renumbering every
+    * node, which makes no comparisons.
+    **/
+    void removeSlots(vector<uint32_t>& holes);
+
+    /**
+    * \brief List a subtree's nodes in order, without recursion
+    * \param index of the subtree's root
+    * \returns their indices, smallest value first
+    **/
+    vector<uint32_t> inOrder(uint32_t tree) const;
+
+    /**
+    * \brief Move another set's nodes onto the end of our vector
+    * \param set to empty
+    * \returns index of their root, ready to be linked into our tree
+    *
+    * Nodes of a set of our treetype keep their shape (and priorities);
+    * others are relinked balanced, as a bulk build would leave them.
+    **/
+    uint32_t takeNodes(CompactTreeSet& other);
+
+    /**
+    * \brief Merge another set's elements with ours and rebuild balanced
+    * \param operation, set whose elements are moved from
+    * \returns void
+    **/
+    void mergeWith(setop op, CompactTreeSet& other);
+
+    /**
+    * \brief Replace the contents with sorted, duplicate-free values
+    * \param values (moved from)
+    * \returns void
+    **/
+    void rebuildSorted(vector<T>& values);
+
+    /**
+    * \brief Link a balanced subtree from nodes already in sorted order
+    * \param half-open range [lo, hi) of indices into nodes_
+    * \returns index of the subtree's root
+    **/
+    uint32_t linkBalanced(uint32_t lo, uint32_t hi);
+
+    /**
+    * \brief Give a balanced TREAP subtree random, heap-ordered priorities
+    * \param index of the subtree's root
+    * \returns void
+    **/
+    void assignHeapPriorities(uint32_t tree);
+
+    /**
+    * \brief Destroy every node and leave the set empty
+    * \param None
+    * \returns void
+    **/
+    void clear();
+
+    /**
+    * \brief Find the first node not less than key, one comparison a
+    *        level, without splaying
+    * \param key to search for (T, or any type a transparent Compare takes)
+    * \returns index of that node, or NIL if every element is less
+    **/
+    template <typename K>
+    uint32_t lowerBoundIndex(const K& key) const;
+
+    /**
+    * \brief Find the first element not less than (or greater than) key
+    * \param key to search for, whether an equal element qualifies, and
+    *        whether to splay what the search reached
+    * \returns iterator holding the path from the root to that element
+    **/
+    template <typename K>
+    iterator bound(const K& key, bool inclusive, bool splaying) const;
+
+    /**
+    * \brief Find the path to a node by searching for its value
+    * \param index of a node in the tree
+    * \returns iterator to that node
+    **/
+    iterator pathTo(uint32_t node) const;
+
+    /**
+    * \brief lowerBoundIndex for a batch of keys, interleaving the searches
+    * \param keys and count of keys, found to receive one index per key,
+    *        bounds to receive iterators too, or nullptr
+    * \returns void
+    **/
+    void lowerBoundNodes(const T* keys, size_t count, vector<uint32_t>& found,
+                         vector<iterator>* bounds) const;
+
+    /**
+    * \brief Count elements below T using subtree sizes
+    * \param T to compare with, whether elements equal to T also count
+    * \returns number of elements < T (or <= T if inclusive)
+    **/
+    size_t countBelow(const T& t, bool inclusive) const;
+
+    /**
+    * \brief Print a subtree using CS70 rules, without recursion
+    * \param index of the subtree's root, os stream to print into, whether
+    *        to print subtree sizes instead of values
+    * \returns ostream&
+    **/
+    ostream& printerHelper(uint32_t tree, ostream& os, bool sizes) const;
+
+    class Iterator {
+     public:
+        using value_type = T;
+        using reference = const value_type&;
+        using pointer = const value_type*;
+        using difference_type = std::ptrdiff_t;
+        using iterator_category = std::bidirectional_iterator_tag;
+
+        Iterator() = default;
+        Iterator(const Iterator&) = default;
+        Iterator& operator=(const Iterator&) = default;
+        ~Iterator() = default;
+
+        Iterator& operator++();
+        Iterator operator++(int);
+        Iterator& operator--();
+        Iterator operator--(int);
+        reference operator*() const;
+        pointer operator->() const;
+        bool operator==(const Iterator& rhs) const;
+        bool operator!=(const Iterator& rhs) const;
+
+     private:
+        friend class CompactTreeSet;
+        explicit Iterator(const CompactTreeSet* tree);
+        // Nodes have no parent links, so the iterator keeps the path from
+        // the root down to the current node, which is on top; it is empty
+        // at end().
+        vector<uint32_t> path_;
+        const CompactTreeSet* tree_ = nullptr;  // set path_ indexes into
+
+        /**
+        * \brief Push a node and its chain of left children onto path_
+        * \param index of the node to start from
+        * \returns void
+        **/
+        void pushLeft(uint32_t node);
+
+        /**
+        * \brief Push a node and its chain of right children onto path_
+        * \param index of the node to start from
+        * \returns void
+        **/
+        void pushRight(uint32_t node);
+    };
+
+    class Range {
+     public:
+        Range(const Range&) = default;
+        Range& operator=(const Range&) = default;
+        ~Range() = default;
+
+        Iterator begin() const;
+        Iterator end() const;
+        bool empty() const;
+
+     private:
+        friend class CompactTreeSet;
+        Range(Iterator first, Iterator last);
+        Iterator first_;  // first element in the window
+        Iterator last_;  // just past the last element in the window
+    };
+};
+
+template <typename T, typename Compare>
+std::ostream& operator<<(std::ostream& os,
+                         const CompactTreeSet<T, Compare>& c);
+
+#endif  // COMPACTTREESET_HPP_INCLUDED
+
+#include "compacttreeset-private.hpp"
@@ -0,0 +1,264 @@
+#ifndef CONCURRENTTREESET_PRIVATE_HPP_INCLUDED
+
+#define CONCURRENTTREESET_PRIVATE_HPP_INCLUDED
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+
+using namespace std;
+
+template <typename T>
+ConcurrentTreeSet<T>::ConcurrentTreeSet() : size_(0), priorityState_(0) { }
+
+template <typename T>
+ConcurrentTreeSet<T>::ConcurrentTreeSet(size_t seed)
+    : size_(0), priorityState_(seed) { }
+
+template <typename T>
+ConcurrentTreeSet<T>::~ConcurrentTreeSet() {
+    // only delete if tree actually exists
+    Node* root = head_.children_[RIGHT].load();
+    if (root != nullptr) {
+        deleteHelper(root);
+    }
+}
+
+template <typename T>
+ConcurrentTreeSet<T>::Link::Link()
+    : version_(0), children_{{nullptr}, {nullptr}}, parent_(nullptr) {
+    // nothing else to do
+}
+
+template <typename T>
+ConcurrentTreeSet<T>::Node::Node(const T& val, uint32_t priority)
+    : value_(val), priority_(priority) {
+    // nothing else to do
+}
+
+template <typename T>
+bool ConcurrentTreeSet<T>::SpinLock::try_lock() {
+    return !flag_.test_and_set(std::memory_order_acquire);
+}
+
+template <typename T>
+void ConcurrentTreeSet<T>::SpinLock::lock() {
+    while (!try_lock()) {
+        std::this_thread::yield();
+    }
+}
+
+template <typename T>
+void ConcurrentTreeSet<T>::SpinLock::unlock() {
+    flag_.clear(std::memory_order_release);
+}
+
+template <typename T>
+void ConcurrentTreeSet<T>::deleteHelper(Node* tree) {
+    // if we are past a leaf
+    if (tree != nullptr) {
+        deleteHelper(tree->children_[LEFT].load());
+        deleteHelper(tree->children_[RIGHT].load());
+        delete tree;
+    }
+}
+
+template <typename T>
+size_t ConcurrentTreeSet<T>::size() const {
+    return size_.load(std::memory_order_relaxed);
+}
+
+template <typename T>
+uint32_t ConcurrentTreeSet<T>::nextPriority() {
+    // splitmix64 only ever adds a constant to its state, so fetch_add
+    // makes it safe to share between writers
+    uint64_t z = priorityState_.fetch_add(0x9E3779B97F4A7C15ULL)
+                 + 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return static_cast<uint32_t>((z ^ (z >> 31)) >> 32);
+}
+
+template <typename T>
+uint64_t ConcurrentTreeSet<T>::stableVersion(const Link* node) {
+    uint64_t version = node->version_.load(std::memory_order_acquire);
+    while ((version & 1) != 0) {  // a writer is mid-rotation, wait it out
+        std::this_thread::yield();
+        version = node->version_.load(std::memory_order_acquire);
+    }
+    return version;
+}
+
+template <typename T>
+typename ConcurrentTreeSet<T>::direction
+ConcurrentTreeSet<T>::sideOf(const Link* parent, const Node* child) {
+    return (parent->children_[LEFT].load() == child) ? LEFT : RIGHT;
+}
+
+template <typename T>
+typename ConcurrentTreeSet<T>::Node*
+ConcurrentTreeSet<T>::descend(const T& val, Link*& parent,
+                              uint64_t& version) const {
+    while (true) {  // each pass is one optimistic descent from the head
+        // writers lock the head through this pointer, readers only read it
+        Link* cur = const_cast<Link*>(&head_);
+        uint64_t curVersion = stableVersion(cur);
+        direction dir = RIGHT;
+        while (true) {
+            Node* child = cur->children_[dir].load(std::memory_order_acquire);
+            if (child == nullptr) {
+                // an empty slot only proves absence if cur did not move
+                if (cur->version_.load(std::memory_order_acquire)
+                        != curVersion) {
+                    break;
+                }
+                parent = cur;
+                version = curVersion;
+                return nullptr;
+            }
+            // read the child's version before checking that cur is still
+            // unchanged, so the child cannot have moved in between unseen
+            uint64_t childVersion = stableVersion(child);
+            if (cur->version_.load(std::memory_order_acquire) != curVersion) {
+                break;
+            }
+            if (val < child->value_) {
+                dir = LEFT;
+            } else if (child->value_ < val) {
+                dir = RIGHT;
+            } else {  // nodes are never removed, so a match is final
+                return child;
+            }
+            cur = child;
+            curVersion = childVersion;
+        }
+    }
+}
+
+template <typename T>
+bool ConcurrentTreeSet<T>::exists(const T& val) const {
+    Link* parent;
+    uint64_t version;
+    return descend(val, parent, version) != nullptr;
+}
+
+template <typename T>
+bool ConcurrentTreeSet<T>::insert(const T& val) {
+    Node* fresh = nullptr;
+    while (true) {
+        Link* parent;
+        uint64_t version;
+        if (descend(val, parent, version) != nullptr) {  // already present
+            delete fresh;
+            return false;
+        }
+        if (fresh == nullptr) {
+            fresh = new Node(val, nextPriority());
+        }
+        direction dir = (parent != &head_
+                         && val < static_cast<Node*>(parent)->value_)
+                        ? LEFT : RIGHT;
+        // the slot is still ours if the parent has not been restructured
+        // and no other writer has filled it
+        parent->lock_.lock();
+        bool linked = parent->version_.load() == version
+                      && parent->children_[dir].load() == nullptr;
+        if (linked) {
+            fresh->parent_.store(parent);
+            parent->children_[dir].store(fresh, std::memory_order_release);
+        }
+        parent->lock_.unlock();
+        if (linked) {
+            size_.fetch_add(1, std::memory_order_relaxed);
+            bubbleUp(fresh);
+            return true;
+        }
+    }
+}
+
+template <typename T>
+void ConcurrentTreeSet<T>::bubbleUp(Node* node) {
+    while (true) {
+        Link* parent = node->parent_.load();
+        if (parent == &head_
+                || static_cast<Node*>(parent)->priority_ >= node->priority_) {
+            return;  // heap order holds here
+        }
+        Node* lowered = static_cast<Node*>(parent);
+        Link* grandparent = parent->parent_.load();
+
+        // take the three locks top-down, backing off instead of waiting so
+        // writers working on overlapping paths cannot deadlock
+        if (!grandparent->lock_.try_lock()) {
+            std::this_thread::yield();
+            continue;
+        }
+        if (!parent->lock_.try_lock()) {
+            grandparent->lock_.unlock();
+            std::this_thread::yield();
+            continue;
+        }
+        if (!node->lock_.try_lock()) {
+            parent->lock_.unlock();
+            grandparent->lock_.unlock();
+            std::this_thread::yield();
+            continue;
+        }
+        bool valid = node->parent_.load() == parent
+                     && parent->parent_.load() == grandparent
+                     && (grandparent->children_[LEFT].load() == lowered
+                         || grandparent->children_[RIGHT].load() == lowered)
+                     && (parent->children_[LEFT].load() == node
+                         || parent->children_[RIGHT].load() == node);
+        if (valid) {
+            direction up = sideOf(grandparent, lowered);
+            direction side = sideOf(parent, node);
+            direction other = (side == LEFT) ? RIGHT : LEFT;
+            Node* inner = node->children_[other].load();
+
+            // odd versions send readers on these nodes back to the root
+            grandparent->version_.fetch_add(1);
+            parent->version_.fetch_add(1);
+            node->version_.fetch_add(1);
+
+            grandparent->children_[up].store(node,
+                                             std::memory_order_release);
+            node->parent_.store(grandparent);
+            parent->children_[side].store(inner, std::memory_order_release);
+            if (inner != nullptr) {
+                inner->parent_.store(parent);
+            }
+            node->children_[other].store(lowered, std::memory_order_release);
+            parent->parent_.store(node);
+
+            node->version_.fetch_add(1, std::memory_order_release);
+            parent->version_.fetch_add(1, std::memory_order_release);
+            grandparent->version_.fetch_add(1, std::memory_order_release);
+        }
+        node->lock_.unlock();
+        parent->lock_.unlock();
+        grandparent->lock_.unlock();
+        if (!valid) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+template <typename T>
+int ConcurrentTreeSet<T>::heightHelper(const Node* tree) {
+    // if we are at null it has no height
+    if (tree == nullptr) {
+        return -1;
+    }
+    return 1 + max(heightHelper(tree->children_[LEFT].load()),
+                   heightHelper(tree->children_[RIGHT].load()));
+}
+
+template <typename T>
+int ConcurrentTreeSet<T>::height() const {
+    return heightHelper(head_.children_[RIGHT].load());
+}
+
+#endif
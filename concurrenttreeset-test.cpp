@@ -0,0 +1,234 @@
+#include <atomic>
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Include the testing-logger library from
+// the CS70 system directory in Docker.
+#include <cs70/testinglogger.hpp>
+
+#include "concurrenttreeset.hpp"
+
+using namespace std;
+
+///////////////////////////////////////////////////////////
+//  TESTING
+///////////////////////////////////////////////////////////
+
+
+bool insertTest() {
+    TestingLogger log("insert");
+
+    ConcurrentTreeSet<string> mySet;
+
+    affirm(mySet.insert("Isaac"));
+    affirm(mySet.size() == 1);
+
+    affirm(mySet.insert("Tejus"));
+    affirm(!mySet.insert("Tejus"));
+    affirm(mySet.exists("Tejus") == true);
+    affirm(!mySet.exists("Tejas"));
+    affirm(mySet.size() == 2);
+
+    return log.summarize();
+}
+
+bool sortedInsertTest() {
+    TestingLogger log("sorted insert");
+
+    // rotations keep sorted input from building a list
+    ConcurrentTreeSet<int> mySet(9);
+    for (int i = 0; i < 5000; ++i) {
+        mySet.insert(i);
+    }
+    affirm(mySet.size() == 5000);
+    affirm(mySet.height() < 50);
+    affirm(mySet.exists(4999));
+
+    return log.summarize();
+}
+
+bool concurrentInsertTest() {
+    TestingLogger log("concurrent insert");
+
+    ConcurrentTreeSet<int> mySet(3);
+    mySet.insert(-1);
+    const int THREADS = 4;
+    const int PER_THREAD = 5000;
+
+    // every key is inserted by two threads; exactly one of them wins
+    vector<thread> threads;
+    vector<int> wins(THREADS, 0);
+    for (int t = 0; t < THREADS; ++t) {
+        threads.emplace_back([&mySet, &wins, t]() {
+            for (int i = 0; i < PER_THREAD; ++i) {
+                int key = (i * THREADS + t / 2) * 7919 % 100003;
+                if (mySet.insert(key)) {
+                    ++wins[t];
+                }
+            }
+        });
+    }
+    bool neverLost = true;
+    threads.emplace_back([&mySet, &neverLost]() {
+        // keys inserted before the writers start must stay visible
+        for (int round = 0; round < 200; ++round) {
+            neverLost = neverLost && mySet.exists(-1);
+        }
+    });
+    for (thread& t : threads) {
+        t.join();
+    }
+
+    int totalWins = 0;
+    for (int w : wins) {
+        totalWins += w;
+    }
+    affirm(neverLost);
+    affirm(totalWins == THREADS / 2 * PER_THREAD);
+    affirm(mySet.size() == static_cast<size_t>(totalWins) + 1);
+    affirm(mySet.exists(0));
+    affirm(mySet.height() < 60);
+
+    return log.summarize();
+}
+
+bool concurrentReadTest() {
+    TestingLogger log("concurrent read");
+
+    // even keys are there from the start; each writer adds its own odd
+    // keys in a scrambled order and publishes how many it has finished
+    const int WRITERS = 4;
+    const int READERS = 3;
+    const int OLD = 2000;
+    const int PER_WRITER = 4000;
+    const int RANGE = 2 * WRITERS * PER_WRITER;
+    ConcurrentTreeSet<int> mySet(5);
+    for (int i = 0; i < OLD; ++i) {
+        mySet.insert(2 * i);
+    }
+
+    vector<vector<int>> written(WRITERS);
+    vector<std::atomic<int>> finished(WRITERS);
+    for (int w = 0; w < WRITERS; ++w) {
+        finished[w].store(0);
+        for (int i = 0; i < PER_WRITER; ++i) {
+            int slot = (i * 7919) % PER_WRITER;
+            written[w].push_back(2 * (slot * WRITERS + w) + 1);
+        }
+    }
+    std::atomic<int> writing(WRITERS);
+
+    vector<thread> threads;
+    for (int w = 0; w < WRITERS; ++w) {
+        threads.emplace_back([&, w]() {
+            for (int key : written[w]) {
+                mySet.insert(key);
+                finished[w].store(finished[w].load() + 1,
+                                  std::memory_order_release);
+            }
+            --writing;
+        });
+    }
+
+    vector<int> failures(READERS, 0);
+    for (int r = 0; r < READERS; ++r) {
+        threads.emplace_back([&, r]() {
+            size_t lastSize = 0;
+            int step = r;
+            // keep going a while after the writers, in case they finish
+            // before this thread gets started
+            while (writing.load() > 0 || step < 5000) {
+                ++step;
+                int w = step % WRITERS;
+                // read the progress before the size, so the size has to
+                // count at least the keys already published
+                int done = finished[w].load(std::memory_order_acquire);
+                size_t atLeast = OLD + done;
+                size_t now = mySet.size();
+                if (now < lastSize || now < atLeast) {
+                    ++failures[r];
+                }
+                lastSize = now;
+
+                // keys from the start and keys already published must be
+                // found, however the tree is rotating around them
+                if (!mySet.exists(2 * (step * 31 % OLD))) {
+                    ++failures[r];
+                }
+                if (done > 0 && !mySet.exists(written[w][step % done])) {
+                    ++failures[r];
+                }
+
+                // the key being inserted now may or may not be there yet,
+                // but once it is seen it must stay visible
+                if (done < PER_WRITER) {
+                    int racing = written[w][done];
+                    if (mySet.exists(racing) && !mySet.exists(racing)) {
+                        ++failures[r];
+                    }
+                }
+                // odd keys past the writers' range never appear
+                if (mySet.exists(RANGE + 2 * step + 1)) {
+                    ++failures[r];
+                }
+            }
+        });
+    }
+    for (thread& t : threads) {
+        t.join();
+    }
+
+    for (int f : failures) {
+        affirm(f == 0);
+    }
+
+    // the final contents are exactly the start plus every writer's keys
+    vector<bool> expected(RANGE + 1, false);
+    for (int i = 0; i < OLD; ++i) {
+        expected[2 * i] = true;
+    }
+    for (const vector<int>& keys : written) {
+        for (int key : keys) {
+            expected[key] = true;
+        }
+    }
+    int mismatches = 0;
+    size_t count = 0;
+    for (int key = 0; key <= RANGE; ++key) {
+        if (mySet.exists(key) != expected[key]) {
+            ++mismatches;
+        }
+        count += expected[key];
+    }
+    affirm(mismatches == 0);
+    affirm(mySet.size() == count);
+
+    return log.summarize();
+}
+
+/*
+ * Test the ConcurrentTreeSet
+ *//*
+ * Test the ConcurrentTreeSet
+ */
+int main(int, char**) {
+    TestingLogger alltests("All tests");
+
+
+    affirm(insertTest());
+
+    affirm(sortedInsertTest());
+
+    affirm(concurrentInsertTest());
+
+    affirm(concurrentReadTest());
+
+    if (alltests.summarize(true)) {
+        return 0;  // Error code of 0 == Success!
+    } else {
+        return 2;  // Arbitrarily chosen exit code of 2 means tests failed.
+    }
+}
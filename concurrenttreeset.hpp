@@ -0,0 +1,162 @@
+#ifndef CONCURRENTTREESET_HPP_INCLUDED
+
+#define CONCURRENTTREESET_HPP_INCLUDED
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+using namespace std;
+
+/**
+* \brief Sorted set that many threads can search and insert into at once
+*
+* The tree is a treap. exists() never takes a lock: each node carries a
+* version number that writers make odd while they restructure it, and a
+* reader that sees a version change under it starts its descent again.
+* insert() links the new node under a lock on its parent alone, then
+* rotates it up to heap order holding only the three nodes each rotation
+* touches. Nodes are never removed, so readers need no reclamation
+* scheme. Per-node subtree sizes would make every insert write to the
+* root, so the set keeps one atomic element count instead.
+**/
+template <typename T>
+class ConcurrentTreeSet {
+ public:
+    ConcurrentTreeSet();
+    explicit ConcurrentTreeSet(size_t seed);
+    ~ConcurrentTreeSet();
+    ConcurrentTreeSet(const ConcurrentTreeSet& orig) = delete;
+    ConcurrentTreeSet& operator=(const ConcurrentTreeSet& rhs) = delete;
+
+    /**
+    * \brief Number of elements inserted so far
+    * \param None
+    * \returns size of set
+    **/
+    size_t size() const;
+
+    /**
+    * \brief Insert element unless already present; safe from any thread
+    * \param T to insert
+    * \returns whether the element was inserted
+    **/
+    bool insert(const T& t);
+
+    /**
+    * \brief Check whether T exists, without taking any lock
+    * \param T to check
+    * \returns boolean whether element exists or not
+    **/
+    bool exists(const T& t) const;
+
+    /**
+    * \brief Calculate height of the tree (call only when no writer runs)
+    * \param None
+    * \returns height of tree
+    **/
+    int height() const;
+
+ private:
+    struct Node;
+
+    // Which way to go from a node
+    enum direction { LEFT = 0, RIGHT = 1 };
+
+    /**
+    * \brief Lock small enough to live in every node
+    **/
+    class SpinLock {
+     public:
+        SpinLock() = default;
+        SpinLock(const SpinLock&) = delete;
+        SpinLock& operator=(const SpinLock&) = delete;
+
+        bool try_lock();
+        void lock();
+        void unlock();
+
+     private:
+        std::atomic_flag flag_ = ATOMIC_FLAG_INIT;
+    };
+
+    // The part of a node that links it into the tree. The head sentinel
+    // is a bare Link whose right child is the root, so replacing the root
+    // is just another child update.
+    struct Link {
+        std::atomic<uint64_t> version_;  // odd while being restructured
+        std::atomic<Node*> children_[2];  // left and right children
+        std::atomic<Link*> parent_;  // changed only under locks
+        SpinLock lock_;  // held by writers that change this node's links
+
+        Link();
+        Link(const Link&) = delete;
+        Link& operator=(const Link&) = delete;
+        ~Link() = default;
+    };
+
+    struct Node : Link {
+        const T value_;  // T value at node, never changes
+        const uint32_t priority_;  // heap priority, larger is nearer root
+
+        Node(const T& val, uint32_t priority);
+    };
+
+    Link head_;  // sentinel above the root
+    std::atomic<size_t> size_;  // number of elements
+    std::atomic<uint64_t> priorityState_;  // splitmix64 state for priorities
+
+    /**
+    * \brief Draw a random priority; safe to call from several threads
+    * \param None
+    * \returns next value of a splitmix64 generator
+    **/
+    uint32_t nextPriority();
+
+    /**
+    * \brief Read a version once no writer is restructuring the node
+    * \param node to read
+    * \returns its current (even) version
+    **/
+    static uint64_t stableVersion(const Link* node);
+
+    /**
+    * \brief Search optimistically for T or the empty slot it belongs in
+    * \param T to find, outputs for the last node and its version
+    * \returns the node holding T, or nullptr with parent / version set to
+    *          the node whose empty child is T's slot
+    **/
+    Node* descend(const T& val, Link*& parent, uint64_t& version) const;
+
+    /**
+    * \brief Rotate a freshly linked node up until its parent outranks it
+    * \param node to move up
+    * \returns void
+    **/
+    void bubbleUp(Node* node);
+
+    /**
+    * \brief Which child of parent a node is
+    * \param parent and child
+    * \returns LEFT or RIGHT
+    **/
+    static direction sideOf(const Link* parent, const Node* child);
+
+    /**
+    * \brief Delete a subtree (only from the destructor)
+    * \param root of the subtree
+    * \returns void
+    **/
+    static void deleteHelper(Node* tree);
+
+    /**
+    * \brief Calculate height of a subtree
+    * \param root of the subtree
+    * \returns height of the subtree
+    **/
+    static int heightHelper(const Node* tree);
+};
+
+#endif  // CONCURRENTTREESET_HPP_INCLUDED
+
+#include "concurrenttreeset-private.hpp"
@@ -0,0 +1,140 @@
+#ifndef FROZENSET_PRIVATE_HPP_INCLUDED
+
+#define FROZENSET_PRIVATE_HPP_INCLUDED
+
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <type_traits>
+#include <vector>
+
+using namespace std;
+
+template <typename T, typename Compare>
+FrozenSet<T, Compare>::FrozenSet() : size_(0), comp_() { }
+
+template <typename T, typename Compare>
+template <typename ForwardIt>
+FrozenSet<T, Compare>::FrozenSet(ForwardIt first, ForwardIt last,
+                                 const Compare& comp)
+    : size_(std::distance(first, last)), comp_(comp) {
+    if (size_ == 0) {
+        return;
+    }
+    // copies of the first element stand in until the real values land
+    data_.assign(size_ + 1, *first);
+    fillHelper(first, 1);
+}
+
+template <typename T, typename Compare>
+template <typename ForwardIt>
+void FrozenSet<T, Compare>::fillHelper(ForwardIt& iter, size_t k) {
+    // an in-order walk of the implicit tree consumes the sorted range
+    if (k <= size_) {
+        fillHelper(iter, 2 * k);
+        data_[k] = *iter;
+        ++iter;
+        fillHelper(iter, 2 * k + 1);
+    }
+}
+
+template <typename T, typename Compare>
+size_t FrozenSet<T, Compare>::size() const {
+    return size_;
+}
+
+template <typename T, typename Compare>
+size_t FrozenSet<T, Compare>::lowerBoundIndex(const T& val) const {
+    // PER_LINE slots fit in a cache line, and for arithmetic T (the only
+    // ones prefetched) it is a power of two, 2^d. The descendants of k
+    // that are d levels down sit side by side at indices k * PER_LINE up
+    // to k * PER_LINE + PER_LINE - 1, so fetching index k * PER_LINE now
+    // loads the line the descent will reach d steps later.
+    constexpr size_t PER_LINE = (sizeof(T) < 64) ? 64 / sizeof(T) : 1;
+    const T* base = data_.data();
+    size_t k = 1;
+    while (k <= size_) {
+        if (std::is_arithmetic<T>::value && k * PER_LINE <= size_) {
+            __builtin_prefetch(base + k * PER_LINE);
+        }
+        // no branch on the comparison: step left or right arithmetically
+        k = 2 * k + static_cast<size_t>(comp_(base[k], val));
+    }
+    // undo the final run of right steps plus the last left step
+    k >>= __builtin_ffsll(static_cast<long long>(~k));
+    return k;
+}
+
+template <typename T, typename Compare>
+bool FrozenSet<T, Compare>::exists(const T& val) const {
+    size_t k = lowerBoundIndex(val);
+    return k != 0 && !comp_(val, data_[k]);
+}
+
+template <typename T, typename Compare>
+typename FrozenSet<T, Compare>::iterator
+FrozenSet<T, Compare>::lower_bound(const T& val) const {
+    return Iterator(this, lowerBoundIndex(val));
+}
+
+template <typename T, typename Compare>
+typename FrozenSet<T, Compare>::iterator FrozenSet<T, Compare>::begin() const {
+    if (size_ == 0) {
+        return end();
+    }
+    // the smallest element is at the end of the leftmost path
+    size_t k = 1;
+    while (2 * k <= size_) {
+        k = 2 * k;
+    }
+    return Iterator(this, k);
+}
+
+template <typename T, typename Compare>
+typename FrozenSet<T, Compare>::iterator FrozenSet<T, Compare>::end() const {
+    return Iterator(this, 0);
+}
+
+template <typename T, typename Compare>
+FrozenSet<T, Compare>::Iterator::Iterator(const FrozenSet* set, size_t index)
+    : set_(set), index_(index) {
+    // Nothing else to do.
+}
+
+template <typename T, typename Compare>
+typename FrozenSet<T, Compare>::Iterator&
+FrozenSet<T, Compare>::Iterator::operator++() {
+    size_t n = set_->size_;
+    if (2 * index_ + 1 <= n) {  // successor is leftmost in the right tree
+        index_ = 2 * index_ + 1;
+        while (2 * index_ <= n) {
+            index_ = 2 * index_;
+        }
+    } else {  // climb past every right step, then one left step
+        index_ >>= __builtin_ffsll(static_cast<long long>(~index_));
+    }
+    return *this;
+}
+
+template <typename T, typename Compare>
+const T& FrozenSet<T, Compare>::Iterator::operator*() const {
+    return set_->data_[index_];
+}
+
+template <typename T, typename Compare>
+const T* FrozenSet<T, Compare>::Iterator::operator->() const {
+    return &(**this);
+}
+
+template <typename T, typename Compare>
+bool FrozenSet<T, Compare>::Iterator::operator==(const Iterator& rhs) const {
+    return index_ == rhs.index_;
+}
+
+template <typename T, typename Compare>
+bool FrozenSet<T, Compare>::Iterator::operator!=(const Iterator& rhs) const {
+    // Idiomatic code: leverage == to implement !=
+    return !(*this == rhs);
+}
+
+#endif
@@ -0,0 +1,124 @@
+#ifndef FROZENSET_HPP_INCLUDED
+
+#define FROZENSET_HPP_INCLUDED
+
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <vector>
+
+using namespace std;
+
+/**
+* \brief Immutable sorted set stored in Eytzinger (breadth-first) order
+*
+* The element at 1-based index k has its children at 2k and 2k + 1, so a
+* search walks a single contiguous array and the next few levels can be
+* prefetched before they are needed. Built by TreeSet<T>::freeze() or
+* CompactTreeSet<T>::freeze(), and ordered by the same Compare as the set
+* it came from.
+**/
+template <typename T, typename Compare = std::less<T>>
+class FrozenSet {
+ private:
+    // Forward declaration of private class.
+    class Iterator;
+
+ public:
+    // allow users to iterate through the set in sorted order
+    using iterator = Iterator;
+
+    FrozenSet();
+
+    /**
+    * \brief Build from a sorted range of distinct elements
+    * \param first, last range to copy (forward iterators), their order
+    **/
+    template <typename ForwardIt>
+    FrozenSet(ForwardIt first, ForwardIt last,
+              const Compare& comp = Compare());
+
+    FrozenSet(const FrozenSet& orig) = default;
+    FrozenSet(FrozenSet&& orig) = default;
+    FrozenSet& operator=(const FrozenSet& rhs) = default;
+    FrozenSet& operator=(FrozenSet&& rhs) = default;
+    ~FrozenSet() = default;
+
+    /**
+    * \brief Number of elements in the set
+    * \param None
+    * \returns size of set
+    **/
+    size_t size() const;
+
+    /**
+    * \brief Check whether T exists in the set
+    * \param T to check
+    * \returns boolean whether element exists or not
+    **/
+    bool exists(const T& t) const;
+
+    /**
+    * \brief Find the first element that is not less than T
+    * \param T to search for
+    * \returns iterator to that element, or end() if there is none
+    **/
+    iterator lower_bound(const T& t) const;
+
+    // An iterator that refers to the smallest element
+    iterator begin() const;
+    // An iterator that refers to just past the largest element
+    iterator end() const;
+
+ private:
+    // elements in Eytzinger order; index 0 is unused padding
+    std::vector<T> data_;
+    size_t size_;
+    Compare comp_;  // order the range was sorted in
+
+    /**
+    * \brief Fill the subtree rooted at index k from an in-order range
+    * \param iterator to the next sorted element, index k to fill
+    * \returns void
+    **/
+    template <typename ForwardIt>
+    void fillHelper(ForwardIt& iter, size_t k);
+
+    /**
+    * \brief Branchless descent to the first element not less than T
+    * \param T to search for
+    * \returns 1-based index of that element, or 0 if there is none
+    **/
+    size_t lowerBoundIndex(const T& t) const;
+
+    class Iterator {
+     public:
+        using value_type = T;
+        using reference = const value_type&;
+        using pointer = const value_type*;
+        using difference_type = std::ptrdiff_t;
+        using iterator_category = std::forward_iterator_tag;
+
+        Iterator() = default;
+        Iterator(const Iterator&) = default;
+        Iterator& operator=(const Iterator&) = default;
+        ~Iterator() = default;
+
+        Iterator& operator++();
+        reference operator*() const;
+        pointer operator->() const;
+        bool operator==(const Iterator& rhs) const;
+        bool operator!=(const Iterator& rhs) const;
+
+     private:
+        friend class FrozenSet;
+        Iterator(const FrozenSet* set, size_t index);
+        // Friends create non-default iterators
+        const FrozenSet* set_;  // set we walk
+        size_t index_;  // 1-based Eytzinger index, 0 at end()
+    };
+};
+
+#endif  // FROZENSET_HPP_INCLUDED
+
+#include "frozenset-private.hpp"
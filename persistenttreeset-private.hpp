@@ -0,0 +1,294 @@
+#ifndef PERSISTENTTREESET_PRIVATE_HPP_INCLUDED
+
+#define PERSISTENTTREESET_PRIVATE_HPP_INCLUDED
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+template <typename T>
+PersistentTreeSet<T>::PersistentTreeSet()
+    : root_(nullptr), priorityState_(0) { }
+
+template <typename T>
+PersistentTreeSet<T>::PersistentTreeSet(size_t seed)
+    : root_(nullptr), priorityState_(seed) { }
+
+template <typename T>
+PersistentTreeSet<T>::Node::Node(const T& val, uint32_t priority,
+                                 NodePtr left, NodePtr right)
+    : value_(val), priority_(priority), leftChild_(std::move(left)),
+      rightChild_(std::move(right)),
+      size_(1 + sizeOf(leftChild_) + sizeOf(rightChild_)) {
+    // nothing else to do
+}
+
+template <typename T>
+uint32_t PersistentTreeSet<T>::nextPriority() {
+    // splitmix64 only ever adds a constant to its state, so fetch_add
+    // makes it safe to share between writers
+    uint64_t z = priorityState_.fetch_add(0x9E3779B97F4A7C15ULL)
+                 + 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return static_cast<uint32_t>((z ^ (z >> 31)) >> 32);
+}
+
+template <typename T>
+typename PersistentTreeSet<T>::NodePtr
+PersistentTreeSet<T>::loadRoot() const {
+#ifdef __cpp_lib_atomic_shared_ptr
+    return root_.load();
+#else
+    return std::atomic_load(&root_);
+#endif
+}
+
+template <typename T>
+bool PersistentTreeSet<T>::publishRoot(NodePtr& expected,
+                                       const NodePtr& updated) {
+#ifdef __cpp_lib_atomic_shared_ptr
+    return root_.compare_exchange_weak(expected, updated);
+#else
+    return std::atomic_compare_exchange_weak(&root_, &expected, updated);
+#endif
+}
+
+template <typename T>
+size_t PersistentTreeSet<T>::sizeOf(const NodePtr& tree) {
+    return (tree == nullptr) ? 0 : tree->size_;
+}
+
+template <typename T>
+typename PersistentTreeSet<T>::Snapshot
+PersistentTreeSet<T>::snapshot() const {
+    return Snapshot(loadRoot());
+}
+
+template <typename T>
+size_t PersistentTreeSet<T>::size() const {
+    return sizeOf(loadRoot());
+}
+
+template <typename T>
+bool PersistentTreeSet<T>::exists(const T& val) const {
+    NodePtr root = loadRoot();
+    return existsHelper(root.get(), val);
+}
+
+template <typename T>
+bool PersistentTreeSet<T>::existsHelper(const Node* tree, const T& val) {
+    while (tree != nullptr) {
+        if (val < tree->value_) {
+            tree = tree->leftChild_.get();
+        } else if (tree->value_ < val) {
+            tree = tree->rightChild_.get();
+        } else {
+            return true;
+        }
+    }
+    return false;
+}
+
+template <typename T>
+typename PersistentTreeSet<T>::NodePtr
+PersistentTreeSet<T>::insertHelper(const NodePtr& tree, const T& val,
+                                   uint32_t priority, bool& inserted) {
+    if (tree == nullptr) {
+        inserted = true;
+        return std::make_shared<const Node>(val, priority, nullptr, nullptr);
+    }
+    if (val < tree->value_) {
+        NodePtr left = insertHelper(tree->leftChild_, val, priority, inserted);
+        if (!inserted) {  // nothing changed below, so share this subtree
+            return tree;
+        }
+        if (left->priority_ > tree->priority_) {  // rotate right by copying
+            NodePtr lowered = std::make_shared<const Node>(
+                tree->value_, tree->priority_, left->rightChild_,
+                tree->rightChild_);
+            return std::make_shared<const Node>(left->value_, left->priority_,
+                                                left->leftChild_, lowered);
+        }
+        return std::make_shared<const Node>(tree->value_, tree->priority_,
+                                            left, tree->rightChild_);
+    } else if (tree->value_ < val) {
+        NodePtr right = insertHelper(tree->rightChild_, val, priority,
+                                     inserted);
+        if (!inserted) {
+            return tree;
+        }
+        if (right->priority_ > tree->priority_) {  // rotate left by copying
+            NodePtr lowered = std::make_shared<const Node>(
+                tree->value_, tree->priority_, tree->leftChild_,
+                right->leftChild_);
+            return std::make_shared<const Node>(right->value_,
+                                                right->priority_, lowered,
+                                                right->rightChild_);
+        }
+        return std::make_shared<const Node>(tree->value_, tree->priority_,
+                                            tree->leftChild_, right);
+    }
+    // already present: this version is also the new one
+    return tree;
+}
+
+template <typename T>
+typename PersistentTreeSet<T>::NodePtr
+PersistentTreeSet<T>::joinHelper(const NodePtr& left, const NodePtr& right) {
+    if (left == nullptr) {
+        return right;
+    } else if (right == nullptr) {
+        return left;
+    }
+    // the higher priority root stays on top to keep heap order
+    if (left->priority_ > right->priority_) {
+        return std::make_shared<const Node>(
+            left->value_, left->priority_, left->leftChild_,
+            joinHelper(left->rightChild_, right));
+    }
+    return std::make_shared<const Node>(
+        right->value_, right->priority_,
+        joinHelper(left, right->leftChild_), right->rightChild_);
+}
+
+template <typename T>
+typename PersistentTreeSet<T>::NodePtr
+PersistentTreeSet<T>::eraseHelper(const NodePtr& tree, const T& val,
+                                  bool& erased) {
+    if (tree == nullptr) {
+        return tree;
+    }
+    if (val < tree->value_) {
+        NodePtr left = eraseHelper(tree->leftChild_, val, erased);
+        if (!erased) {
+            return tree;
+        }
+        return std::make_shared<const Node>(tree->value_, tree->priority_,
+                                            left, tree->rightChild_);
+    } else if (tree->value_ < val) {
+        NodePtr right = eraseHelper(tree->rightChild_, val, erased);
+        if (!erased) {
+            return tree;
+        }
+        return std::make_shared<const Node>(tree->value_, tree->priority_,
+                                            tree->leftChild_, right);
+    }
+    erased = true;
+    return joinHelper(tree->leftChild_, tree->rightChild_);
+}
+
+template <typename T>
+bool PersistentTreeSet<T>::insert(const T& val) {
+    uint32_t priority = nextPriority();
+    NodePtr expected = loadRoot();
+    while (true) {
+        bool inserted = false;
+        NodePtr updated = insertHelper(expected, val, priority, inserted);
+        if (!inserted) {
+            return false;
+        }
+        // publish only if no other writer got there first; on failure
+        // expected now holds the winner's root, so rebuild against it
+        if (publishRoot(expected, updated)) {
+            return true;
+        }
+    }
+}
+
+template <typename T>
+bool PersistentTreeSet<T>::erase(const T& val) {
+    NodePtr expected = loadRoot();
+    while (true) {
+        bool erased = false;
+        NodePtr updated = eraseHelper(expected, val, erased);
+        if (!erased) {
+            return false;
+        }
+        if (publishRoot(expected, updated)) {
+            return true;
+        }
+    }
+}
+
+template <typename T>
+PersistentTreeSet<T>::Snapshot::Snapshot(NodePtr root)
+    : root_(std::move(root)) {
+    // Nothing else to do.
+}
+
+template <typename T>
+size_t PersistentTreeSet<T>::Snapshot::size() const {
+    return sizeOf(root_);
+}
+
+template <typename T>
+bool PersistentTreeSet<T>::Snapshot::exists(const T& val) const {
+    return existsHelper(root_.get(), val);
+}
+
+template <typename T>
+typename PersistentTreeSet<T>::iterator
+PersistentTreeSet<T>::Snapshot::begin() const {
+    return Iterator(root_.get());
+}
+
+template <typename T>
+typename PersistentTreeSet<T>::iterator
+PersistentTreeSet<T>::Snapshot::end() const {
+    return Iterator(nullptr);
+}
+
+template <typename T>
+PersistentTreeSet<T>::Iterator::Iterator(const Node* root) {
+    pushLeft(root);
+}
+
+template <typename T>
+void PersistentTreeSet<T>::Iterator::pushLeft(const Node* node) {
+    for (; node != nullptr; node = node->leftChild_.get()) {
+        path_.push_back(node);
+    }
+}
+
+template <typename T>
+typename PersistentTreeSet<T>::Iterator&
+PersistentTreeSet<T>::Iterator::operator++() {
+    // the top of path_ is done; its right tree comes next
+    const Node* done = path_.back();
+    path_.pop_back();
+    pushLeft(done->rightChild_.get());
+    return *this;
+}
+
+template <typename T>
+const T& PersistentTreeSet<T>::Iterator::operator*() const {
+    return path_.back()->value_;
+}
+
+template <typename T>
+const T* PersistentTreeSet<T>::Iterator::operator->() const {
+    return &(**this);
+}
+
+template <typename T>
+bool PersistentTreeSet<T>::Iterator::operator==(const Iterator& rhs) const {
+    // positions match when the current nodes do (both empty at end())
+    if (path_.empty() || rhs.path_.empty()) {
+        return path_.empty() == rhs.path_.empty();
+    }
+    return path_.back() == rhs.path_.back();
+}
+
+template <typename T>
+bool PersistentTreeSet<T>::Iterator::operator!=(const Iterator& rhs) const {
+    // Idiomatic code: leverage == to implement !=
+    return !(*this == rhs);
+}
+
+#endif
@@ -0,0 +1,145 @@
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Include the testing-logger library from
+// the CS70 system directory in Docker.
+#include <cs70/testinglogger.hpp>
+
+#include "persistenttreeset.hpp"
+
+using namespace std;
+
+///////////////////////////////////////////////////////////
+//  TESTING
+///////////////////////////////////////////////////////////
+
+
+bool insertTest() {
+    TestingLogger log("insert");
+
+    PersistentTreeSet<string> mySet;
+
+    affirm(mySet.insert("Isaac"));
+    affirm(mySet.size() == 1);
+
+    affirm(mySet.insert("Tejus"));
+    affirm(!mySet.insert("Tejus"));
+    affirm(mySet.exists("Tejus") == true);
+    affirm(mySet.size() == 2);
+
+    return log.summarize();
+}
+
+bool eraseTest() {
+    TestingLogger log("erase");
+
+    PersistentTreeSet<int> mySet(3);
+    for (int i = 0; i < 100; ++i) {
+        mySet.insert((i * 37) % 100);
+    }
+
+    affirm(!mySet.erase(100));
+    for (int i = 0; i < 100; i += 2) {
+        affirm(mySet.erase(i));
+    }
+    affirm(mySet.size() == 50);
+    affirm(!mySet.exists(10));
+    affirm(mySet.exists(11));
+
+    return log.summarize();
+}
+
+bool snapshotTest() {
+    TestingLogger log("snapshot");
+
+    PersistentTreeSet<int> mySet(5);
+    for (int i = 0; i < 10; ++i) {
+        mySet.insert(i);
+    }
+
+    PersistentTreeSet<int>::snapshot_type before = mySet.snapshot();
+    mySet.insert(10);
+    mySet.erase(0);
+
+    // the snapshot still sees the old version
+    affirm(before.size() == 10);
+    affirm(before.exists(0));
+    affirm(!before.exists(10));
+
+    int expected = 0;
+    for (int value : before) {
+        affirm(value == expected);
+        ++expected;
+    }
+    affirm(expected == 10);
+
+    PersistentTreeSet<int>::snapshot_type after = mySet.snapshot();
+    affirm(after.size() == 10);
+    affirm(*after.begin() == 1);
+
+    return log.summarize();
+}
+
+bool concurrentTest() {
+    TestingLogger log("concurrent");
+
+    PersistentTreeSet<int> mySet(7);
+    const int PER_WRITER = 2000;
+
+    // two writers race to publish; readers check each snapshot is sorted
+    vector<thread> threads;
+    for (int w = 0; w < 2; ++w) {
+        threads.emplace_back([&mySet, w]() {
+            for (int i = 0; i < PER_WRITER; ++i) {
+                mySet.insert(2 * i + w);
+            }
+        });
+    }
+    bool sorted = true;
+    threads.emplace_back([&mySet, &sorted]() {
+        for (int round = 0; round < 50; ++round) {
+            PersistentTreeSet<int>::snapshot_type view = mySet.snapshot();
+            size_t count = 0;
+            int last = -1;
+            for (int value : view) {
+                sorted = sorted && (value > last);
+                last = value;
+                ++count;
+            }
+            sorted = sorted && (count == view.size());
+        }
+    });
+    for (thread& t : threads) {
+        t.join();
+    }
+
+    affirm(sorted);
+    affirm(mySet.size() == 2 * PER_WRITER);
+
+    return log.summarize();
+}
+
+/*
+ * Test the PersistentTreeSet
+ */
+int main(int, char**) {
+    TestingLogger alltests("All tests");
+
+
+    affirm(insertTest());
+
+    affirm(eraseTest());
+
+    affirm(snapshotTest());
+
+    affirm(concurrentTest());
+
+    if (alltests.summarize(true)) {
+        return 0;  // Error code of 0 == Success!
+    } else {
+        return 2;  // Arbitrarily chosen exit code of 2 means tests failed.
+    }
+}
@@ -0,0 +1,235 @@
+#ifndef PERSISTENTTREESET_HPP_INCLUDED
+
+#define PERSISTENTTREESET_HPP_INCLUDED
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+using namespace std;
+
+/**
+* \brief Sorted set whose versions share structure through path copying
+*
+* Nodes never change once built. An insert or erase copies only the
+* O(log n) nodes on the path it touches and publishes the new root with
+* an atomic compare-and-swap, so snapshot() is O(1) and readers holding a
+* snapshot never wait for (or see partial work from) any writer. Nodes
+* shared between versions are kept alive by reference counts. The tree is
+* a treap, so expected height is O(log n).
+*
+* Only the walk through a snapshot is lock-free. Loading root_ (done by
+* snapshot(), exists() and size()) copies a shared_ptr atomically, and no
+* standard library does that without a lock: in C++17 the atomic_load
+* overloads take a mutex from a small global pool, shared by every set;
+* std::atomic<shared_ptr>, used when the library offers it (C++20), holds
+* a lock bit in the pointer itself instead. The lock covers the one
+* pointer copy, never a descent, so a reader that runs many queries
+* should take one snapshot and query it.
+**/
+template <typename T>
+class PersistentTreeSet {
+ private:
+    // Forward declaration of private classes.
+    class Snapshot;
+    class Iterator;
+
+ public:
+    // an immutable version of the set
+    using snapshot_type = Snapshot;
+    // allow users to iterate through a snapshot
+    using iterator = Iterator;
+
+    PersistentTreeSet();
+    explicit PersistentTreeSet(size_t seed);
+    ~PersistentTreeSet() = default;
+    PersistentTreeSet(const PersistentTreeSet& orig) = delete;
+    PersistentTreeSet& operator=(const PersistentTreeSet& rhs) = delete;
+
+    /**
+    * \brief Capture the current contents in O(1)
+    * \param None
+    * \returns Snapshot that later inserts and erases do not affect
+    *
+    * Briefly takes a lock to copy the root (see the class comment).
+    **/
+    Snapshot snapshot() const;
+
+    /**
+    * \brief Insert element unless already present
+    * \param T to insert
+    * \returns whether the element was inserted
+    *
+    * Safe to call from several threads at once; a writer that loses the
+    * race to publish its new root retries against the winner's version.
+    **/
+    bool insert(const T& t);
+
+    /**
+    * \brief Remove element if present
+    * \param T to remove
+    * \returns whether the element was removed
+    **/
+    bool erase(const T& t);
+
+    /**
+    * \brief Check whether T exists in the current version
+    * \param T to check
+    * \returns boolean whether element exists or not
+    *
+    * Copies the root as snapshot() does, then walks without locking.
+    **/
+    bool exists(const T& t) const;
+
+    /**
+    * \brief Size of the current version
+    * \param None
+    * \returns number of elements
+    **/
+    size_t size() const;
+
+ private:
+    struct Node;
+    using NodePtr = std::shared_ptr<const Node>;
+
+    struct Node {
+        const T value_;  // T value at node
+        const uint32_t priority_;  // heap priority, larger is nearer root
+        const NodePtr leftChild_;  // left Tree of node
+        const NodePtr rightChild_;  // right Tree of node
+        const size_t size_;  // size of subtree with Node as root
+
+        Node(const T& val, uint32_t priority, NodePtr left, NodePtr right);
+        Node() = delete;
+        Node(const Node&) = delete;
+        Node& operator=(const Node&) = delete;
+        ~Node() = default;
+    };
+
+    // newest version; read and written only through loadRoot and
+    // publishRoot
+#ifdef __cpp_lib_atomic_shared_ptr
+    std::atomic<NodePtr> root_;
+#else
+    NodePtr root_;
+#endif
+    std::atomic<uint64_t> priorityState_;  // splitmix64 state for priorities
+
+    /**
+    * \brief Read the newest version atomically
+    * \param None
+    * \returns root of the newest version
+    **/
+    NodePtr loadRoot() const;
+
+    /**
+    * \brief Replace the newest version, unless a writer got there first
+    * \param root the new version was built from (set to the winner's on
+    *        failure), root of the new version
+    * \returns whether the new version was published
+    **/
+    bool publishRoot(NodePtr& expected, const NodePtr& updated);
+
+    /**
+    * \brief Draw a random priority; safe to call from several threads
+    * \param None
+    * \returns next value of a splitmix64 generator
+    **/
+    uint32_t nextPriority();
+
+    /**
+    * \brief Size of a possibly empty subtree
+    * \param root of the subtree
+    * \returns its size_, or 0 for nullptr
+    **/
+    static size_t sizeOf(const NodePtr& tree);
+
+    /**
+    * \brief Build a new version of a subtree with one more element
+    * \param subtree, T to add, its priority, set true if T was added
+    * \returns root of the new version (tree itself if T was present)
+    **/
+    static NodePtr insertHelper(const NodePtr& tree, const T& val,
+                                uint32_t priority, bool& inserted);
+
+    /**
+    * \brief Build a new version of a subtree with one element removed
+    * \param subtree, T to remove, set true if T was removed
+    * \returns root of the new version (tree itself if T was absent)
+    **/
+    static NodePtr eraseHelper(const NodePtr& tree, const T& val,
+                               bool& erased);
+
+    /**
+    * \brief Join two treaps, copying the spine where they meet
+    * \param left and right trees, every left value below every right one
+    * \returns root of the joined tree
+    **/
+    static NodePtr joinHelper(const NodePtr& left, const NodePtr& right);
+
+    /**
+    * \brief Check whether value exists in a subtree
+    * \param subtree and T to check
+    * \returns whether T is in the subtree
+    **/
+    static bool existsHelper(const Node* tree, const T& val);
+
+    class Snapshot {
+     public:
+        Snapshot() = default;
+        Snapshot(const Snapshot&) = default;
+        Snapshot& operator=(const Snapshot&) = default;
+        ~Snapshot() = default;
+
+        size_t size() const;
+        bool exists(const T& t) const;
+        iterator begin() const;
+        iterator end() const;
+
+     private:
+        friend class PersistentTreeSet;
+        explicit Snapshot(NodePtr root);
+        NodePtr root_;  // keeps every node of this version alive
+    };
+
+    class Iterator {
+     public:
+        using value_type = T;
+        using reference = const value_type&;
+        using pointer = const value_type*;
+        using difference_type = std::ptrdiff_t;
+        using iterator_category = std::forward_iterator_tag;
+
+        Iterator() = default;
+        Iterator(const Iterator&) = default;
+        Iterator& operator=(const Iterator&) = default;
+        ~Iterator() = default;
+
+        Iterator& operator++();
+        reference operator*() const;
+        pointer operator->() const;
+        bool operator==(const Iterator& rhs) const;
+        bool operator!=(const Iterator& rhs) const;
+
+     private:
+        friend class PersistentTreeSet;
+        explicit Iterator(const Node* root);
+        // Nodes have no parent links (they are shared between versions),
+        // so the iterator keeps the path of nodes still to visit.
+        std::vector<const Node*> path_;
+
+        /**
+        * \brief Push a node and its chain of left children onto path_
+        * \param node to start from
+        * \returns void
+        **/
+        void pushLeft(const Node* node);
+    };
+};
+
+#endif  // PERSISTENTTREESET_HPP_INCLUDED
+
+#include "persistenttreeset-private.hpp"
@@ -0,0 +1,516 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "treeset.hpp"
+
+using namespace std;
+
+///////////////////////////////////////////////////////////
+//  BENCHMARKS
+//
+//  Usage: treeset-bench [--json] [--sizes n1,n2,...]
+//
+//  Every (set, key type, key stream, size) combination runs in its own
+//  child process, so one run's heap cannot slow down the next. node_bytes
+//  is the memory holding the set's nodes once it is built, counted as it
+//  is requested: bytesUsed() for a TreeSet (free slots included), and a
+//  counting allocator for std::set. Heap storage a key owns (a long
+//  string's characters) is not included, for either kind of set.
+//  Results go to stdout, one row per operation, as CSV (default) or JSON
+//  Lines (--json).
+///////////////////////////////////////////////////////////
+
+using Clock = std::chrono::steady_clock;
+
+// Sorted and reverse streams turn LEAF and ROOT trees into paths, so
+// larger sizes would measure nothing but O(n^2) descents.
+constexpr size_t DEGENERATE_LIMIT = 20000;
+
+// Zipf exponent for the skewed key stream
+constexpr double ZIPF_EXPONENT = 1.0;
+
+// Sets under test; STD_SET is the baseline
+enum contender { LEAF_TREE, ROOT_TREE, RANDOMIZED_TREE, TREAP_TREE,
+                 WEIGHT_BALANCED_TREE, SPLAY_TREE, SEMI_SPLAY_TREE, STD_SET };
+
+// Orders in which keys arrive
+enum distribution { SORTED, REVERSE, RANDOM, ZIPF };
+
+const char* contenderName(contender c) {
+    static const char* names[] = {"LEAF", "ROOT", "RANDOMIZED", "TREAP",
+                                  "WEIGHT_BALANCED", "SPLAY", "SEMI_SPLAY",
+                                  "std::set"};
+    return names[c];
+}
+
+const char* distributionName(distribution d) {
+    static const char* names[] = {"sorted", "reverse", "random", "zipf"};
+    return names[d];
+}
+
+/**
+* \brief Timings for one operation over one run
+**/
+struct Measurement {
+    string operation;  // what was timed
+    size_t ops = 0;  // how many operations were timed
+    double seconds = 0;  // wall time for all of them
+    vector<uint64_t> latencies;  // per-operation nanoseconds, if sampled
+
+    explicit Measurement(const string& name) : operation(name) { }
+};
+
+/**
+* \brief Everything needed to label a row of output
+**/
+struct RunInfo {
+    contender set;
+    const char* keyType;
+    distribution keys;
+    size_t size;
+};
+
+bool jsonOutput = false;
+
+// Bytes currently allocated through CountingAllocator
+size_t countedBytes = 0;
+
+/**
+* \brief Allocator that keeps countedBytes up to date, for std::set
+**/
+template <typename U>
+struct CountingAllocator {
+    using value_type = U;
+
+    CountingAllocator() = default;
+    template <typename V>
+    CountingAllocator(const CountingAllocator<V>&) { }
+
+    U* allocate(size_t n) {
+        countedBytes += n * sizeof(U);
+        return std::allocator<U>().allocate(n);
+    }
+
+    void deallocate(U* p, size_t n) {
+        countedBytes -= n * sizeof(U);
+        std::allocator<U>().deallocate(p, n);
+    }
+};
+
+template <typename U, typename V>
+bool operator==(const CountingAllocator<U>&, const CountingAllocator<V>&) {
+    return true;
+}
+
+template <typename U, typename V>
+bool operator!=(const CountingAllocator<U>&, const CountingAllocator<V>&) {
+    return false;
+}
+
+// The baseline set, with its node allocations counted
+template <typename K>
+using StdSet = std::set<K, std::less<K>, CountingAllocator<K>>;
+
+// Anything written here cannot be optimized away
+volatile size_t sink = 0;
+
+/**
+* \brief Nanoseconds between two clock readings
+* \param start and stop times
+* \returns elapsed nanoseconds
+**/
+uint64_t nanosBetween(Clock::time_point start, Clock::time_point stop) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start)
+        .count();
+}
+
+/**
+* \brief Find a percentile of sorted latencies
+* \param sorted latencies, percentile in [0, 100]
+* \returns that latency, or 0 if there are none
+**/
+uint64_t percentile(const vector<uint64_t>& sorted, double p) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    size_t index = static_cast<size_t>(p / 100.0 * (sorted.size() - 1));
+    return sorted[index];
+}
+
+/**
+* \brief Print one measurement as a CSV or JSON row
+* \param run labels, measurement, bytes holding the set's nodes
+* \returns void
+**/
+void report(const RunInfo& run, Measurement& m, size_t nodeBytes) {
+    std::sort(m.latencies.begin(), m.latencies.end());
+    double throughput = (m.seconds > 0) ? m.ops / m.seconds : 0;
+    uint64_t p50 = percentile(m.latencies, 50);
+    uint64_t p90 = percentile(m.latencies, 90);
+    uint64_t p99 = percentile(m.latencies, 99);
+    uint64_t max = m.latencies.empty() ? 0 : m.latencies.back();
+    ostringstream row;
+    if (jsonOutput) {
+        row << "{\"set\":\"" << contenderName(run.set) << "\",\"key_type\":\""
+            << run.keyType << "\",\"distribution\":\""
+            << distributionName(run.keys) << "\",\"size\":" << run.size
+            << ",\"operation\":\"" << m.operation << "\",\"ops\":" << m.ops
+            << ",\"seconds\":" << m.seconds << ",\"ops_per_sec\":"
+            << throughput << ",\"p50_ns\":" << p50 << ",\"p90_ns\":" << p90
+            << ",\"p99_ns\":" << p99 << ",\"max_ns\":" << max
+            << ",\"node_bytes\":" << nodeBytes << "}";
+    } else {
+        row << contenderName(run.set) << "," << run.keyType << ","
+            << distributionName(run.keys) << "," << run.size << ","
+            << m.operation << "," << m.ops << "," << m.seconds << ","
+            << throughput << "," << p50 << "," << p90 << "," << p99 << ","
+            << max << "," << nodeBytes;
+    }
+    // one write per row keeps rows whole when children share stdout
+    row << "\n";
+    fputs(row.str().c_str(), stdout);
+    fflush(stdout);
+}
+
+/**
+* \brief Draw ranks from a Zipf distribution over [0, n)
+* \param number of ranks, number of draws, random engine
+* \returns the draws; rank 0 is the most frequent
+**/
+vector<size_t> zipfRanks(size_t n, size_t count, std::mt19937_64& engine) {
+    vector<double> cumulative(n);
+    double total = 0;
+    for (size_t i = 0; i < n; ++i) {
+        total += 1.0 / std::pow(static_cast<double>(i + 1), ZIPF_EXPONENT);
+        cumulative[i] = total;
+    }
+    std::uniform_real_distribution<double> uniform(0.0, total);
+    vector<size_t> ranks(count);
+    for (size_t& rank : ranks) {
+        rank = std::lower_bound(cumulative.begin(), cumulative.end(),
+                                uniform(engine)) - cumulative.begin();
+        rank = std::min(rank, n - 1);
+    }
+    return ranks;
+}
+
+/**
+* \brief Make the ids of a key stream; equal ids mean equal keys
+* \param distribution, stream length, random engine
+* \returns ids in arrival order
+**/
+vector<size_t> keyIds(distribution d, size_t n, std::mt19937_64& engine) {
+    vector<size_t> ids(n);
+    for (size_t i = 0; i < n; ++i) {
+        ids[i] = i;
+    }
+    if (d == REVERSE) {
+        std::reverse(ids.begin(), ids.end());
+    } else if (d == RANDOM) {
+        std::shuffle(ids.begin(), ids.end(), engine);
+    } else if (d == ZIPF) {
+        // scatter the popular ranks so hot keys are not neighbours
+        vector<size_t> scatter = ids;
+        std::shuffle(scatter.begin(), scatter.end(), engine);
+        vector<size_t> ranks = zipfRanks(n, n, engine);
+        for (size_t i = 0; i < n; ++i) {
+            ids[i] = scatter[ranks[i]];
+        }
+    }
+    return ids;
+}
+
+/**
+* \brief Turn a key id into a key; ids and keys sort the same way
+* \param id of the key
+* \returns the key
+**/
+template <typename K>
+K makeKey(size_t id);
+
+template <>
+int makeKey<int>(size_t id) {
+    // spread keys out so absent keys fall between present ones
+    return static_cast<int>(2 * id);
+}
+
+template <>
+string makeKey<string>(size_t id) {
+    // zero padding makes string order match numeric order
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "key-%012zu", 2 * id);
+    return buffer;
+}
+
+// Uniform interface over TreeSet and std::set
+template <typename K>
+bool contains(const TreeSet<K>& s, const K& key) {
+    return s.exists(key);
+}
+
+template <typename K>
+bool contains(const StdSet<K>& s, const K& key) {
+    return s.count(key) != 0;
+}
+
+template <typename K>
+void containsAll(const TreeSet<K>& s, const vector<K>& keys,
+                 vector<bool>& found) {
+    s.existsBatch(keys.data(), keys.size(), found);
+}
+
+template <typename K>
+void containsAll(const StdSet<K>& s, const vector<K>& keys,
+                 vector<bool>& found) {
+    found.assign(keys.size(), false);
+    for (size_t i = 0; i < keys.size(); ++i) {
+        found[i] = s.count(keys[i]) != 0;
+    }
+}
+
+template <typename K>
+unique_ptr<TreeSet<K>> makeSet(contender c, TreeSet<K>*) {
+    static const treetype types[] = {treetype::LEAF, treetype::ROOT,
+                                     treetype::RANDOMIZED, treetype::TREAP,
+                                     treetype::WEIGHT_BALANCED,
+                                     treetype::SPLAY, treetype::SEMI_SPLAY};
+    return unique_ptr<TreeSet<K>>(new TreeSet<K>(types[c], 42));
+}
+
+template <typename K>
+unique_ptr<StdSet<K>> makeSet(contender, StdSet<K>*) {
+    return unique_ptr<StdSet<K>>(new StdSet<K>());
+}
+
+// Memory holding a set's nodes
+template <typename K>
+size_t nodeBytes(const TreeSet<K>& s) {
+    return s.bytesUsed();
+}
+
+template <typename K>
+size_t nodeBytes(const StdSet<K>&) {
+    // the set is the only user of CountingAllocator in this process
+    return countedBytes;
+}
+
+/**
+* \brief Time inserts, lookups, iteration, equality and teardown for a set
+* \param run labels, keys in arrival order
+* \returns void
+**/
+template <typename Set, typename K>
+void benchSet(const RunInfo& run, const vector<K>& keys) {
+    std::mt19937_64 engine(7);
+    unique_ptr<Set> set = makeSet(run.set, static_cast<Set*>(nullptr));
+    vector<Measurement> results;
+
+    Measurement insert("insert");
+    insert.latencies.assign(keys.size(), 0);
+    Clock::time_point begin = Clock::now();
+    for (size_t i = 0; i < keys.size(); ++i) {
+        Clock::time_point start = Clock::now();
+        set->insert(keys[i]);
+        insert.latencies[i] = nanosBetween(start, Clock::now());
+    }
+    insert.seconds = nanosBetween(begin, Clock::now()) / 1e9;
+    insert.ops = keys.size();
+    size_t setBytes = nodeBytes(*set);
+    results.push_back(std::move(insert));
+
+    // look up the same stream in a new order: every lookup hits
+    vector<K> queries = keys;
+    std::shuffle(queries.begin(), queries.end(), engine);
+    Measurement exists("exists");
+    exists.latencies.reserve(queries.size());
+    size_t found = 0;
+    begin = Clock::now();
+    for (const K& key : queries) {
+        Clock::time_point start = Clock::now();
+        found += contains(*set, key);
+        exists.latencies.push_back(nanosBetween(start, Clock::now()));
+    }
+    exists.seconds = nanosBetween(begin, Clock::now()) / 1e9;
+    exists.ops = queries.size();
+    sink = sink + found;
+    results.push_back(std::move(exists));
+
+    // the same lookups as one batch, timed once and counted per key
+    Measurement batch("existsBatch");
+    vector<bool> hits;
+    begin = Clock::now();
+    containsAll(*set, queries, hits);
+    batch.seconds = nanosBetween(begin, Clock::now()) / 1e9;
+    batch.ops = queries.size();
+    sink = sink + hits.size();
+    results.push_back(std::move(batch));
+
+    // whole-set operations are timed once and counted per element
+    Measurement iterate("iterate");
+    size_t visited = 0;
+    begin = Clock::now();
+    for (const K& key : *set) {
+        sink = sink + sizeof(key);
+        ++visited;
+    }
+    iterate.seconds = nanosBetween(begin, Clock::now()) / 1e9;
+    iterate.ops = visited;
+    results.push_back(std::move(iterate));
+
+    // rebuild from the sorted elements, hinting each at the one before
+    unique_ptr<Set> copy = makeSet(run.set, static_cast<Set*>(nullptr));
+    Measurement hinted("hintedInsert");
+    begin = Clock::now();
+    auto hint = copy->end();
+    for (const K& key : *set) {
+        hint = copy->insert(hint, key);
+    }
+    hinted.seconds = nanosBetween(begin, Clock::now()) / 1e9;
+    hinted.ops = visited;
+    results.push_back(std::move(hinted));
+
+    Measurement equality("equality");
+    begin = Clock::now();
+    sink = sink + (*set == *copy);
+    equality.seconds = nanosBetween(begin, Clock::now()) / 1e9;
+    equality.ops = visited;
+    results.push_back(std::move(equality));
+    copy.reset();
+
+    Measurement teardown("teardown");
+    begin = Clock::now();
+    set.reset();
+    teardown.seconds = nanosBetween(begin, Clock::now()) / 1e9;
+    teardown.ops = visited;
+    results.push_back(std::move(teardown));
+
+    for (Measurement& m : results) {
+        report(run, m, setBytes);
+    }
+}
+
+/**
+* \brief Build the key stream for a run and benchmark its set
+* \param run labels
+* \returns void
+**/
+template <typename K>
+void benchRun(const RunInfo& run) {
+    std::mt19937_64 engine(run.size);
+    vector<size_t> ids = keyIds(run.keys, run.size, engine);
+    vector<K> keys;
+    keys.reserve(ids.size());
+    for (size_t id : ids) {
+        keys.push_back(makeKey<K>(id));
+    }
+    if (run.set == STD_SET) {
+        benchSet<StdSet<K>>(run, keys);
+    } else {
+        benchSet<TreeSet<K>>(run, keys);
+    }
+}
+
+/**
+* \brief Run one benchmark in a child process
+* \param run labels
+* \returns whether the child finished cleanly
+**/
+bool runIsolated(const RunInfo& run) {
+    pid_t child = fork();
+    if (child < 0) {
+        perror("fork");
+        return false;
+    } else if (child == 0) {
+        if (string(run.keyType) == "int") {
+            benchRun<int>(run);
+        } else {
+            benchRun<string>(run);
+        }
+        _exit(0);
+    }
+    int status = 0;
+    waitpid(child, &status, 0);
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+/**
+* \brief Parse a comma-separated list of sizes
+* \param text such as "1000,10000"
+* \returns the sizes, or nothing if any item is not a positive integer
+**/
+vector<size_t> parseSizes(const string& text) {
+    // at most 12 digits, so the value cannot overflow
+    const size_t MAX_DIGITS = 12;
+    vector<size_t> sizes;
+    istringstream in(text);
+    string item;
+    while (getline(in, item, ',')) {
+        if (item.empty() || item.size() > MAX_DIGITS ||
+            item.find_first_not_of("0123456789") != string::npos) {
+            return {};
+        }
+        size_t size = static_cast<size_t>(std::stoull(item));
+        if (size == 0) {
+            return {};
+        }
+        sizes.push_back(size);
+    }
+    return sizes;
+}
+
+int main(int argc, char** argv) {
+    vector<size_t> sizes = {1000, 10000, 100000};
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--json") {
+            jsonOutput = true;
+        } else if (arg == "--sizes" && i + 1 < argc) {
+            sizes = parseSizes(argv[++i]);
+        } else {
+            sizes.clear();  // reported just below
+        }
+        if (sizes.empty()) {
+            cerr << "usage: " << argv[0] << " [--json] [--sizes n1,n2,...]"
+                 << endl;
+            return 1;
+        }
+    }
+
+    if (!jsonOutput) {
+        cout << "set,key_type,distribution,size,operation,ops,seconds,"
+             << "ops_per_sec,p50_ns,p90_ns,p99_ns,max_ns,node_bytes" << endl;
+    }
+    bool ok = true;
+    for (size_t size : sizes) {
+        for (const char* keyType : {"int", "string"}) {
+            for (distribution d : {SORTED, REVERSE, RANDOM, ZIPF}) {
+                for (contender c : {LEAF_TREE, ROOT_TREE, RANDOMIZED_TREE,
+                                    TREAP_TREE, WEIGHT_BALANCED_TREE,
+                                    SPLAY_TREE, SEMI_SPLAY_TREE, STD_SET}) {
+                    bool degenerate = (c == LEAF_TREE || c == ROOT_TREE) &&
+                                      (d == SORTED || d == REVERSE);
+                    if (degenerate && size > DEGENERATE_LIMIT) {
+                        continue;
+                    }
+                    ok = runIsolated(RunInfo{c, keyType, d, size}) && ok;
+                }
+            }
+        }
+    }
+    return ok ? 0 : 2;
+}
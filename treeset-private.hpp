@@ -7,76 +7,347 @@
 // the CS70 system directory in Docker.
 #include <cs70/testinglogger.hpp>
 #include <iostream>
-#include <queue>
 #include <string>
 #include <algorithm>
+#include <functional>
+#include <memory>
+#include <new>
+#include <optional>
+#include <type_traits>
+#include <vector>
 #include <cs70/randuint32.hpp>
 
 using namespace std;
 
-template <typename T>
-TreeSet<T>::TreeSet() : root_(nullptr),
-        type_(treetype::LEAF), rand_{0} { }
+template <typename T, typename Compare>
+TreeSet<T, Compare>::TreeSet() : root_(nullptr),
+        type_(treetype::LEAF), rand_{0}, priorityState_(0), comp_() { }
 
-template <typename T>
-TreeSet<T>::TreeSet(treetype t) : root_(nullptr), type_(t), rand_{0} { }
+template <typename T, typename Compare>
+TreeSet<T, Compare>::TreeSet(treetype t) : root_(nullptr), type_(t), rand_{0},
+        priorityState_(0), comp_() { }
 
-template <typename T>
-TreeSet<T>::TreeSet(treetype t, size_t s) : root_(nullptr),
-     type_(t), rand_{s} { }
+template <typename T, typename Compare>
+TreeSet<T, Compare>::TreeSet(treetype t, size_t s) : root_(nullptr),
+     type_(t), rand_{s}, priorityState_(s), comp_() { }
 
-template <typename T>
-TreeSet<T>::~TreeSet() {
-    // only delete if tree actually exists
-    if (root_ != nullptr) {
+template <typename T, typename Compare>
+TreeSet<T, Compare>::TreeSet(treetype t, size_t s, const Compare& comp)
+    : root_(nullptr), type_(t), rand_{s}, priorityState_(s), comp_(comp) { }
+
+template <typename T, typename Compare>
+template <typename InputIt, typename>
+TreeSet<T, Compare>::TreeSet(InputIt first, InputIt last, treetype t, size_t s,
+                             const Compare& comp)
+    : root_(nullptr), type_(t), rand_{s}, priorityState_(s), comp_(comp) {
+    assign(first, last);
+}
+
+template <typename T, typename Compare>
+TreeSet<T, Compare>::~TreeSet() {
+    // values with trivial destructors need no walk at all; the pool
+    // hands every slab back to the heap when it is destroyed
+    if (!std::is_trivially_destructible<Node>::value && root_ != nullptr) {
+        deleteHelper(root_);
+    }
+}
+
+template <typename T, typename Compare>
+void TreeSet<T, Compare>::clear() {
+    if (!std::is_trivially_destructible<Node>::value && root_ != nullptr) {
         deleteHelper(root_);
     }
+    pool_.release();
+    root_ = nullptr;
+}
+
+template <typename T, typename Compare>
+template <typename InputIt>
+void TreeSet<T, Compare>::assign(InputIt first, InputIt last) {
+    clear();
+    std::vector<T> values(first, last);
+    // sorted input (the common case for bulk loads) skips the sort
+    if (!std::is_sorted(values.begin(), values.end(), comp_)) {
+        std::sort(values.begin(), values.end(), comp_);
+    }
+    // neighbours in sorted order are duplicates unless strictly less
+    values.erase(std::unique(values.begin(), values.end(),
+                             [this](const T& lhs, const T& rhs) {
+                                 return !precedes(lhs, rhs);
+                             }),
+                 values.end());
+    root_ = buildBalanced(values, 0, values.size(), nullptr);
+    if (type_ == treetype::TREAP) {
+        assignHeapPriorities(root_);
+    }
+}
+
+template <typename T, typename Compare>
+void TreeSet<T, Compare>::assignHeapPriorities(Node* tree) {
+    std::vector<uint32_t> priorities(sizeOf(tree));
+    for (uint32_t& priority : priorities) {
+        priority = nextPriority();
+    }
+    // every ancestor comes before its descendants in breadth-first order,
+    // so handing out priorities from high to low keeps heap order
+    std::sort(priorities.begin(), priorities.end(), std::greater<uint32_t>());
+    std::vector<Node*> level;
+    if (tree != nullptr) {
+        level.push_back(tree);
+    }
+    size_t next = 0;
+    for (size_t i = 0; i < level.size(); ++i) {
+        Node* cur = level[i];
+        cur->priority_ = priorities[next++];
+        if (cur->leftChild_ != nullptr) {
+            level.push_back(cur->leftChild_);
+        }
+        if (cur->rightChild_ != nullptr) {
+            level.push_back(cur->rightChild_);
+        }
+    }
+}
+
+template <typename T, typename Compare>
+typename TreeSet<T, Compare>::Node* TreeSet<T, Compare>::buildBalanced(
+        std::vector<T>& values, size_t lo, size_t hi, Node* parent) {
+    // an empty range makes an empty subtree
+    if (lo == hi) {
+        return nullptr;
+    }
+    // the middle value becomes the root, each half becomes a child
+    size_t mid = lo + (hi - lo) / 2;
+    // each value is used exactly once, so it can be moved into its node
+    Node* tree = pool_.allocate(std::move(values[mid]));
+    TREESET_COUNT(allocations);
+    tree->parent_ = parent;
+    tree->size_ = hi - lo;
+    tree->leftChild_ = buildBalanced(values, lo, mid, tree);
+    tree->rightChild_ = buildBalanced(values, mid + 1, hi, tree);
+    return tree;
+}
+
+template <typename T, typename Compare>
+typename TreeSet<T, Compare>::Node*
+TreeSet<T, Compare>::rebuildBalanced(Node* tree) {
+    if (tree == nullptr) {
+        return nullptr;
+    }
+    // gather the nodes in order, then hang them from their middle ones
+    std::vector<Node*> nodes;
+    nodes.reserve(tree->size_);
+    std::vector<Node*> above;
+    for (Node* cur = tree; cur != nullptr || !above.empty();) {
+        if (cur != nullptr) {
+            above.push_back(cur);
+            cur = cur->leftChild_;
+        } else {
+            cur = above.back();
+            above.pop_back();
+            nodes.push_back(cur);
+            cur = cur->rightChild_;
+        }
+    }
+    tree = linkBalanced(nodes, 0, nodes.size(), nullptr);
+    if (type_ == treetype::TREAP) {
+        assignHeapPriorities(tree);
+    }
+    return tree;
+}
+
+template <typename T, typename Compare>
+typename TreeSet<T, Compare>::Node* TreeSet<T, Compare>::linkBalanced(
+        std::vector<Node*>& nodes, size_t lo, size_t hi, Node* parent) {
+    if (lo == hi) {
+        return nullptr;
+    }
+    size_t mid = lo + (hi - lo) / 2;
+    Node* tree = nodes[mid];
+    tree->parent_ = parent;
+    tree->size_ = hi - lo;
+    tree->leftChild_ = linkBalanced(nodes, lo, mid, tree);
+    tree->rightChild_ = linkBalanced(nodes, mid + 1, hi, tree);
+    return tree;
 }
 
-template <typename T>
-bool TreeSet<T>::consistent() const {
+template <typename T, typename Compare>
+bool TreeSet<T, Compare>::consistent() const {
     return (((root_ == nullptr) && (root_->size_ == 0)) ||
             ((root_ != nullptr) && (root_->size_ > 0)));
 }
 
-template <typename T>
-void TreeSet<T>::deleteHelper(Node*& tree) {
-    // if we are past a leaf
-    if (tree != nullptr) {
-        // recursively delete left child if it exists
-        deleteHelper(tree->leftChild_);
-        // recursively delete right child if it exists
-        deleteHelper(tree->rightChild_);
-        // only after right and left child have been deleted
-        // can we remove current node from the heap
-        delete tree;
+template <typename T, typename Compare>
+void TreeSet<T, Compare>::deleteHelper(Node* tree) {
+    // rotate left children up until the tree is a path down to the right,
+    // destroying each node once it has no left child: O(n) time, and no
+    // stack however deep the tree is
+    while (tree != nullptr) {
+        if (tree->leftChild_ != nullptr) {
+            Node* left = tree->leftChild_;
+            tree->leftChild_ = left->rightChild_;
+            left->rightChild_ = tree;
+            tree = left;
+        } else {
+            Node* next = tree->rightChild_;
+            // only the Node is destroyed; its slot is freed with the slab
+            tree->~Node();
+            tree = next;
+        }
+    }
+}
+
+template <typename T, typename Compare>
+TreeSet<T, Compare>::NodePool::NodePool()
+    : capacity_(0), current_(nullptr), freeList_(nullptr), used_(0),
+      slabSize_(0) {
+    // slabs are created lazily on the first allocation
+}
+
+template <typename T, typename Compare>
+TreeSet<T, Compare>::NodePool::~NodePool() {
+    release();
+}
+
+template <typename T, typename Compare>
+void TreeSet<T, Compare>::NodePool::release() {
+    // slabs shared with another pool live on until that pool lets go too
+    slabs_.clear();
+    owned_.clear();
+    capacity_ = 0;
+    current_ = nullptr;
+    freeList_ = nullptr;
+    used_ = 0;
+    slabSize_ = 0;
+}
+
+template <typename T, typename Compare>
+template <typename... Args>
+typename TreeSet<T, Compare>::Node*
+TreeSet<T, Compare>::NodePool::allocate(Args&&... args) {
+    Slot* slot;
+    if (freeList_ != nullptr) {  // reuse a slot that was given back
+        slot = freeList_;
+        freeList_ = freeList_->next_;
+    } else {
+        if (used_ == slabSize_) {  // newest slab is full, grow geometrically
+            addSlab((slabSize_ == 0) ? FIRST_SLAB_SIZE
+                                     : min(slabSize_ * 2, MAX_SLAB_SIZE));
+        }
+        slot = current_ + used_;
+        ++used_;
+    }
+    try {
+        return new (slot->storage_) Node(std::forward<Args>(args)...);
+    } catch (...) {  // T's constructor threw; the slot is still free
+        slot->next_ = freeList_;
+        freeList_ = slot;
+        throw;
+    }
+}
+
+template <typename T, typename Compare>
+void TreeSet<T, Compare>::NodePool::addSlab(size_t slots) {
+    slabs_.push_back({std::shared_ptr<Slot[]>(new Slot[slots]), slots});
+    current_ = slabs_.back().slots_.get();
+    owned_.insert(current_);
+    capacity_ += slots;
+    used_ = 0;
+    slabSize_ = slots;
+}
+
+template <typename T, typename Compare>
+void TreeSet<T, Compare>::NodePool::adopt(const NodePool& other) {
+    for (const Slab& slab : other.slabs_) {
+        if (owned_.insert(slab.slots_.get()).second) {
+            slabs_.push_back(slab);
+            capacity_ += slab.size_;
+        }
+    }
+}
+
+template <typename T, typename Compare>
+void TreeSet<T, Compare>::NodePool::reserve(size_t count) {
+    if (slabSize_ - used_ >= count) {
+        return;
     }
+    // put the rest of the newest slab on the free list, so none of it is
+    // lost, and carve the count Nodes from a fresh slab
+    for (; used_ < slabSize_; ++used_) {
+        Slot* slot = current_ + used_;
+        slot->next_ = freeList_;
+        freeList_ = slot;
+    }
+    addSlab(max(count, (slabSize_ == 0) ? FIRST_SLAB_SIZE
+                                        : min(slabSize_ * 2, MAX_SLAB_SIZE)));
+}
+
+template <typename T, typename Compare>
+size_t TreeSet<T, Compare>::NodePool::capacity() const {
+    return capacity_;
 }
 
-template <typename T>
-size_t TreeSet<T>::size() const {
+template <typename T, typename Compare>
+void TreeSet<T, Compare>::NodePool::swap(NodePool& other) {
+    std::swap(slabs_, other.slabs_);
+    std::swap(owned_, other.owned_);
+    std::swap(capacity_, other.capacity_);
+    std::swap(current_, other.current_);
+    std::swap(freeList_, other.freeList_);
+    std::swap(used_, other.used_);
+    std::swap(slabSize_, other.slabSize_);
+}
+
+template <typename T, typename Compare>
+void TreeSet<T, Compare>::NodePool::deallocate(Node* node) {
+    node->~Node();
+    Slot* slot = reinterpret_cast<Slot*>(node);
+    slot->next_ = freeList_;
+    freeList_ = slot;
+}
+
+template <typename T, typename Compare>
+size_t TreeSet<T, Compare>::size() const {
     if (root_ == nullptr) {
         return 0;
     }
     return root_->size_;
 }
 
-template <typename T>
-void TreeSet<T>::insertAtLeaf(Node*& tree, const T& val) {
-    // if we are inserting into empty tree, tree become node containing valing
-    if (tree == nullptr) {
-        tree = new Node{val};  // Assumes a constructor for Node
-    } else if (val < tree->value_) {  // insert in left tree if it's less
-        insertAtLeaf(tree->leftChild_, val);
-        ++tree->size_;
-    } else {  // insert in right tree if valing is greater than current value
-        insertAtLeaf(tree->rightChild_, val);
-        ++tree->size_;
+template <typename T, typename Compare>
+template <typename Make>
+pair<typename TreeSet<T, Compare>::Node*, bool>
+TreeSet<T, Compare>::insertAtLeaf(Node*& tree, Node* parent, const T& val,
+                                  Node* candidate, Make& make) {
+    // walk down to the empty link where val belongs
+    Node** link = &tree;
+    while (*link != nullptr) {
+        Node* cur = *link;
+        TREESET_COUNT(nodesVisited);
+        parent = cur;
+        if (precedes(cur->value_, val)) {  // insert in right tree if greater
+            link = &cur->rightChild_;
+        } else {  // not greater: go left, remembering cur as a possible match
+            candidate = cur;
+            link = &cur->leftChild_;
+        }
+    }
+    // only the last node we went left at can be equal to val
+    if (candidate != nullptr && !precedes(val, candidate->value_)) {
+        return {candidate, false};
     }
+    Node* node = make();
+    node->parent_ = parent;
+    *link = node;
+    // every node above the new leaf gains one descendant
+    for (Node* up = parent; up != nullptr; up = up->parent_) {
+        ++up->size_;
+    }
+    return {node, true};
 }
 
-template <typename T>
-void TreeSet<T>::rotateRight(Node*& root) {
+template <typename T, typename Compare>
+void TreeSet<T, Compare>::rotateRight(Node*& root) const {
+    TREESET_COUNT(rotations);
     // set newRightChild and newRoot as well as new rightchild's new left
     Node* newRightChild = root;
     Node* newRoot = root->leftChild_;
@@ -84,20 +355,63 @@ void TreeSet<T>::rotateRight(Node*& root) {
 
     // Change newRightChilds left child to be newRCLeftChild
     newRightChild->leftChild_ = newRCLeftChild;
+    if (newRCLeftChild != nullptr) {
+        newRCLeftChild->parent_ = newRightChild;
+    }
 
     // change size of the new right child
     setNodeSize(newRightChild);
 
     // asign new right child and change size of new root
+    newRoot->parent_ = newRightChild->parent_;
     newRoot->rightChild_ = newRightChild;
+    newRightChild->parent_ = newRoot;
 
     setNodeSize(newRoot);
     // reassign the root of the subtree
     root = newRoot;
 }
 
-template <typename T>
-void TreeSet<T>::setNodeSize(Node*& cur) {
+template <typename T, typename Compare>
+void TreeSet<T, Compare>::rotateUp(Node* node) const {
+    Node* up = node->parent_;
+    if (up->leftChild_ == node) {
+        rotateRight(linkTo(up));
+    } else {
+        rotateLeft(linkTo(up));
+    }
+}
+
+template <typename T, typename Compare>
+void TreeSet<T, Compare>::splay(Node* node) const {
+    if (node == nullptr ||
+        (type_ != treetype::SPLAY && type_ != treetype::SEMI_SPLAY)) {
+        return;
+    }
+    while (node->parent_ != nullptr) {
+        Node* parent = node->parent_;
+        Node* grand = parent->parent_;
+        if (grand == nullptr) {  // zig: one rotation finishes the job
+            rotateUp(node);
+        } else if ((grand->leftChild_ == parent) ==
+                   (parent->leftChild_ == node)) {  // zig-zig
+            rotateUp(parent);
+            if (type_ == treetype::SEMI_SPLAY) {
+                // parent now heads the pair; carry on from there, leaving
+                // node where it is, so the path only folds in half
+                node = parent;
+            } else {
+                rotateUp(node);
+            }
+        } else {  // zig-zag
+            rotateUp(node);
+            rotateUp(node);
+        }
+    }
+}
+
+template <typename T, typename Compare>
+void TreeSet<T, Compare>::setNodeSize(Node*& cur) const {
     cur->size_ = 1;
     if (cur->leftChild_ != nullptr) {
         cur->size_ += cur->leftChild_->size_;
@@ -107,8 +421,37 @@ void TreeSet<T>::setNodeSize(Node*& cur) {
     }
 }
 
-template <typename T>
-void TreeSet<T>::rotateLeft(Node*& root) {
+template <typename T, typename Compare>
+template <typename A, typename B>
+bool TreeSet<T, Compare>::precedes(const A& lhs, const B& rhs) const {
+    TREESET_COUNT(comparisons);
+    return comp_(lhs, rhs);
+}
+
+template <typename T, typename Compare>
+size_t TreeSet<T, Compare>::sizeOf(const Node* cur) {
+    return (cur == nullptr) ? 0 : cur->size_;
+}
+
+template <typename T, typename Compare>
+typename TreeSet<T, Compare>::Node* TreeSet<T, Compare>::leftmost(Node* cur) {
+    while (cur->leftChild_ != nullptr) {
+        cur = cur->leftChild_;
+    }
+    return cur;
+}
+
+template <typename T, typename Compare>
+typename TreeSet<T, Compare>::Node* TreeSet<T, Compare>::rightmost(Node* cur) {
+    while (cur->rightChild_ != nullptr) {
+        cur = cur->rightChild_;
+    }
+    return cur;
+}
+
+template <typename T, typename Compare>
+void TreeSet<T, Compare>::rotateLeft(Node*& root) const {
+    TREESET_COUNT(rotations);
     // set newLeftChild and newRoot as well as new leftchild's new right
     Node* newLeftChild = root;
     Node* newRoot = root->rightChild_;
@@ -116,11 +459,16 @@ void TreeSet<T>::rotateLeft(Node*& root) {
 
     // Change newLeftChild left child to be newLCRightChild
     newLeftChild->rightChild_ = newLCRightChild;
+    if (newLCRightChild != nullptr) {
+        newLCRightChild->parent_ = newLeftChild;
+    }
 
     // change size of the new left child
     setNodeSize(newLeftChild);
 
+    newRoot->parent_ = newLeftChild->parent_;
     newRoot->leftChild_ = newLeftChild;
+    newLeftChild->parent_ = newRoot;
 
     // change size of the new root
     setNodeSize(newRoot);
@@ -129,254 +477,1709 @@ void TreeSet<T>::rotateLeft(Node*& root) {
     root = newRoot;
 }
 
-template <typename T>
-void TreeSet<T>::insertAtRoot(Node*& tree, const T& val) {
-    // if we are inserting into empty tree, tree become node containing valing
-    if (tree == nullptr) {
-        tree = new Node{val};  // Assumes a constructor for Node
-    } else if (val < tree->value_) {  // insert in left tree if it's less
-        insertAtRoot(tree->leftChild_, val);
-        rotateRight(tree);
-    } else {  // insert in right tree if valing is greater than current value
-        insertAtRoot(tree->rightChild_, val);
-        rotateLeft(tree);
+template <typename T, typename Compare>
+template <typename Make>
+pair<typename TreeSet<T, Compare>::Node*, bool>
+TreeSet<T, Compare>::insertAtRoot(Node*& tree, Node* parent, const T& val,
+                                  Node* candidate, Make& make) {
+    pair<Node*, bool> result = insertAtLeaf(tree, parent, val, candidate,
+                                            make);
+    if (result.second) {
+        // rotate the new leaf up until it is the root of this subtree
+        Node* node = result.first;
+        while (node->parent_ != parent) {
+            rotateUp(node);
+        }
     }
+    return result;
 }
 
-template <typename T>
-void TreeSet<T>::insertAtRandom(Node*& tree, const T& val) {
-    int randomInt;
+template <typename T, typename Compare>
+template <typename Make>
+pair<typename TreeSet<T, Compare>::Node*, bool>
+TreeSet<T, Compare>::insertAtRandom(Node*& tree, Node* parent, const T& val,
+                                    Node* candidate, Make& make) {
+    Node** link = &tree;
+    while (true) {
+        Node* cur = *link;
+        TREESET_COUNT(randomDraws);
+        // the new node becomes root of the subtree at cur with probability
+        // 1 / (size + 1); an empty subtree always takes it
+        int randomInt = (cur == nullptr) ? rand_.get(1)
+                                         : rand_.get(cur->size_ + 1);
+        if (randomInt == 0) {
+            return insertAtRoot(*link, parent, val, candidate, make);
+        }
+        // Either add to the left subtree or right subtree based on the key_
+        TREESET_COUNT(nodesVisited);
+        parent = cur;
+        if (precedes(cur->value_, val)) {
+            link = &cur->rightChild_;
+        } else {
+            candidate = cur;
+            link = &cur->leftChild_;
+        }
+    }
+}
+
+template <typename T, typename Compare>
+template <typename Make>
+pair<typename TreeSet<T, Compare>::Node*, bool>
+TreeSet<T, Compare>::insertAtTreap(Node*& tree, Node* parent, const T& val,
+                                   Node* candidate, Make& make) {
+    pair<Node*, bool> result = insertAtLeaf(tree, parent, val, candidate,
+                                            make);
+    if (result.second) {
+        // the only random draw for this insert: the new node's priority
+        Node* node = result.first;
+        node->priority_ = nextPriority();
+        // rotate the new node up while it outranks its parent
+        while (node->parent_ != parent &&
+               node->priority_ > node->parent_->priority_) {
+            rotateUp(node);
+        }
+    }
+    return result;
+}
+
+template <typename T, typename Compare>
+template <typename Make>
+pair<typename TreeSet<T, Compare>::Node*, bool>
+TreeSet<T, Compare>::insertAtWeight(Node*& tree, Node* parent, const T& val,
+                                    Node* candidate, Make& make) {
+    pair<Node*, bool> result = insertAtLeaf(tree, parent, val, candidate,
+                                            make);
+    if (result.second) {
+        // a hinted insert may start below tree's top, so go all the way
+        rebalanceUp(result.first, root_);
+    }
+    return result;
+}
+
+template <typename T, typename Compare>
+typename TreeSet<T, Compare>::Node*
+TreeSet<T, Compare>::rebalanceAt(Node*& link) {
+    Node* node = link;
+    setNodeSize(node);
+    size_t left = sizeOf(node->leftChild_) + 1;
+    size_t right = sizeOf(node->rightChild_) + 1;
+    if (right > WEIGHT_DELTA * left) {  // right side too heavy
+        Node* child = node->rightChild_;
+        // a heavy inner grandchild has to come up first
+        if (sizeOf(child->leftChild_) + 1 >=
+            WEIGHT_GAMMA * (sizeOf(child->rightChild_) + 1)) {
+            rotateRight(node->rightChild_);
+        }
+        rotateLeft(link);
+    } else if (left > WEIGHT_DELTA * right) {  // left side too heavy
+        Node* child = node->leftChild_;
+        if (sizeOf(child->rightChild_) + 1 >=
+            WEIGHT_GAMMA * (sizeOf(child->leftChild_) + 1)) {
+            rotateLeft(node->leftChild_);
+        }
+        rotateRight(link);
+    }
+    return link;
+}
+
+template <typename T, typename Compare>
+void TreeSet<T, Compare>::rebalanceUp(Node* node, Node*& tree) {
+    Node* stop = tree->parent_;
+    while (node != stop) {
+        // the root of this tree may not be linked anywhere we can reach
+        Node*& link = (node == tree) ? tree : linkTo(node);
+        node = rebalanceAt(link)->parent_;
+    }
+}
+
+template <typename T, typename Compare>
+typename TreeSet<T, Compare>::Node*
+TreeSet<T, Compare>::joinByWeight(Node* left, Node* mid, Node* right) {
+    size_t leftWeight = sizeOf(left) + 1;
+    size_t rightWeight = sizeOf(right) + 1;
+    Node* tree = nullptr;  // heavier tree, if mid has to go inside it
+    Node* above = nullptr;  // node mid will hang below
+    if (leftWeight > WEIGHT_DELTA * rightWeight) {
+        // down the right spine until right can balance what is left
+        tree = left;
+        for (Node* cur = left; sizeOf(cur) + 1 > WEIGHT_DELTA * rightWeight;
+             cur = cur->rightChild_) {
+            above = cur;
+        }
+        left = above->rightChild_;
+        above->rightChild_ = mid;
+    } else if (rightWeight > WEIGHT_DELTA * leftWeight) {
+        tree = right;
+        for (Node* cur = right; sizeOf(cur) + 1 > WEIGHT_DELTA * leftWeight;
+             cur = cur->leftChild_) {
+            above = cur;
+        }
+        right = above->leftChild_;
+        above->leftChild_ = mid;
+    }
+    mid->parent_ = above;
+    mid->leftChild_ = left;
+    if (left != nullptr) {
+        left->parent_ = mid;
+    }
+    mid->rightChild_ = right;
+    if (right != nullptr) {
+        right->parent_ = mid;
+    }
+    setNodeSize(mid);
     if (tree == nullptr) {
-        // empty we always insert at root
-        randomInt = rand_.get(1);
+        return mid;
+    }
+    // the spine above mid grew; fix it from the bottom up
+    tree->parent_ = nullptr;
+    rebalanceUp(above, tree);
+    return tree;
+}
+
+template <typename T, typename Compare>
+typename TreeSet<T, Compare>::Node*
+TreeSet<T, Compare>::splitByWeight(Node* tree, const T& key, Node*& less,
+                                   Node*& greater) {
+    // find the key, remembering each node passed and which way we went
+    std::vector<pair<Node*, bool>> path;
+    Node* match = nullptr;
+    while (tree != nullptr) {
+        TREESET_COUNT(nodesVisited);
+        if (precedes(tree->value_, key)) {
+            path.push_back({tree, true});
+            tree = tree->rightChild_;
+        } else if (precedes(key, tree->value_)) {
+            path.push_back({tree, false});
+            tree = tree->leftChild_;
+        } else {
+            match = tree;
+            break;
+        }
+    }
+    less = (match != nullptr) ? match->leftChild_ : nullptr;
+    greater = (match != nullptr) ? match->rightChild_ : nullptr;
+    if (match != nullptr) {
+        match->leftChild_ = nullptr;
+        match->rightChild_ = nullptr;
+        match->size_ = 1;
+    }
+    // going back up, each node joins the side it belongs to, bringing
+    // along its other subtree
+    for (auto step = path.rbegin(); step != path.rend(); ++step) {
+        Node* node = step->first;
+        if (step->second) {
+            less = joinByWeight(node->leftChild_, node, less);
+        } else {
+            greater = joinByWeight(greater, node, node->rightChild_);
+        }
+    }
+    if (less != nullptr) {
+        less->parent_ = nullptr;
+    }
+    if (greater != nullptr) {
+        greater->parent_ = nullptr;
+    }
+    return match;
+}
+
+template <typename T, typename Compare>
+uint32_t TreeSet<T, Compare>::nextPriority() {
+    // splitmix64: a handful of arithmetic ops, no library call
+    TREESET_COUNT(randomDraws);
+    uint64_t z = (priorityState_ += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return static_cast<uint32_t>((z ^ (z >> 31)) >> 32);
+}
+
+template <typename T, typename Compare>
+template <typename Make>
+pair<typename TreeSet<T, Compare>::Node*, bool>
+TreeSet<T, Compare>::insertWith(Node*& tree, Node* parent, const T& val,
+                                Make& make) {
+    // each helper finds the slot and spots duplicates in a single descent;
+    // when tree is not root_, whatever the treetype keeps above the new
+    // node (its place at the root, heap order) is restored afterwards
+    if (type_ == treetype::LEAF) {
+        return insertAtLeaf(tree, parent, val, nullptr, make);
+    } else if (type_ == treetype::ROOT) {
+        pair<Node*, bool> result = insertAtRoot(tree, parent, val, nullptr,
+                                                make);
+        if (result.second) {
+            while (result.first->parent_ != nullptr) {
+                rotateUp(result.first);
+            }
+        }
+        return result;
+    } else if (type_ == treetype::TREAP) {
+        pair<Node*, bool> result = insertAtTreap(tree, parent, val, nullptr,
+                                                 make);
+        Node* node = result.first;
+        if (result.second) {
+            while (node->parent_ != nullptr &&
+                   node->priority_ > node->parent_->priority_) {
+                rotateUp(node);
+            }
+        }
+        return result;
+    } else if (type_ == treetype::WEIGHT_BALANCED) {
+        return insertAtWeight(tree, parent, val, nullptr, make);
+    } else if (type_ == treetype::SPLAY || type_ == treetype::SEMI_SPLAY) {
+        // new or not, the element was just accessed
+        pair<Node*, bool> result = insertAtLeaf(tree, parent, val, nullptr,
+                                                make);
+        splay(result.first);
+        return result;
     } else {
-        // Get a random number from 0 to node->size
-        randomInt = rand_.get(tree->size_ + 1);
+        // a descent from root_ would have flipped a coin at each node above
+        // tree, and T would become the root of the topmost winner's subtree
+        Node* top = nullptr;
+        for (Node* up = parent; up != nullptr; up = up->parent_) {
+            TREESET_COUNT(randomDraws);
+            if (rand_.get(up->size_ + 1) == 0) {
+                top = up;
+            }
+        }
+        if (top != nullptr) {
+            return insertAtRoot(linkTo(top), top->parent_, val, nullptr,
+                                make);
+        }
+        return insertAtRandom(tree, parent, val, nullptr, make);
+    }
+}
+
+template <typename T, typename Compare>
+typename TreeSet<T, Compare>::Node*&
+TreeSet<T, Compare>::fingerSearch(Node* hint, const T& val,
+                                  Node*& parent) const {
+    TREESET_COUNT(nodesVisited);
+    bool right = precedes(hint->value_, val);
+    if (!right && !precedes(val, hint->value_)) {
+        // the descent will find val at the hint itself
+        parent = hint->parent_;
+        return linkTo(hint);
+    }
+    // Only an ancestor reached from val's side of the climb is the next
+    // element on that side, so only those are compared. Climb past each
+    // one that val lies beyond and stop at the first one it does not.
+    Node* start = hint;
+    Node* child = hint;
+    for (Node* up = hint->parent_; up != nullptr;
+         child = up, up = up->parent_) {
+        if ((up->leftChild_ == child) != right) {
+            continue;
+        }
+        TREESET_COUNT(nodesVisited);
+        if (right ? precedes(val, up->value_) : precedes(up->value_, val)) {
+            break;
+        } else if (right ? !precedes(up->value_, val)
+                         : !precedes(val, up->value_)) {
+            parent = up->parent_;
+            return linkTo(up);
+        }
+        start = up;
     }
-    // Check if the number is 0 (1/size probability)
-    bool doRootInsert = (randomInt == 0);
+    // val lies between start and the ancestor the climb stopped at, which
+    // is exactly the range of start's subtree on val's side
+    parent = start;
+    return right ? start->rightChild_ : start->leftChild_;
+}
+
+template <typename T, typename Compare>
+pair<typename TreeSet<T, Compare>::iterator, bool>
+TreeSet<T, Compare>::insert(const T& val) {
+    TREESET_OPERATION("insert");
+    // the copy is made only once we know val is not already present
+    auto make = [&]() {
+        TREESET_COUNT(allocations);
+        return pool_.allocate(val);
+    };
+    pair<Node*, bool> result = insertWith(root_, nullptr, val, make);
+    return {Iterator(result.first, this), result.second};
+}
+
+template <typename T, typename Compare>
+pair<typename TreeSet<T, Compare>::iterator, bool>
+TreeSet<T, Compare>::insert(T&& val) {
+    TREESET_OPERATION("insert");
+    // val is still read while searching, so it is moved only at the end
+    auto make = [&]() {
+        TREESET_COUNT(allocations);
+        return pool_.allocate(std::move(val));
+    };
+    pair<Node*, bool> result = insertWith(root_, nullptr, val, make);
+    return {Iterator(result.first, this), result.second};
+}
 
-    // If the random number is 0, the new node becomes the root
-    if (doRootInsert) {
-        insertAtRoot(tree, val);
+template <typename T, typename Compare>
+pair<typename TreeSet<T, Compare>::iterator, bool>
+TreeSet<T, Compare>::insert(node_type&& handle) {
+    TREESET_OPERATION("insert");
+    if (handle.empty()) {
+        return {end(), false};
+    }
+    pair<iterator, bool> result = insert(std::move(*handle.value_));
+    if (result.second) {
+        handle.value_.reset();
+    }
+    return result;
+}
+
+template <typename T, typename Compare>
+typename TreeSet<T, Compare>::iterator
+TreeSet<T, Compare>::insert(iterator hint, const T& val) {
+    TREESET_OPERATION("insert");
+    auto make = [&]() {
+        TREESET_COUNT(allocations);
+        return pool_.allocate(val);
+    };
+    if (root_ == nullptr) {
+        return Iterator(insertWith(root_, nullptr, val, make).first, this);
+    }
+    // end() has no node, so the largest element stands in for it
+    Node* from = (hint.current_ == nullptr) ? rightmost(root_)
+                                            : hint.current_;
+    Node* parent = nullptr;
+    Node*& tree = fingerSearch(from, val, parent);
+    return Iterator(insertWith(tree, parent, val, make).first, this);
+}
+
+template <typename T, typename Compare>
+template <typename InputIt>
+void TreeSet<T, Compare>::appendSorted(InputIt first, InputIt last) {
+    TREESET_OPERATION("appendSorted");
+    iterator hint = end();
+    for (; first != last; ++first) {
+        hint = insert(hint, *first);
+    }
+}
+
+template <typename T, typename Compare>
+template <typename... Args>
+pair<typename TreeSet<T, Compare>::iterator, bool>
+TreeSet<T, Compare>::emplace(Args&&... args) {
+    TREESET_OPERATION("emplace");
+    Node* node = pool_.allocate(std::forward<Args>(args)...);
+    TREESET_COUNT(allocations);
+    auto make = [node]() { return node; };
+    pair<Node*, bool> result = insertWith(root_, nullptr, node->value_, make);
+    if (!result.second) {
+        pool_.deallocate(node);
+    }
+    return {Iterator(result.first, this), result.second};
+}
+
+template <typename T, typename Compare>
+typename TreeSet<T, Compare>::Node*&
+TreeSet<T, Compare>::linkTo(Node* node) const {
+    Node* parent = node->parent_;
+    if (parent == nullptr) {
+        return root_;
+    } else if (parent->leftChild_ == node) {
+        return parent->leftChild_;
     } else {
-    // Either add to the left subtree or right subtree based on the key_
-        if (val < tree->value_) {
-            insertAtRandom(tree->leftChild_, val);
+        return parent->rightChild_;
+    }
+}
+
+template <typename T, typename Compare>
+typename TreeSet<T, Compare>::Node*
+TreeSet<T, Compare>::detachMin(Node*& tree) {
+    Node* min = leftmost(tree);
+    Node* stop = tree->parent_;
+    // every node between the minimum and the subtree root loses one
+    for (Node* up = min->parent_; up != stop; up = up->parent_) {
+        --up->size_;
+    }
+    Node*& link = (min == tree) ? tree : min->parent_->leftChild_;
+    link = min->rightChild_;
+    if (link != nullptr) {
+        link->parent_ = min->parent_;
+    }
+    return min;
+}
+
+template <typename T, typename Compare>
+typename TreeSet<T, Compare>::Node*
+TreeSet<T, Compare>::joinBySuccessor(Node* left,
+                                     Node* right) {
+    if (left == nullptr) {
+        return right;
+    } else if (right == nullptr) {
+        return left;
+    }
+    // the smallest node on the right sits between the two trees
+    Node* successor = detachMin(right);
+    successor->leftChild_ = left;
+    left->parent_ = successor;
+    successor->rightChild_ = right;
+    if (right != nullptr) {
+        right->parent_ = successor;
+    }
+    setNodeSize(successor);
+    return successor;
+}
+
+template <typename T, typename Compare>
+typename TreeSet<T, Compare>::Node*
+TreeSet<T, Compare>::joinRandom(Node* left, Node* right) {
+    // zip the right spine of left and the left spine of right together,
+    // top down; each node taken gains everything still left to join
+    Node* joined = nullptr;
+    Node** link = &joined;
+    Node* parent = nullptr;
+    while (left != nullptr && right != nullptr) {
+        // left's root wins with probability |left| / (|left| + |right|),
+        // which keeps the result distributed like a randomized BST
+        TREESET_COUNT(randomDraws);
+        if (rand_.get(left->size_ + right->size_) < left->size_) {
+            left->size_ += right->size_;
+            left->parent_ = parent;
+            *link = left;
+            parent = left;
+            link = &left->rightChild_;
+            left = left->rightChild_;
         } else {
-            insertAtRandom(tree->rightChild_, val);
+            right->size_ += left->size_;
+            right->parent_ = parent;
+            *link = right;
+            parent = right;
+            link = &right->leftChild_;
+            right = right->leftChild_;
         }
-        ++tree->size_;
     }
+    Node* rest = (left != nullptr) ? left : right;
+    *link = rest;
+    if (rest != nullptr) {
+        rest->parent_ = parent;
+    }
+    return joined;
 }
 
-template <typename T>
-void TreeSet<T>::insert(const T& val) {
-    // only insert if it does not exist in tree already
-    if (!exists(val)) {
-        if (type_ == treetype::LEAF) {
-            insertAtLeaf(root_, val);
-        } else if (type_ == treetype::ROOT) {
-            insertAtRoot(root_, val);
+template <typename T, typename Compare>
+typename TreeSet<T, Compare>::Node*
+TreeSet<T, Compare>::joinByPriority(Node* left, Node* right) {
+    // the same top-down zip as joinRandom, led by priorities instead
+    Node* joined = nullptr;
+    Node** link = &joined;
+    Node* parent = nullptr;
+    while (left != nullptr && right != nullptr) {
+        // the higher priority root stays on top to keep heap order
+        if (left->priority_ > right->priority_) {
+            left->size_ += right->size_;
+            left->parent_ = parent;
+            *link = left;
+            parent = left;
+            link = &left->rightChild_;
+            left = left->rightChild_;
         } else {
-            insertAtRandom(root_, val);
+            right->size_ += left->size_;
+            right->parent_ = parent;
+            *link = right;
+            parent = right;
+            link = &right->leftChild_;
+            right = right->leftChild_;
         }
     }
+    Node* rest = (left != nullptr) ? left : right;
+    *link = rest;
+    if (rest != nullptr) {
+        rest->parent_ = parent;
+    }
+    return joined;
 }
 
-template <typename T>
-bool TreeSet<T>::existsHelper(const Node* tree, const T& val) const {
-    // if tree is empty no elements can exist
-    if (tree == nullptr) {
-        return false;
-    } else if (val == tree->value_) {  // return true if we find the value
+template <typename T, typename Compare>
+typename TreeSet<T, Compare>::Node*
+TreeSet<T, Compare>::joinSubtrees(Node* left, Node* right) {
+    if (type_ == treetype::RANDOMIZED) {
+        return joinRandom(left, right);
+    } else if (type_ == treetype::TREAP) {
+        return joinByPriority(left, right);
+    } else if (type_ == treetype::WEIGHT_BALANCED && left != nullptr &&
+               right != nullptr) {
+        // right's smallest node goes between them; right is rebalanced
+        // along the spine it came from first
+        Node* min = leftmost(right);
+        Node* above = (min == right) ? nullptr : min->parent_;
+        right->parent_ = nullptr;
+        detachMin(right);
+        if (above != nullptr) {
+            rebalanceUp(above, right);
+        }
+        return joinByWeight(left, min, right);
+    } else {
+        return joinBySuccessor(left, right);
+    }
+}
+
+template <typename T, typename Compare>
+typename TreeSet<T, Compare>::Node*
+TreeSet<T, Compare>::joinWithRoot(Node* left, Node* mid,
+                                  Node* right) {
+    if (type_ == treetype::WEIGHT_BALANCED) {
+        return joinByWeight(left, mid, right);
+    }
+    if (type_ == treetype::RANDOMIZED || type_ == treetype::TREAP) {
+        // a lone node is itself a randomized tree (or treap), so two joins
+        // keep the result's shape guarantees
+        mid->leftChild_ = nullptr;
+        mid->rightChild_ = nullptr;
+        mid->size_ = 1;
+        Node* lower = joinSubtrees(left, mid);
+        return joinSubtrees(lower, right);
+    }
+    mid->leftChild_ = left;
+    if (left != nullptr) {
+        left->parent_ = mid;
+    }
+    mid->rightChild_ = right;
+    if (right != nullptr) {
+        right->parent_ = mid;
+    }
+    setNodeSize(mid);
+    return mid;
+}
+
+template <typename T, typename Compare>
+typename TreeSet<T, Compare>::Node*
+TreeSet<T, Compare>::splitHelper(Node* tree, const T& key,
+                                 Node*& less,
+                                 Node*& greater) {
+    if (type_ == treetype::WEIGHT_BALANCED) {
+        return splitByWeight(tree, key, less, greater);
+    }
+    // walk down once, hanging each node on the less or greater side
+    Node** lessLink = &less;
+    Node** greaterLink = &greater;
+    Node* lessParent = nullptr;
+    Node* greaterParent = nullptr;
+    Node* match = nullptr;
+    while (tree != nullptr) {
+        TREESET_COUNT(nodesVisited);
+        if (precedes(tree->value_, key)) {  // tree and its left belong to less
+            *lessLink = tree;
+            tree->parent_ = lessParent;
+            lessParent = tree;
+            lessLink = &tree->rightChild_;
+            tree = tree->rightChild_;
+        } else if (precedes(key, tree->value_)) {  // tree and right: greater
+            *greaterLink = tree;
+            tree->parent_ = greaterParent;
+            greaterParent = tree;
+            greaterLink = &tree->leftChild_;
+            tree = tree->leftChild_;
+        } else {  // found the key; its two subtrees finish the two sides
+            match = tree;
+            break;
+        }
+    }
+    *lessLink = (match != nullptr) ? match->leftChild_ : nullptr;
+    if (*lessLink != nullptr) {
+        (*lessLink)->parent_ = lessParent;
+    }
+    *greaterLink = (match != nullptr) ? match->rightChild_ : nullptr;
+    if (*greaterLink != nullptr) {
+        (*greaterLink)->parent_ = greaterParent;
+    }
+    if (match != nullptr) {
+        match->leftChild_ = nullptr;
+        match->rightChild_ = nullptr;
+        match->size_ = 1;
+    }
+    // only the nodes along the two spines changed size
+    for (Node* up = lessParent; up != nullptr; up = up->parent_) {
+        setNodeSize(up);
+    }
+    for (Node* up = greaterParent; up != nullptr; up = up->parent_) {
+        setNodeSize(up);
+    }
+    return match;
+}
+
+template <typename T, typename Compare>
+bool TreeSet<T, Compare>::pickFirstRoot(const Node* a, const Node* b) {
+    if (type_ == treetype::RANDOMIZED) {
+        TREESET_COUNT(randomDraws);
+        return rand_.get(a->size_ + b->size_) < a->size_;
+    } else if (type_ == treetype::TREAP) {
+        return a->priority_ >= b->priority_;
+    }
+    return true;
+}
+
+template <typename T, typename Compare>
+typename TreeSet<T, Compare>::Node*
+TreeSet<T, Compare>::combineTrees(setop op, Node* a, Node* b) {
+    // the divide-and-conquer recursion, run on a heap-allocated stack so
+    // that deep (LEAF or ROOT) trees cannot overflow the call stack
+    std::vector<SetStep> steps;
+    steps.push_back(SetStep{a, b});
+    Node* result = nullptr;
+    bool solved = false;  // whether result answers the step on top
+    while (!steps.empty()) {
+        SetStep& step = steps.back();
+        if (solved) {  // hand a finished side back to the step that asked
+            (step.stage == 1 ? step.low : step.high) = result;
+            solved = false;
+        }
+        if (step.stage == 0) {  // split around a root, or finish at once
+            solved = splitStep(op, step, result);
+            if (solved) {
+                steps.pop_back();
+            } else {
+                step.stage = 1;
+                SetStep lowSide{step.lowA, step.lowB};
+                steps.push_back(lowSide);
+            }
+        } else if (step.stage == 1) {
+            step.stage = 2;
+            SetStep highSide{step.highA, step.highB};
+            steps.push_back(highSide);
+        } else {  // both sides are done
+            result = joinStep(op, step);
+            solved = true;
+            steps.pop_back();
+        }
+    }
+    return result;
+}
+
+template <typename T, typename Compare>
+bool TreeSet<T, Compare>::splitStep(setop op, SetStep& step, Node*& result) {
+    Node* a = step.a;
+    Node* b = step.b;
+    if (a == nullptr || b == nullptr) {
+        if (op == setop::UNION) {
+            result = (a == nullptr) ? b : a;
+        } else if (op == setop::INTERSECTION) {
+            releaseHelper(a);
+            releaseHelper(b);
+            result = nullptr;
+        } else {
+            releaseHelper(b);
+            result = a;
+        }
         return true;
-    } else if (val < tree->value_) {  // check left child if val is less
-        return existsHelper(tree->leftChild_, val);
-    } else {  // check right child if val is greater than current value
-        return existsHelper(tree->rightChild_, val);
     }
+    // union and intersection are symmetric, so b's root can lead; in a
+    // difference b's root never survives, but it may still lead the split
+    step.pivotFromA = pickFirstRoot(a, b);
+    if (step.pivotFromA) {  // a's root stays on top; split b around it
+        step.pivot = a;
+        step.match = splitHelper(b, a->value_, step.lowB, step.highB);
+        step.lowA = a->leftChild_;
+        step.highA = a->rightChild_;
+    } else if (op == setop::DIFFERENCE) {  // split a around b's root
+        step.pivot = b;
+        step.match = splitHelper(a, b->value_, step.lowA, step.highA);
+        step.lowB = b->leftChild_;
+        step.highB = b->rightChild_;
+    } else {
+        step.pivot = b;
+        step.match = splitHelper(a, b->value_, step.lowB, step.highB);
+        step.lowA = b->leftChild_;
+        step.highA = b->rightChild_;
+    }
+    return false;
 }
 
-template <typename T>
-bool TreeSet<T>::exists(const T& val) const {
-    return existsHelper(root_, val);
+template <typename T, typename Compare>
+typename TreeSet<T, Compare>::Node*
+TreeSet<T, Compare>::joinStep(setop op, SetStep& step) {
+    Node* pivot = step.pivot;
+    Node* match = step.match;
+    if (op == setop::UNION) {
+        if (match != nullptr) {  // the same element from the other tree
+            pool_.deallocate(match);
+        }
+        if (type_ == treetype::WEIGHT_BALANCED) {  // sides may differ a lot
+            return joinWithRoot(step.low, pivot, step.high);
+        }
+        pivot->leftChild_ = step.low;
+        if (step.low != nullptr) {
+            step.low->parent_ = pivot;
+        }
+        pivot->rightChild_ = step.high;
+        if (step.high != nullptr) {
+            step.high->parent_ = pivot;
+        }
+        setNodeSize(pivot);
+        return pivot;
+    } else if (op == setop::INTERSECTION) {
+        if (match != nullptr) {  // pivot is in both trees, keep one copy
+            pool_.deallocate(match);
+            return joinWithRoot(step.low, pivot, step.high);
+        }
+        pool_.deallocate(pivot);
+        return joinSubtrees(step.low, step.high);
+    }
+    // difference: a's root survives unless b also has it
+    if (step.pivotFromA && match == nullptr) {
+        return joinWithRoot(step.low, pivot, step.high);
+    }
+    if (match != nullptr) {
+        pool_.deallocate(match);
+    }
+    pool_.deallocate(pivot);
+    return joinSubtrees(step.low, step.high);
+}
+
+template <typename T, typename Compare>
+void TreeSet<T, Compare>::releaseHelper(Node* tree) {
+    // the same rotate-and-peel walk as deleteHelper, in constant space
+    while (tree != nullptr) {
+        if (tree->leftChild_ != nullptr) {
+            Node* left = tree->leftChild_;
+            tree->leftChild_ = left->rightChild_;
+            left->rightChild_ = tree;
+            tree = left;
+        } else {
+            Node* next = tree->rightChild_;
+            pool_.deallocate(tree);
+            tree = next;
+        }
+    }
+}
+
+template <typename T, typename Compare>
+typename TreeSet<T, Compare>::Node*
+TreeSet<T, Compare>::takeNodes(TreeSet& other) {
+    Node* taken = other.root_;
+    if (taken != nullptr && other.size() <= size()) {
+        // a small Tree's slabs are mostly empty; sharing them would pin
+        // them for as long as we live, so copy its few nodes instead
+        taken = copyNodes(taken);
+        other.clear();
+    } else {
+        // the nodes stay where they are in memory, so share their slabs
+        pool_.adopt(other.pool_);
+        other.root_ = nullptr;
+    }
+    // another treetype's shape (a LEAF tree's long path, say) is kept as
+    // it is by the joins, which would break a balanced treetype's bound
+    if (other.type_ != type_) {
+        taken = rebuildBalanced(taken);
+    }
+    return taken;
+}
+
+template <typename T, typename Compare>
+typename TreeSet<T, Compare>::Node*
+TreeSet<T, Compare>::copyNodes(Node* tree) {
+    // with every slot in hand up front, only T's constructor can throw
+    pool_.reserve(tree->size_);
+    struct Pending {
+        Node* from;  // node to copy
+        Node* parent;  // copy of its parent
+        Node** link;  // where its copy goes
+    };
+    Node* copy = nullptr;
+    std::vector<Pending> pending = {{tree, nullptr, &copy}};
+    try {
+        while (!pending.empty()) {
+            Pending next = pending.back();
+            pending.pop_back();
+            Node* node =
+                pool_.allocate(std::move_if_noexcept(next.from->value_));
+            node->parent_ = next.parent;
+            node->size_ = next.from->size_;
+            node->priority_ = next.from->priority_;
+            *next.link = node;
+            if (next.from->leftChild_ != nullptr) {
+                pending.push_back({next.from->leftChild_, node,
+                                   &node->leftChild_});
+            }
+            if (next.from->rightChild_ != nullptr) {
+                pending.push_back({next.from->rightChild_, node,
+                                   &node->rightChild_});
+            }
+        }
+    } catch (...) {
+        // a throwing copy leaves the original untouched
+        releaseHelper(copy);
+        throw;
+    }
+    return copy;
+}
+
+template <typename T, typename Compare>
+void TreeSet<T, Compare>::compactPool() {
+    // Slabs shared with a large Tree stay pinned after, say, intersecting
+    // with it leaves only a few nodes. Once they hold far more slots than
+    // we use, copy the Tree out; filling those slots took at least as
+    // much work as the copy does.
+    if (pool_.capacity() <= SPARSE_POOL_FACTOR * (size() + 16)) {
+        return;
+    }
+    NodePool old;
+    old.swap(pool_);
+    Node* copy = nullptr;
+    if (root_ != nullptr) {
+        try {
+            copy = copyNodes(root_);
+        } catch (...) {
+            // compacting only saves memory; keep the old slabs instead
+            pool_.swap(old);
+            return;
+        }
+        if (!std::is_trivially_destructible<Node>::value) {
+            deleteHelper(root_);
+        }
+    }
+    root_ = copy;
+}
+
+template <typename T, typename Compare>
+void TreeSet<T, Compare>::split(const T& key, TreeSet& greater) {
+    TREESET_OPERATION("split");
+    if (&greater == this) {
+        return;
+    }
+    greater.clear();
+    Node* less;
+    Node* above;
+    Node* match = splitHelper(root_, key, less, above);
+    root_ = less;
+    if (root_ != nullptr) {
+        root_->parent_ = nullptr;
+    }
+    // greater takes its nodes from our slabs
+    greater.pool_.adopt(pool_);
+    Node* upper = (match == nullptr) ? above
+                                     : joinWithRoot(nullptr, match, above);
+    // our shape (and a TREAP's priorities) may not suit greater's treetype
+    if (greater.type_ != type_) {
+        upper = greater.rebuildBalanced(upper);
+    }
+    greater.root_ = upper;
+    if (greater.root_ != nullptr) {
+        greater.root_->parent_ = nullptr;
+    }
+}
+
+template <typename T, typename Compare>
+void TreeSet<T, Compare>::join(TreeSet& right) {
+    TREESET_OPERATION("join");
+    if (&right == this || right.root_ == nullptr) {
+        return;
+    }
+    // only a strict ordering of the two key ranges allows a plain join
+    if (root_ != nullptr && !precedes(rightmost(root_)->value_,
+                                      leftmost(right.root_)->value_)) {
+        setUnion(right);
+        return;
+    }
+    root_ = joinSubtrees(root_, takeNodes(right));
+    root_->parent_ = nullptr;
+    compactPool();
+}
+
+template <typename T, typename Compare>
+void TreeSet<T, Compare>::setUnion(TreeSet& other) {
+    TREESET_OPERATION("setUnion");
+    if (&other == this) {
+        return;
+    }
+    root_ = combineTrees(setop::UNION, root_, takeNodes(other));
+    if (root_ != nullptr) {
+        root_->parent_ = nullptr;
+    }
+    compactPool();
+}
+
+template <typename T, typename Compare>
+void TreeSet<T, Compare>::setIntersection(TreeSet& other) {
+    TREESET_OPERATION("setIntersection");
+    if (&other == this) {
+        return;
+    }
+    root_ = combineTrees(setop::INTERSECTION, root_, takeNodes(other));
+    if (root_ != nullptr) {
+        root_->parent_ = nullptr;
+    }
+    compactPool();
+}
+
+template <typename T, typename Compare>
+void TreeSet<T, Compare>::setDifference(TreeSet& other) {
+    TREESET_OPERATION("setDifference");
+    if (&other == this) {
+        clear();
+        return;
+    }
+    root_ = combineTrees(setop::DIFFERENCE, root_, takeNodes(other));
+    if (root_ != nullptr) {
+        root_->parent_ = nullptr;
+    }
+    compactPool();
+}
+
+template <typename T, typename Compare>
+void TreeSet<T, Compare>::eraseNode(Node* doomed) {
+    detachNode(doomed);
+    pool_.deallocate(doomed);
+}
+
+template <typename T, typename Compare>
+void TreeSet<T, Compare>::detachNode(Node* doomed) {
+    // every ancestor loses one descendant
+    for (Node* up = doomed->parent_; up != nullptr; up = up->parent_) {
+        --up->size_;
+    }
+    Node* replacement = joinSubtrees(doomed->leftChild_, doomed->rightChild_);
+    linkTo(doomed) = replacement;
+    if (replacement != nullptr) {
+        replacement->parent_ = doomed->parent_;
+    }
+    if (type_ == treetype::WEIGHT_BALANCED && doomed->parent_ != nullptr) {
+        rebalanceUp(doomed->parent_, root_);
+    }
+    splay(doomed->parent_);
+}
+
+template <typename T, typename Compare>
+size_t TreeSet<T, Compare>::erase(const T& val) {
+    TREESET_OPERATION("erase");
+    iterator iter = lower_bound(val);
+    // lower_bound is not less than val, so it matches unless val is less
+    if (iter == end() || precedes(val, *iter)) {
+        return 0;
+    }
+    eraseNode(iter.current_);
+    return 1;
+}
+
+template <typename T, typename Compare>
+typename TreeSet<T, Compare>::iterator
+TreeSet<T, Compare>::erase(iterator pos) {
+    TREESET_OPERATION("erase");
+    iterator next = pos;
+    ++next;
+    // the successor node survives the erase, so next stays valid
+    eraseNode(pos.current_);
+    return next;
+}
+
+template <typename T, typename Compare>
+typename TreeSet<T, Compare>::node_type
+TreeSet<T, Compare>::extract(const T& val) {
+    TREESET_OPERATION("extract");
+    iterator iter = lower_bound(val);
+    if (iter == end() || precedes(val, *iter)) {
+        return node_type();
+    }
+    return extract(iter);
+}
+
+template <typename T, typename Compare>
+typename TreeSet<T, Compare>::node_type
+TreeSet<T, Compare>::extract(iterator pos) {
+    TREESET_OPERATION("extract");
+    Node* node = pos.current_;
+    detachNode(node);
+    // move the element out before the node goes back to the pool
+    node_type handle(std::move(node->value_));
+    pool_.deallocate(node);
+    return handle;
+}
+
+template <typename T, typename Compare>
+bool TreeSet<T, Compare>::exists(const T& val) const {
+    TREESET_OPERATION("exists");
+    // one comparison per level finds the candidate; one more confirms it
+    const Node* found = lowerBoundNode(val);
+    return found != nullptr && !precedes(val, found->value_);
+}
+
+template <typename T, typename Compare>
+template <typename K, typename C, typename>
+bool TreeSet<T, Compare>::exists(const K& key) const {
+    TREESET_OPERATION("exists");
+    const Node* found = lowerBoundNode(key);
+    return found != nullptr && !precedes(key, found->value_);
+}
+
+template <typename T, typename Compare>
+void TreeSet<T, Compare>::existsBatch(const T* keys, size_t count,
+                                      vector<bool>& found) const {
+    TREESET_OPERATION("existsBatch");
+    vector<Node*> nodes;
+    lowerBoundNodes(keys, count, nodes);
+    found.assign(count, false);
+    for (size_t i = 0; i < count; ++i) {
+        found[i] = nodes[i] != nullptr && !precedes(keys[i], nodes[i]->value_);
+    }
+}
+
+template <typename T, typename Compare>
+FrozenSet<T, Compare> TreeSet<T, Compare>::freeze() const {
+    // in-order iteration hands FrozenSet the sorted, distinct range it needs
+    return FrozenSet<T, Compare>(begin(), end(), comp_);
+}
+
+template <typename T, typename Compare>
+typename TreeSet<T, Compare>::iterator
+TreeSet<T, Compare>::select(size_t k) const {
+    TREESET_OPERATION("select");
+    Node* cur = root_;
+    // use subtree sizes to steer towards the k-th node in O(height)
+    while (cur != nullptr) {
+        TREESET_COUNT(nodesVisited);
+        size_t leftSize = sizeOf(cur->leftChild_);
+        if (k < leftSize) {  // k-th element is in the left tree
+            cur = cur->leftChild_;
+        } else if (k == leftSize) {  // exactly k smaller elements
+            splay(cur);
+            return Iterator(cur, this);
+        } else {  // skip the left tree and this node
+            k -= leftSize + 1;
+            cur = cur->rightChild_;
+        }
+    }
+    return end();
+}
+
+template <typename T, typename Compare>
+size_t TreeSet<T, Compare>::countBelow(const T& val, bool inclusive) const {
+    size_t count = 0;
+    const Node* cur = root_;
+    while (cur != nullptr) {
+        // one comparison decides: < val, or <= val when inclusive
+        TREESET_COUNT(nodesVisited);
+        if (inclusive ? !precedes(val, cur->value_)
+                      : precedes(cur->value_, val)) {
+            // this node and all of its left tree are below val
+            count += sizeOf(cur->leftChild_) + 1;
+            cur = cur->rightChild_;
+        } else {
+            cur = cur->leftChild_;
+        }
+    }
+    return count;
+}
+
+template <typename T, typename Compare>
+size_t TreeSet<T, Compare>::rank(const T& val) const {
+    TREESET_OPERATION("rank");
+    return countBelow(val, false);
+}
+
+template <typename T, typename Compare>
+size_t TreeSet<T, Compare>::countBetween(const T& lo, const T& hi) const {
+    TREESET_OPERATION("countBetween");
+    if (precedes(hi, lo)) {
+        return 0;
+    }
+    return countBelow(hi, true) - countBelow(lo, false);
+}
+
+template <typename T, typename Compare>
+template <typename K>
+typename TreeSet<T, Compare>::Node*
+TreeSet<T, Compare>::lowerBoundNode(const K& key) const {
+    Node* candidate = nullptr;
+    Node* last = nullptr;
+    Node* cur = root_;
+    while (cur != nullptr) {
+        TREESET_COUNT(nodesVisited);
+        last = cur;
+        if (precedes(cur->value_, key)) {  // node and its left are too small
+            cur = cur->rightChild_;
+        } else {  // best so far, but something smaller may still qualify
+            candidate = cur;
+            cur = cur->leftChild_;
+        }
+    }
+    // splaying the deepest node reached pays for the whole descent; the
+    // answer is its neighbour in sorted order, so it is then one step away
+    splay(last);
+    splay(candidate);
+    return candidate;
+}
+
+template <typename T, typename Compare>
+void TreeSet<T, Compare>::lowerBoundNodes(const T* keys, size_t count,
+                                          vector<Node*>& nodes) const {
+    if (count > 1 && std::is_sorted(keys, keys + count, comp_)) {
+        lowerBoundSorted(keys, count, nodes);
+        return;
+    }
+    // one search in flight: the key it is for, where it is, best so far
+    struct Lane {
+        size_t key;
+        Node* cur;
+        Node* candidate;
+    };
+    nodes.assign(count, nullptr);
+    Lane lanes[BATCH_LANES];
+    size_t active = 0;
+    size_t next = 0;  // first key not yet given a lane
+    while (active < BATCH_LANES && next < count) {
+        lanes[active++] = Lane{next++, root_, nullptr};
+    }
+    // each lane takes one step per pass, so by the time a lane comes round
+    // again the node it prefetched has (usually) arrived
+    while (active > 0) {
+        size_t i = 0;
+        while (i < active) {
+            Lane& lane = lanes[i];
+            if (lane.cur == nullptr) {  // done; start the next key here
+                nodes[lane.key] = lane.candidate;
+                if (next < count) {
+                    lane = Lane{next++, root_, nullptr};
+                    ++i;
+                } else {  // nothing left to start, so close the lane
+                    lane = lanes[--active];
+                }
+                continue;
+            }
+            TREESET_COUNT(nodesVisited);
+            if (precedes(lane.cur->value_, keys[lane.key])) {
+                lane.cur = lane.cur->rightChild_;
+            } else {
+                lane.candidate = lane.cur;
+                lane.cur = lane.cur->leftChild_;
+            }
+            if (lane.cur != nullptr) {
+                __builtin_prefetch(lane.cur);
+            }
+            ++i;
+        }
+    }
+}
+
+template <typename T, typename Compare>
+void TreeSet<T, Compare>::lowerBoundSorted(const T* keys, size_t count,
+                                           vector<Node*>& nodes) const {
+    // a run of keys searched in turn: the key being searched for, the end
+    // of the run, where the search is, and each node on its path from the
+    // root where it went left (the last is the best answer so far)
+    struct Lane {
+        size_t key;
+        size_t end;
+        Node* cur;
+        vector<Node*> lefts;
+    };
+    nodes.assign(count, nullptr);
+    Lane lanes[BATCH_LANES];
+    size_t active = 0;
+    for (size_t run = 0; run < BATCH_LANES; ++run) {
+        size_t first = run * count / BATCH_LANES;
+        size_t end = (run + 1) * count / BATCH_LANES;
+        if (first < end) {
+            lanes[active++] = Lane{first, end, root_, {}};
+        }
+    }
+    while (active > 0) {
+        size_t i = 0;
+        while (i < active) {
+            Lane& lane = lanes[i];
+            if (lane.cur != nullptr) {  // one step, as in lowerBoundNodes
+                TREESET_COUNT(nodesVisited);
+                if (precedes(lane.cur->value_, keys[lane.key])) {
+                    lane.cur = lane.cur->rightChild_;
+                } else {
+                    lane.lefts.push_back(lane.cur);
+                    lane.cur = lane.cur->leftChild_;
+                }
+                if (lane.cur != nullptr) {
+                    __builtin_prefetch(lane.cur);
+                }
+                ++i;
+                continue;
+            }
+            nodes[lane.key] = lane.lefts.empty() ? nullptr
+                                                 : lane.lefts.back();
+            if (++lane.key == lane.end) {  // run finished, close the lane
+                std::swap(lane, lanes[--active]);
+                continue;
+            }
+            // Below a left turn at L the path only holds values less than
+            // L, and the previous key, which was not more than this one,
+            // lies there. So while this key is not more than L, the search
+            // shares that part of the path. Drop the left turns it is
+            // past; the path parts at the last one dropped, which this
+            // key is also past, so the search goes right from there.
+            Node* parted = nullptr;
+            while (!lane.lefts.empty() &&
+                   precedes(lane.lefts.back()->value_, keys[lane.key])) {
+                parted = lane.lefts.back();
+                lane.lefts.pop_back();
+            }
+            // with nothing dropped, the answer is the previous one
+            lane.cur = (parted == nullptr) ? nullptr : parted->rightChild_;
+            ++i;
+        }
+    }
+}
+
+template <typename T, typename Compare>
+template <typename K>
+typename TreeSet<T, Compare>::Node*
+TreeSet<T, Compare>::upperBoundNode(const K& key) const {
+    Node* candidate = nullptr;
+    Node* last = nullptr;
+    Node* cur = root_;
+    while (cur != nullptr) {
+        TREESET_COUNT(nodesVisited);
+        last = cur;
+        if (precedes(key, cur->value_)) {  // best so far, look for smaller
+            candidate = cur;
+            cur = cur->leftChild_;
+        } else {  // this node and its left tree are not greater
+            cur = cur->rightChild_;
+        }
+    }
+    splay(last);
+    splay(candidate);
+    return candidate;
+}
+
+template <typename T, typename Compare>
+typename TreeSet<T, Compare>::iterator
+TreeSet<T, Compare>::lower_bound(const T& val) const {
+    TREESET_OPERATION("lower_bound");
+    return Iterator(lowerBoundNode(val), this);
+}
+
+template <typename T, typename Compare>
+template <typename K, typename C, typename>
+typename TreeSet<T, Compare>::iterator
+TreeSet<T, Compare>::lower_bound(const K& key) const {
+    TREESET_OPERATION("lower_bound");
+    return Iterator(lowerBoundNode(key), this);
+}
+
+template <typename T, typename Compare>
+void TreeSet<T, Compare>::lowerBoundBatch(const T* keys, size_t count,
+                                          vector<iterator>& bounds) const {
+    TREESET_OPERATION("lowerBoundBatch");
+    vector<Node*> nodes;
+    lowerBoundNodes(keys, count, nodes);
+    bounds.clear();
+    bounds.reserve(count);
+    for (Node* node : nodes) {
+        bounds.push_back(Iterator(node, this));
+    }
+}
+
+template <typename T, typename Compare>
+typename TreeSet<T, Compare>::iterator
+TreeSet<T, Compare>::upper_bound(const T& val) const {
+    TREESET_OPERATION("upper_bound");
+    return Iterator(upperBoundNode(val), this);
+}
+
+template <typename T, typename Compare>
+template <typename K, typename C, typename>
+typename TreeSet<T, Compare>::iterator
+TreeSet<T, Compare>::upper_bound(const K& key) const {
+    TREESET_OPERATION("upper_bound");
+    return Iterator(upperBoundNode(key), this);
+}
+
+template <typename T, typename Compare>
+pair<typename TreeSet<T, Compare>::iterator,
+     typename TreeSet<T, Compare>::iterator>
+TreeSet<T, Compare>::equal_range(const T& val) const {
+    return {lower_bound(val), upper_bound(val)};
+}
+
+template <typename T, typename Compare>
+typename TreeSet<T, Compare>::range_view TreeSet<T, Compare>::range(const T& lo,
+                                                  const T& hi) const {
+    if (precedes(hi, lo)) {
+        return Range(end(), end());
+    }
+    return Range(lower_bound(lo), upper_bound(hi));
+}
+
+template <typename T, typename Compare>
+TreeSet<T, Compare>::Range::Range(Iterator first, Iterator last)
+    : first_(first), last_(last) {
+    // Nothing else to do.
+}
+
+template <typename T, typename Compare>
+typename TreeSet<T, Compare>::Iterator
+TreeSet<T, Compare>::Range::begin() const {
+    return first_;
+}
+
+template <typename T, typename Compare>
+typename TreeSet<T, Compare>::Iterator TreeSet<T, Compare>::Range::end() const {
+    return last_;
+}
+
+template <typename T, typename Compare>
+bool TreeSet<T, Compare>::Range::empty() const {
+    return first_ == last_;
+}
+
+template <typename T, typename Compare>
+TreeSet<T, Compare>::NodeHandle::NodeHandle(T&& val)
+    : value_(std::move(val)) {
+    // Nothing else to do.
+}
+
+template <typename T, typename Compare>
+bool TreeSet<T, Compare>::NodeHandle::empty() const {
+    return !value_.has_value();
+}
+
+template <typename T, typename Compare>
+TreeSet<T, Compare>::NodeHandle::operator bool() const {
+    return value_.has_value();
+}
+
+template <typename T, typename Compare>
+T& TreeSet<T, Compare>::NodeHandle::value() {
+    return *value_;
 }
 
-template <typename T>
-bool TreeSet<T>::operator==(const TreeSet<T>& rhs) const {
+template <typename T, typename Compare>
+const T& TreeSet<T, Compare>::NodeHandle::value() const {
+    return *value_;
+}
+
+template <typename T, typename Compare>
+bool TreeSet<T, Compare>::operator==(const TreeSet<T, Compare>& rhs) const {
     // check that sizes are equal
     if (size() != rhs.size()) {
         return false;
     }
-    // if sizes are equal, iterate through one tree to check that all values
-    // present are present in the other tree as well
-    for (TreeSet<T>::iterator iter = begin(); iter != end(); ++iter) {
-        if (!(rhs.exists(*iter))) {
-            return false;
+    // if sizes are equal, walk both trees in order side by side and stop
+    // at the first pair of elements that differ
+    return std::equal(begin(), end(), rhs.begin());
+}
+
+template <typename T, typename Compare>
+bool TreeSet<T, Compare>::operator!=(const TreeSet<T, Compare>& rhs) const {
+    return !operator==(rhs);
+}
+
+template <typename T, typename Compare>
+int TreeSet<T, Compare>::compare(const TreeSet<T, Compare>& rhs) const {
+    iterator lhsIter = begin();
+    iterator rhsIter = rhs.begin();
+    // walk both trees in order until one differs or runs out
+    for (; lhsIter != end() && rhsIter != rhs.end(); ++lhsIter, ++rhsIter) {
+        if (precedes(*lhsIter, *rhsIter)) {
+            return -1;
+        } else if (precedes(*rhsIter, *lhsIter)) {
+            return 1;
         }
     }
-    return true;
+    if (lhsIter != end()) {  // rhs is a proper prefix of *this
+        return 1;
+    } else if (rhsIter != rhs.end()) {  // *this is a proper prefix of rhs
+        return -1;
+    }
+    return 0;
 }
 
-template <typename T>
-bool TreeSet<T>::operator!=(const TreeSet<T>& rhs) const {
-    return !operator==(rhs);
+template <typename T, typename Compare>
+bool TreeSet<T, Compare>::operator<(const TreeSet<T, Compare>& rhs) const {
+    return compare(rhs) < 0;
+}
+
+template <typename T, typename Compare>
+bool TreeSet<T, Compare>::operator<=(const TreeSet<T, Compare>& rhs) const {
+    return compare(rhs) <= 0;
 }
 
-template <typename T>
-ostream& operator<<(ostream& os, const TreeSet<T>& t) {
+template <typename T, typename Compare>
+bool TreeSet<T, Compare>::operator>(const TreeSet<T, Compare>& rhs) const {
+    return compare(rhs) > 0;
+}
+
+template <typename T, typename Compare>
+bool TreeSet<T, Compare>::operator>=(const TreeSet<T, Compare>& rhs) const {
+    return compare(rhs) >= 0;
+}
+
+#ifdef TREESET_INSTRUMENT
+template <typename T, typename Compare>
+const OperationCounters& TreeSet<T, Compare>::counters() const {
+    return counters_;
+}
+
+template <typename T, typename Compare>
+const OperationCounters& TreeSet<T, Compare>::lastOperation() const {
+    return lastOperation_;
+}
+
+template <typename T, typename Compare>
+void TreeSet<T, Compare>::resetCounters() {
+    counters_ = OperationCounters();
+    lastOperation_ = OperationCounters();
+}
+
+template <typename T, typename Compare>
+void TreeSet<T, Compare>::setLatencyHook(LatencyHook hook) {
+    latencyHook_ = std::move(hook);
+}
+
+template <typename T, typename Compare>
+TreeSet<T, Compare>::OperationScope::OperationScope(const TreeSet* tree,
+                                                    const char* name)
+    : tree_(tree), name_(name), start_(tree->counters_) {
+    // reading the clock costs more than counting, so skip it unless asked
+    if (tree_->operationDepth_++ == 0 && tree_->latencyHook_) {
+        began_ = std::chrono::steady_clock::now();
+    }
+}
+
+template <typename T, typename Compare>
+TreeSet<T, Compare>::OperationScope::~OperationScope() {
+    // an operation that calls another reports once, as itself
+    if (--tree_->operationDepth_ != 0) {
+        return;
+    }
+    tree_->lastOperation_ = tree_->counters_ - start_;
+    if (tree_->latencyHook_) {
+        auto elapsed = std::chrono::steady_clock::now() - began_;
+        uint64_t nanoseconds = std::chrono::duration_cast<
+            std::chrono::nanoseconds>(elapsed).count();
+        tree_->latencyHook_(name_, nanoseconds, tree_->lastOperation_);
+    }
+}
+#endif
+
+template <typename T, typename Compare>
+ostream& operator<<(ostream& os, const TreeSet<T, Compare>& t) {
     return t.print(os);
 }
 
-template <typename T>
-ostream& TreeSet<T>::printerHelper(const Node* tree, ostream& os) const {
-    // print nothing if tree is empty
+template <typename T, typename Compare>
+ostream& TreeSet<T, Compare>::printerHelper(const Node* tree, ostream& os,
+                                            bool sizes) const {
+    // empty trees print as "-", or as a size of "0"
+    const char* empty = sizes ? "0" : "-";
     if (tree == nullptr) {
-        os << "-";
-    } else {  // print using CS70 conventions otherwise
-        os << "(";
-        printerHelper(tree->leftChild_, os);
-        os << ", " << tree->value_ << ", ";
-        printerHelper(tree->rightChild_, os);
-        os << ")";
+        return os << empty;
+    }
+    // walk over parent links; where we came from says what to print next
+    const Node* stop = tree->parent_;
+    const Node* from = stop;
+    const Node* cur = tree;
+    while (cur != stop) {
+        const Node* next = cur->parent_;
+        bool arrived = (from == cur->parent_);
+        if (arrived) {  // first visit: open, then go left
+            os << "(";
+            if (cur->leftChild_ != nullptr) {
+                next = cur->leftChild_;
+            } else {
+                os << empty;
+            }
+        }
+        bool leftDone = arrived ? (cur->leftChild_ == nullptr)
+                                : (from == cur->leftChild_);
+        if (leftDone) {  // print the value, then go right
+            os << ", ";
+            if (sizes) {
+                os << cur->size_;
+            } else {
+                os << cur->value_;
+            }
+            os << ", ";
+            if (cur->rightChild_ != nullptr) {
+                next = cur->rightChild_;
+            } else {
+                os << empty;
+            }
+        }
+        if (next == cur->parent_) {  // both sides done
+            os << ")";
+        }
+        from = cur;
+        cur = next;
     }
     return os;
 }
 
-template <typename T>
-ostream& TreeSet<T>::print(ostream& os) const {
-    return printerHelper(root_, os);
+template <typename T, typename Compare>
+ostream& TreeSet<T, Compare>::print(ostream& os) const {
+    return printerHelper(root_, os, false);
 }
 
-template <typename T>
-typename TreeSet<T>::iterator TreeSet<T>::begin() const {
-    return TreeSet<T>::Iterator(root_);
+template <typename T, typename Compare>
+typename TreeSet<T, Compare>::iterator TreeSet<T, Compare>::begin() const {
+    if (root_ == nullptr) {
+        return end();
+    }
+    return TreeSet<T, Compare>::Iterator(leftmost(root_), this);
 }
 
-template <typename T>
-typename TreeSet<T>::iterator TreeSet<T>::end() const {
-    return TreeSet<T>::Iterator(nullptr);
+template <typename T, typename Compare>
+typename TreeSet<T, Compare>::iterator TreeSet<T, Compare>::end() const {
+    return TreeSet<T, Compare>::Iterator(nullptr, this);
 }
 
-template <typename T>
-TreeSet<T>::Iterator::Iterator(Node* current) : current_(current) {
+template <typename T, typename Compare>
+TreeSet<T, Compare>::Iterator::Iterator(Node* current, const TreeSet* tree)
+    : current_(current), tree_(tree) {
     // Nothing else to do.
 }
 
-template <typename T>
-typename TreeSet<T>::Iterator& TreeSet<T>::Iterator::operator++() {
-    if (current_->leftChild_ != nullptr) {  // add left child to node queue
-        pending_.push(current_->leftChild_);
-    }
-    if (current_->rightChild_ != nullptr) {  // add right child to node queue
-        pending_.push(current_->rightChild_);
+template <typename T, typename Compare>
+typename TreeSet<T, Compare>::Iterator&
+TreeSet<T, Compare>::Iterator::operator++() {
+    if (current_->rightChild_ != nullptr) {  // successor is below us
+        current_ = leftmost(current_->rightChild_);
+    } else {  // climb until we arrive from a left subtree
+        Node* child = current_;
+        current_ = current_->parent_;
+        while (current_ != nullptr && child == current_->rightChild_) {
+            child = current_;
+            current_ = current_->parent_;
+        }
     }
-    if (!pending_.empty()) {  // visit next node
-        current_ = pending_.front();
-        pending_.pop();
-    } else {  // if at end, set current to null pointer
-        current_ = nullptr;
+    return *this;
+}
+
+template <typename T, typename Compare>
+typename TreeSet<T, Compare>::Iterator
+TreeSet<T, Compare>::Iterator::operator++(int) {
+    Iterator old = *this;
+    ++*this;
+    return old;
+}
+
+template <typename T, typename Compare>
+typename TreeSet<T, Compare>::Iterator&
+TreeSet<T, Compare>::Iterator::operator--() {
+    if (current_ == nullptr) {  // stepping back from end() lands on the max
+        current_ = rightmost(tree_->root_);
+    } else if (current_->leftChild_ != nullptr) {  // predecessor is below us
+        current_ = rightmost(current_->leftChild_);
+    } else {  // climb until we arrive from a right subtree
+        Node* child = current_;
+        current_ = current_->parent_;
+        while (current_ != nullptr && child == current_->leftChild_) {
+            child = current_;
+            current_ = current_->parent_;
+        }
     }
     return *this;
 }
 
-template <typename T>
-T& TreeSet<T>::Iterator::operator*() const {
+template <typename T, typename Compare>
+typename TreeSet<T, Compare>::Iterator
+TreeSet<T, Compare>::Iterator::operator--(int) {
+    Iterator old = *this;
+    --*this;
+    return old;
+}
+
+template <typename T, typename Compare>
+const T& TreeSet<T, Compare>::Iterator::operator*() const {
     return current_ -> value_;
 }
 
-template <typename T>
-T* TreeSet<T>::Iterator::operator->() const {
+template <typename T, typename Compare>
+const T* TreeSet<T, Compare>::Iterator::operator->() const {
   return &(**this);
 }
 
-template <typename T>
-bool TreeSet<T>::Iterator::operator==(const Iterator& rhs) const {
-    return (current_ == rhs.current_) & (pending_ == rhs.pending_);
+template <typename T, typename Compare>
+bool TreeSet<T, Compare>::Iterator::operator==(const Iterator& rhs) const {
+    return current_ == rhs.current_;
 }
 
-template <typename T>
-bool TreeSet<T>::Iterator::operator!=(const Iterator& rhs) const {
+template <typename T, typename Compare>
+bool TreeSet<T, Compare>::Iterator::operator!=(const Iterator& rhs) const {
     // Idiomatic code: leverage == to implement !=
     return !(*this == rhs);
 }
 
-template <typename T>
-TreeSet<T>::Node::Node(T val)
-    : value_(val), leftChild_(nullptr), rightChild_(nullptr), size_(1) {
+template <typename T, typename Compare>
+template <typename... Args>
+TreeSet<T, Compare>::Node::Node(Args&&... args)
+    : value_(std::forward<Args>(args)...), priority_(0),
+      leftChild_(nullptr), rightChild_(nullptr), parent_(nullptr),
+      size_(1) {
         // nothing else to do
 }
 
-template <typename T>
-double TreeSet<T>::depthHelper(const Node* cur, double& h) const {
-    // if doesn't exist, it has no depth
-    if (cur == nullptr) {
-        return 0;
-        // if neither child exists, we are at leaf so return height
-    } else if (cur->leftChild_ == nullptr && cur->rightChild_ == nullptr) {
-        return h;
-    }
-    // add one to height and recursively find total depth
-    double newHeight = h + 1;
-    return h + depthHelper(cur->leftChild_, newHeight)
-                    + depthHelper(cur->rightChild_, newHeight);
-}
-
-template <typename T>
-double TreeSet<T>::averageDepth() const {
+template <typename T, typename Compare>
+TreeStatistics TreeSet<T, Compare>::statistics() const {
+    TreeStatistics stats;
     if (root_ == nullptr) {
-        return 0.0;
-    } else {
-        double total = 0;
-        return depthHelper(root_, total)/static_cast<double>(root_->size_);
+        return stats;
+    }
+    // in-order walk over parent links, tracking the depth as we move
+    const Node* cur = root_;
+    size_t depth = 0;
+    while (cur->leftChild_ != nullptr) {
+        cur = cur->leftChild_;
+        ++depth;
     }
+    double totalDepth = 0;
+    while (cur != nullptr) {
+        if (depth >= stats.depthCounts.size()) {
+            stats.depthCounts.resize(depth + 1, 0);
+        }
+        ++stats.depthCounts[depth];
+        totalDepth += static_cast<double>(depth);
+        if (cur->rightChild_ != nullptr) {  // next is leftmost on the right
+            cur = cur->rightChild_;
+            ++depth;
+            while (cur->leftChild_ != nullptr) {
+                cur = cur->leftChild_;
+                ++depth;
+            }
+        } else {  // climb past every right step, then one left step
+            while (cur->parent_ != nullptr &&
+                   cur->parent_->rightChild_ == cur) {
+                cur = cur->parent_;
+                --depth;
+            }
+            cur = cur->parent_;
+            --depth;
+        }
+    }
+    stats.nodes = root_->size_;
+    stats.height = static_cast<int>(stats.depthCounts.size()) - 1;
+    stats.averageDepth = totalDepth / static_cast<double>(stats.nodes);
+    // a tree of n nodes needs at least bit-length(n) levels
+    size_t fewestLevels = 0;
+    for (size_t n = stats.nodes; n != 0; n >>= 1) {
+        ++fewestLevels;
+    }
+    stats.balance = static_cast<double>(stats.depthCounts.size()) /
+                    static_cast<double>(fewestLevels);
+    return stats;
 }
 
-template <typename T>
-int TreeSet<T>::heightHelper(const Node* current) const {
-    // if we are at null it has no height
-    if (current == nullptr) {
-        return -1;
-    } else {  // else return 1 plus max of height of right tree, left tree
-        return 1 + max(heightHelper(current->leftChild_),
-                        heightHelper(current->rightChild_));
-    }
+template <typename T, typename Compare>
+double TreeSet<T, Compare>::averageDepth() const {
+    return statistics().averageDepth;
 }
 
-template <typename T>
-int TreeSet<T>::height() const {
-    return heightHelper(root_);
+template <typename T, typename Compare>
+int TreeSet<T, Compare>::height() const {
+    return statistics().height;
 }
 
-template <typename T>
-ostream& TreeSet<T>::showStatistics(ostream& os) const {
-    os << size() << " nodes, height " << height() << ", average depth "
-        << averageDepth() << endl;
-    return os;
+template <typename T, typename Compare>
+size_t TreeSet<T, Compare>::bytesUsed() const {
+    return pool_.capacity() * sizeof(Node);
 }
 
-template <typename T>
-ostream& TreeSet<T>::printSizesHelper(ostream& os, Node*& cur) const {
-    if (cur == nullptr) {
-        os << "0";
-    } else {
-        os << "(" << printSizesHelper(os, cur->leftChild_) << ", " <<
-        to_string(cur->size_) << ", " << printSizesHelper(os, cur->rightChild_)
-        << ")";  // follow cs 70 idioms for printing out sizes
-    }
+template <typename T, typename Compare>
+ostream& TreeSet<T, Compare>::showStatistics(ostream& os) const {
+    TreeStatistics stats = statistics();
+    os << stats.nodes << " nodes, height " << stats.height
+       << ", average depth " << stats.averageDepth << endl;
     return os;
 }
 
-template <typename T>
-ostream& TreeSet<T>::printSizes(ostream& os) const {
-    // if tree is empty print "0"
-    if (size() == 0) {
-        os << "0";
-        return os;
-    } else {
-        return printSizesHelper(os, root_);
-    }
+template <typename T, typename Compare>
+ostream& TreeSet<T, Compare>::printSizes(ostream& os) const {
+    return printerHelper(root_, os, true);
 }
 
 #endif
@@ -1,5 +1,6 @@
 #include <cstddef>
 #include <cstdlib>
+#include <functional>
 #include <iostream>
 #include <list>
 #include <map>
@@ -13,6 +14,8 @@
 #include <cs70/testinglogger.hpp>
 #include <cs70/randuint32.hpp>
 
+// count the work TreeSet does, so the tests can check it
+#define TREESET_INSTRUMENT
 #include "treeset.hpp"
 
 using namespace std;
@@ -37,6 +40,294 @@ bool insertTest() {
     return log.summarize();
 }
 
+bool insertResultTest() {
+    TestingLogger log("insert result");
+
+    for (treetype t : {treetype::LEAF, treetype::ROOT, treetype::RANDOMIZED,
+                       treetype::TREAP, treetype::WEIGHT_BALANCED,
+                       treetype::SPLAY, treetype::SEMI_SPLAY}) {
+        TreeSet<string> mySet(t, 5);
+        mySet.insert("b");
+        mySet.insert("a");
+
+        auto first = mySet.insert("c");
+        affirm(first.second);
+        affirm(*first.first == "c");
+
+        auto again = mySet.insert("a");
+        affirm(!again.second);
+        affirm(*again.first == "a");
+        affirm(mySet.size() == 3);
+    }
+
+    return log.summarize();
+}
+
+bool eraseTest() {
+    TestingLogger log("erase");
+
+    for (treetype t : {treetype::LEAF, treetype::ROOT, treetype::RANDOMIZED,
+                       treetype::TREAP, treetype::WEIGHT_BALANCED,
+                       treetype::SPLAY, treetype::SEMI_SPLAY}) {
+        TreeSet<int> mySet(t, 9);
+        for (int i = 0; i < 100; ++i) {
+            mySet.insert((i * 31) % 100);
+        }
+
+        affirm(mySet.erase(1000) == 0);
+        // remove every multiple of three, in scrambled order
+        for (int i = 0; i < 100; ++i) {
+            int victim = (i * 17) % 100;
+            if (victim % 3 == 0) {
+                affirm(mySet.erase(victim) == 1);
+            }
+        }
+        affirm(mySet.size() == 66);
+        affirm(!mySet.exists(27));
+        affirm(mySet.exists(28));
+        affirm(mySet.rank(28) == 18);
+
+        int expected = 1;
+        for (int value : mySet) {
+            affirm(value == expected);
+            expected += (expected % 3 == 1) ? 1 : 2;
+        }
+    }
+
+    return log.summarize();
+}
+
+bool eraseIteratorTest() {
+    TestingLogger log("erase iterator");
+
+    TreeSet<string> mySet(treetype::RANDOMIZED, 2);
+    for (string s : {"d", "b", "f", "a", "c", "e", "g"}) {
+        mySet.insert(s);
+    }
+
+    TreeSet<string>::iterator iter = mySet.begin();
+    while (iter != mySet.end()) {
+        if (*iter != "e") {
+            iter = mySet.erase(iter);
+        } else {
+            ++iter;
+        }
+    }
+    affirm(mySet.size() == 1);
+    affirm(*mySet.begin() == "e");
+
+    mySet.erase(mySet.begin());
+    affirm(mySet.size() == 0);
+    affirm(mySet.begin() == mySet.end());
+
+    mySet.insert("z");
+    affirm(mySet.exists("z"));
+
+    return log.summarize();
+}
+
+bool splitJoinTest() {
+    TestingLogger log("split join");
+
+    TreeSet<int> mySet(treetype::RANDOMIZED, 6);
+    for (int i = 0; i < 40; ++i) {
+        mySet.insert(i);
+    }
+
+    TreeSet<int> upper(treetype::RANDOMIZED, 8);
+    upper.insert(1000);  // replaced by the split
+    mySet.split(25, upper);
+    affirm(mySet.size() == 25);
+    affirm(upper.size() == 15);
+    affirm(*upper.begin() == 25);
+    affirm(!upper.exists(1000));
+    affirm(!mySet.exists(25));
+
+    mySet.join(upper);
+    affirm(mySet.size() == 40);
+    affirm(upper.size() == 0);
+    affirm(mySet.rank(30) == 30);
+
+    // overlapping ranges still produce the union
+    TreeSet<int> overlap(treetype::RANDOMIZED, 1);
+    overlap.insert(39);
+    overlap.insert(40);
+    mySet.join(overlap);
+    affirm(mySet.size() == 41);
+
+    // nodes moving to a Tree of another treetype are rebuilt to suit it,
+    // so inserts that rely on its shape (or priorities) stay shallow
+    vector<treetype> types = {treetype::LEAF, treetype::ROOT,
+                              treetype::RANDOMIZED, treetype::TREAP,
+                              treetype::WEIGHT_BALANCED, treetype::SPLAY};
+    for (treetype t : types) {
+        for (treetype u : types) {
+            if (t == u) {
+                continue;
+            }
+            bool balanced = (u == treetype::RANDOMIZED ||
+                             u == treetype::TREAP ||
+                             u == treetype::WEIGHT_BALANCED);
+            TreeSet<int> lower(t, 2);
+            for (int i = 0; i < 1000; ++i) {
+                lower.insert(i);
+            }
+            TreeSet<int> upper(u, 3);
+            lower.split(500, upper);
+            affirm(lower.size() == 500);
+            affirm(upper.size() == 500);
+            affirm(*upper.begin() == 500);
+            for (int i = 1000; i < 2000; ++i) {
+                upper.insert(i);
+            }
+            affirm(!balanced || upper.height() <= 40);
+
+            // a joined LEAF path is rebuilt the same way
+            TreeSet<int> joined(u, 4);
+            joined.insert(-1);
+            joined.join(lower);
+            affirm(joined.size() == 501);
+            affirm(*joined.select(500) == 499);
+            for (int i = -1000; i < -1; ++i) {
+                joined.insert(i);
+            }
+            affirm(!balanced || joined.height() <= 40);
+        }
+    }
+
+    return log.summarize();
+}
+
+bool setAlgebraTest() {
+    TestingLogger log("set algebra");
+
+    for (treetype t : {treetype::LEAF, treetype::ROOT, treetype::RANDOMIZED,
+                       treetype::TREAP, treetype::WEIGHT_BALANCED,
+                       treetype::SPLAY, treetype::SEMI_SPLAY}) {
+        TreeSet<int> evens(t, 3);
+        TreeSet<int> threes(t, 4);
+        for (int i = 0; i < 30; ++i) {
+            evens.insert(2 * i);  // 0..58
+            threes.insert(3 * i);  // 0..87
+        }
+
+        TreeSet<int> both(t, 5);
+        TreeSet<int> other(t, 6);
+        for (int i = 0; i < 30; ++i) {
+            both.insert(2 * i);
+            other.insert(3 * i);
+        }
+        both.setIntersection(other);
+        affirm(both.size() == 10);  // multiples of 6 below 60
+        affirm(other.size() == 0);
+        affirm(*both.select(9) == 54);
+
+        TreeSet<int> onlyEven(t, 7);
+        TreeSet<int> subtract(t, 8);
+        for (int i = 0; i < 30; ++i) {
+            onlyEven.insert(2 * i);
+            subtract.insert(3 * i);
+        }
+        onlyEven.setDifference(subtract);
+        affirm(onlyEven.size() == 20);
+        affirm(!onlyEven.exists(6));
+        affirm(onlyEven.exists(4));
+
+        evens.setUnion(threes);
+        affirm(evens.size() == 50);  // 30 + 30 - 10 shared
+        affirm(threes.size() == 0);
+        affirm(*evens.select(0) == 0);
+        affirm(*evens.select(49) == 87);
+    }
+
+    // an operand of another treetype is rebuilt before it is combined, so
+    // a path of 1000 nodes (sorted into a LEAF tree) does not survive
+    for (treetype t : {treetype::RANDOMIZED, treetype::TREAP,
+                       treetype::WEIGHT_BALANCED}) {
+        for (treetype u : {treetype::LEAF, treetype::ROOT,
+                           treetype::RANDOMIZED, treetype::TREAP,
+                           treetype::WEIGHT_BALANCED, treetype::SPLAY}) {
+            if (t == u) {
+                continue;
+            }
+            TreeSet<int> unioned(t, 9);
+            TreeSet<int> meet(t, 10);
+            TreeSet<int> minus(t, 11);
+            for (int i = 0; i < 1000; i += 100) {
+                unioned.insert(i);
+                meet.insert(i);
+                minus.insert(i);
+            }
+            TreeSet<int> path(u, 12);
+            TreeSet<int> path2(u, 13);
+            TreeSet<int> path3(u, 14);
+            for (int i = 0; i < 1000; ++i) {
+                path.insert(i);
+                path2.insert(i);
+                path3.insert(i);
+            }
+
+            unioned.setUnion(path);
+            affirm(unioned.size() == 1000);
+            affirm(unioned.height() <= 14);
+            affirm(*unioned.select(567) == 567);
+
+            // the small set's few nodes lead, so most of path stays whole
+            meet.setIntersection(path2);
+            affirm(meet.size() == 10);
+            affirm(meet.height() <= 6);
+
+            path3.setDifference(minus);
+            affirm(path3.size() == 990);
+            affirm(*path3.select(99) == 101);
+        }
+    }
+
+    return log.summarize();
+}
+
+bool setAlgebraPoolTest() {
+    TestingLogger log("set algebra pool");
+
+    for (treetype t : {treetype::LEAF, treetype::RANDOMIZED, treetype::TREAP,
+                       treetype::WEIGHT_BALANCED, treetype::SPLAY}) {
+        // scrambled, so LEAF trees stay shallow
+        TreeSet<int> built(t, 2);
+        for (int i = 0; i < 4000; ++i) {
+            built.insert(i * 7919 % 4000);
+        }
+
+        // each small set is copied in, so its mostly empty slab is not kept
+        TreeSet<int> merged(t, 3);
+        merged.insert(-1);
+        for (int i = 0; i < 4000; ++i) {
+            TreeSet<int> one(t, i);
+            one.insert(i * 7919 % 4000);
+            merged.setUnion(one);
+        }
+        affirm(merged.size() == 4001);
+        affirm(merged.bytesUsed() <= 2 * built.bytesUsed());
+
+        // a large set's slabs are shared, then dropped once they are sparse
+        TreeSet<int> few(t, 4);
+        for (int i = 0; i < 10; ++i) {
+            few.insert(i * 400);
+        }
+        for (int round = 0; round < 50; ++round) {
+            TreeSet<int> large(t, round);
+            for (int i = 0; i < 4000; ++i) {
+                large.insert(i * 7919 % 4000);
+            }
+            few.setIntersection(large);
+        }
+        affirm(few.size() == 10);
+        affirm(*few.select(9) == 3600);
+        affirm(few.bytesUsed() <= built.bytesUsed());
+    }
+
+    return log.summarize();
+}
+
 bool existsTest() {
     TestingLogger log("exists");
 
@@ -51,6 +342,116 @@ bool existsTest() {
 }
 
 
+bool orderStatisticsTest() {
+    TestingLogger log("order statistics");
+
+    for (treetype t : {treetype::LEAF, treetype::ROOT, treetype::RANDOMIZED,
+                       treetype::TREAP, treetype::WEIGHT_BALANCED,
+                       treetype::SPLAY, treetype::SEMI_SPLAY}) {
+        TreeSet<int> mySet(t, 7);
+        for (int i = 0; i < 50; ++i) {
+            mySet.insert((i * 13) % 50 * 2);  // even numbers 0..98
+        }
+
+        affirm(*mySet.select(0) == 0);
+        affirm(*mySet.select(10) == 20);
+        affirm(*mySet.select(49) == 98);
+        affirm(mySet.select(50) == mySet.end());
+
+        affirm(mySet.rank(0) == 0);
+        affirm(mySet.rank(20) == 10);
+        affirm(mySet.rank(21) == 11);
+        affirm(mySet.rank(1000) == 50);
+
+        affirm(mySet.countBetween(10, 20) == 6);
+        affirm(mySet.countBetween(11, 19) == 4);
+        affirm(mySet.countBetween(20, 10) == 0);
+    }
+
+    return log.summarize();
+}
+
+bool boundsTest() {
+    TestingLogger log("bounds");
+
+    TreeSet<int> mySet(treetype::ROOT);
+    for (int i = 0; i < 10; ++i) {
+        mySet.insert(i * 10);
+    }
+
+    affirm(*mySet.lower_bound(30) == 30);
+    affirm(*mySet.lower_bound(31) == 40);
+    affirm(*mySet.upper_bound(30) == 40);
+    affirm(*mySet.lower_bound(-5) == 0);
+    affirm(mySet.lower_bound(91) == mySet.end());
+    affirm(mySet.upper_bound(90) == mySet.end());
+
+    auto found = mySet.equal_range(50);
+    affirm(*found.first == 50);
+    affirm(*found.second == 60);
+
+    auto missing = mySet.equal_range(55);
+    affirm(missing.first == missing.second);
+
+    return log.summarize();
+}
+
+bool rangeTest() {
+    TestingLogger log("range");
+
+    TreeSet<string> mySet(treetype::RANDOMIZED, 4);
+    for (string s : {"ant", "bee", "cat", "dog", "eel", "fox"}) {
+        mySet.insert(s);
+    }
+
+    string seen;
+    for (const string& s : mySet.range("bat", "dog")) {
+        seen += s + " ";
+    }
+    affirm(seen == "bee cat dog ");
+
+    affirm(mySet.range("x", "z").empty());
+    affirm(mySet.range("fox", "ant").empty());
+
+    return log.summarize();
+}
+
+bool freezeTest() {
+    TestingLogger log("freeze");
+
+    TreeSet<int> empty;
+    FrozenSet<int> frozenEmpty = empty.freeze();
+    affirm(frozenEmpty.size() == 0);
+    affirm(!frozenEmpty.exists(1));
+    affirm(frozenEmpty.begin() == frozenEmpty.end());
+
+    for (int n : {1, 2, 7, 8, 100}) {
+        TreeSet<int> mySet(treetype::RANDOMIZED, n);
+        for (int i = 0; i < n; ++i) {
+            mySet.insert(3 * i);
+        }
+        FrozenSet<int> frozen = mySet.freeze();
+        affirm(frozen.size() == mySet.size());
+        affirm(frozen.exists(0));
+        affirm(frozen.exists(3 * (n - 1)));
+        affirm(!frozen.exists(1));
+        if (n > 1) {
+            affirm(*frozen.lower_bound(1) == 3);
+        }
+        affirm(frozen.lower_bound(3 * n) == frozen.end());
+        affirm(std::equal(frozen.begin(), frozen.end(), mySet.begin()));
+    }
+
+    TreeSet<string> words;
+    words.insert("kiwi");
+    words.insert("fig");
+    FrozenSet<string> frozenWords = words.freeze();
+    affirm(frozenWords.exists("fig"));
+    affirm(*frozenWords.lower_bound("grape") == "kiwi");
+
+    return log.summarize();
+}
+
 bool printTest() {
     TestingLogger log("print");
 
@@ -106,7 +507,7 @@ bool starTest() {
 
     TreeSet<char>::iterator iter = mySet.begin();
 
-    affirm(*iter == '2');
+    affirm(*iter == '1');
 
     return log.summarize();
 }
@@ -142,7 +543,7 @@ bool iteratorPlusTest() {
     TreeSet<float>::iterator iter = mySet.begin();
 
     ++iter;
-    float x = 4.1;
+    float x = 4.2;
     affirm(*iter == x);
 
     ++iter;
@@ -152,6 +553,49 @@ bool iteratorPlusTest() {
     return log.summarize();
 }
 
+bool iteratorMinusTest() {
+    TestingLogger log("iterator minus");
+
+    TreeSet<int> mySet(treetype::ROOT);
+    mySet.insert(42);
+    mySet.insert(43);
+    mySet.insert(41);
+
+    TreeSet<int>::iterator iter = mySet.end();
+    --iter;
+    affirm(*iter == 43);
+
+    iter--;
+    affirm(*iter == 42);
+
+    --iter;
+    affirm(iter == mySet.begin());
+
+    return log.summarize();
+}
+
+bool sortedIterationTest() {
+    TestingLogger log("sorted iteration");
+
+    for (treetype t : {treetype::LEAF, treetype::ROOT, treetype::RANDOMIZED,
+                       treetype::TREAP, treetype::WEIGHT_BALANCED,
+                       treetype::SPLAY, treetype::SEMI_SPLAY}) {
+        TreeSet<int> mySet(t, 11);
+        for (int i = 0; i < 200; ++i) {
+            mySet.insert((i * 37) % 200);
+        }
+
+        int expected = 0;
+        for (int value : mySet) {
+            affirm(value == expected);
+            ++expected;
+        }
+        affirm(expected == 200);
+    }
+
+    return log.summarize();
+}
+
 bool treeEqualsTest() {
     TestingLogger log("tree equals");
 
@@ -176,6 +620,33 @@ bool treeEqualsTest() {
     return log.summarize();
 }
 
+bool treeCompareTest() {
+    TestingLogger log("tree compare");
+
+    TreeSet<int> mySetOne(treetype::LEAF);
+    TreeSet<int> mySetTwo(treetype::ROOT);
+
+    affirm(mySetOne.compare(mySetTwo) == 0);
+    affirm(mySetOne <= mySetTwo);
+
+    mySetOne.insert(1);
+    mySetOne.insert(3);
+    mySetTwo.insert(3);
+    mySetTwo.insert(1);
+    affirm(mySetOne.compare(mySetTwo) == 0);
+
+    mySetTwo.insert(2);  // {1, 2, 3} sorts before {1, 3}
+    affirm(mySetTwo < mySetOne);
+    affirm(mySetOne > mySetTwo);
+
+    mySetOne.insert(2);
+    mySetOne.insert(0);  // {0, 1, 2, 3} sorts before {1, 2, 3}
+    affirm(mySetOne.compare(mySetTwo) < 0);
+    affirm(mySetTwo >= mySetOne);
+
+    return log.summarize();
+}
+
 bool heightTest() {
     TestingLogger log("height");
 
@@ -252,6 +723,116 @@ bool rootInsertTest() {
     return log.summarize();
 }
 
+bool treapInsertTest() {
+    TestingLogger log("treap insert");
+
+    // sorted input stays shallow because priorities, not order, pick roots
+    TreeSet<int> mySet(treetype::TREAP, 21);
+    for (int i = 0; i < 2000; ++i) {
+        mySet.insert(i);
+    }
+    affirm(mySet.size() == 2000);
+    affirm(mySet.height() < 40);
+    affirm(*mySet.select(1234) == 1234);
+
+    // a bulk build keeps heap order, so later inserts stay balanced too
+    vector<int> sorted(mySet.begin(), mySet.end());
+    TreeSet<int> built(sorted.begin(), sorted.end(), treetype::TREAP, 4);
+    for (int i = 2000; i < 4000; ++i) {
+        built.insert(i);
+    }
+    affirm(built.size() == 4000);
+    affirm(built.height() < 45);
+
+    return log.summarize();
+}
+
+bool weightBalancedTest() {
+    TestingLogger log("weight balanced");
+
+    // sorted input stays shallow, with no random numbers drawn: height is
+    // at most log base 4/3 of n (26 for 2000 elements)
+    TreeSet<int> mySet(treetype::WEIGHT_BALANCED);
+    for (int i = 0; i < 2000; ++i) {
+        mySet.insert(i);
+    }
+    affirm(mySet.size() == 2000);
+    affirm(mySet.height() <= 26);
+    affirm(mySet.counters().randomDraws == 0);
+    affirm(*mySet.select(1234) == 1234);
+
+    // erasing one side entirely forces rotations back the other way
+    for (int i = 0; i < 1500; ++i) {
+        mySet.erase(i);
+    }
+    affirm(mySet.size() == 500);
+    affirm(mySet.height() <= 21);
+    affirm(*mySet.begin() == 1500);
+
+    // a lopsided split, and a join of very different sizes, stay balanced
+    TreeSet<int> greater(treetype::WEIGHT_BALANCED);
+    mySet.split(1510, greater);
+    affirm(mySet.size() == 10);
+    affirm(greater.size() == 490);
+    affirm(greater.height() <= 21);
+    TreeSet<int> big(treetype::WEIGHT_BALANCED);
+    for (int i = 2000; i < 6000; ++i) {
+        big.insert(i);
+    }
+    mySet.join(big);
+    affirm(mySet.size() == 4010);
+    affirm(mySet.height() <= 28);
+    mySet.setUnion(greater);
+    affirm(mySet.size() == 4500);
+    affirm(mySet.height() <= 29);
+    affirm(mySet.counters().randomDraws == 0);
+
+    return log.summarize();
+}
+
+bool splayTest() {
+    TestingLogger log("splay");
+
+    // each sorted insert is splayed to the root, leaving a path
+    TreeSet<int> mySet(treetype::SPLAY);
+    TreeSet<int> semi(treetype::SEMI_SPLAY);
+    for (int i = 0; i < 1000; ++i) {
+        mySet.insert(i);
+        semi.insert(i);
+    }
+    affirm(mySet.height() == 999);
+    affirm(semi.height() == 999);
+
+    // one deep lookup folds the path roughly in half; semi-splaying does
+    // fewer rotations but still shortens the path
+    affirm(mySet.exists(0));
+    affirm(mySet.height() <= 501);
+    uint64_t fullRotations = mySet.lastOperation().rotations;
+    affirm(semi.exists(0));
+    affirm(semi.height() < 999);
+    affirm(semi.lastOperation().rotations < fullRotations);
+
+    // a hot key ends up at the root, so the next lookup is one step
+    affirm(mySet.exists(0));
+    affirm(mySet.lastOperation().nodesVisited == 1);
+    for (int i = 0; i < 20; ++i) {
+        semi.exists(0);
+    }
+    affirm(semi.lastOperation().nodesVisited <= 2);
+
+    // misses, bounds and select splay too, and sizes stay right throughout
+    affirm(!mySet.exists(5000));
+    affirm(*mySet.lower_bound(500) == 500);
+    affirm(*mySet.select(500) == 500);
+    affirm(mySet.lastOperation().nodesVisited == 1);
+    affirm(mySet.rank(500) == 500);
+    affirm(mySet.erase(500) == 1);
+    affirm(mySet.size() == 999);
+    affirm(*mySet.select(500) == 501);
+
+    return log.summarize();
+}
+
 bool seedCreation() {
     TestingLogger log("seed");
 
@@ -266,17 +847,440 @@ bool seedCreation() {
     return log.summarize();
 }
 
+bool rangeConstructorTest() {
+    TestingLogger log("range constructor");
+
+    // sorted input must not degenerate a LEAF tree into a list
+    vector<int> sorted;
+    for (int i = 0; i < 1023; ++i) {
+        sorted.push_back(i);
+    }
+    TreeSet<int> mySet(sorted.begin(), sorted.end());
+    affirm(mySet.size() == 1023);
+    affirm(mySet.height() == 9);
+    affirm(mySet.exists(0));
+    affirm(mySet.exists(1022));
+
+    // unsorted input with duplicates
+    vector<string> words = {"pear", "apple", "fig", "apple", "kiwi", "fig"};
+    TreeSet<string> wordSet(words.begin(), words.end(), treetype::RANDOMIZED);
+    affirm(wordSet.size() == 4);
+    affirm(*wordSet.begin() == "apple");
+    stringstream ss;
+    ss << wordSet;
+    affirm(ss.str() == "(((-, apple, -), fig, -), kiwi, (-, pear, -))");
+
+    // inserts after a bulk build keep sizes right
+    wordSet.insert("banana");
+    affirm(wordSet.size() == 5);
+
+    return log.summarize();
+}
+
+bool assignTest() {
+    TestingLogger log("assign");
+
+    TreeSet<string> mySet;
+    mySet.insert("old");
+
+    vector<string> words = {"c", "a", "b"};
+    mySet.assign(words.begin(), words.end());
+    affirm(mySet.size() == 3);
+    affirm(!mySet.exists("old"));
+    affirm(mySet.height() == 1);
+
+    mySet.assign(words.begin(), words.begin());
+    affirm(mySet.size() == 0);
+    affirm(mySet.begin() == mySet.end());
+
+    return log.summarize();
+}
+
+bool manyInsertTest() {
+    TestingLogger log("many insert");
+
+    // enough nodes to span several slabs of the node pool
+    TreeSet<string> mySet(treetype::RANDOMIZED, 3);
+    for (int i = 0; i < 5000; ++i) {
+        mySet.insert(to_string(i));
+    }
+
+    affirm(mySet.size() == 5000);
+    affirm(mySet.exists("0"));
+    affirm(mySet.exists("4999"));
+    affirm(!mySet.exists("5000"));
+
+    return log.summarize();
+}
+
 /*
  * Test the TreeSet
  */
+bool comparatorTest() {
+    TestingLogger log("comparator");
+
+    // a reversed order flips iteration, bounds and order statistics
+    for (treetype t : {treetype::LEAF, treetype::ROOT, treetype::RANDOMIZED,
+                       treetype::TREAP, treetype::WEIGHT_BALANCED,
+                       treetype::SPLAY, treetype::SEMI_SPLAY}) {
+        TreeSet<int, std::greater<int>> down(t, 7, std::greater<int>());
+        for (int i = 0; i < 50; ++i) {
+            down.insert((i * 17) % 50);
+        }
+        affirm(!down.insert(25).second);
+        affirm(down.size() == 50);
+        affirm(*down.begin() == 49);
+        affirm(*down.select(49) == 0);
+        affirm(*down.lower_bound(30) == 30);
+        affirm(*down.upper_bound(30) == 29);
+        affirm(down.rank(40) == 9);
+        affirm(down.countBetween(40, 30) == 11);
+        affirm(down.erase(0) == 1);
+        affirm(!down.exists(0));
+        int expected = 49;
+        for (int value : down) {
+            affirm(value == expected);
+            --expected;
+        }
+    }
+
+    // a transparent comparator looks up string keys without a temporary
+    TreeSet<string, std::less<>> names;
+    names.insert("Tejus");
+    names.insert("Mia");
+    const char* key = "Tejus";
+    affirm(names.exists(key));
+    affirm(!names.exists("Zoe"));
+    affirm(*names.lower_bound("N") == "Tejus");
+    affirm(names.upper_bound("Tejus") == names.end());
+
+    // the frozen copy keeps the tree's order
+    TreeSet<int, std::greater<int>> small;
+    small.insert(1);
+    small.insert(3);
+    small.insert(2);
+    FrozenSet<int, std::greater<int>> frozen = small.freeze();
+    affirm(*frozen.begin() == 3);
+    affirm(frozen.exists(2));
+    affirm(*frozen.lower_bound(5) == 3);
+    affirm(frozen.lower_bound(0) == frozen.end());
+
+    return log.summarize();
+}
+
+// A key that counts how often it is copied
+struct Tracked {
+    static int copies;
+    string name;
+
+    explicit Tracked(const char* n) : name(n) { }
+    Tracked(const Tracked& other) : name(other.name) { ++copies; }
+    Tracked(Tracked&& other) noexcept = default;
+    Tracked& operator=(const Tracked& other) {
+        name = other.name;
+        ++copies;
+        return *this;
+    }
+    Tracked& operator=(Tracked&& other) noexcept = default;
+    bool operator<(const Tracked& rhs) const { return name < rhs.name; }
+};
+
+int Tracked::copies = 0;
+
+bool moveInsertTest() {
+    TestingLogger log("move insert");
+
+    for (treetype t : {treetype::LEAF, treetype::ROOT, treetype::RANDOMIZED,
+                       treetype::TREAP, treetype::WEIGHT_BALANCED,
+                       treetype::SPLAY, treetype::SEMI_SPLAY}) {
+        Tracked::copies = 0;
+        TreeSet<Tracked> mySet(t, 3);
+        affirm(mySet.insert(Tracked("kiwi")).second);
+        affirm(mySet.emplace("fig").second);
+        affirm(!mySet.emplace("kiwi").second);
+        affirm(mySet.size() == 2);
+
+        // a duplicate is not moved from
+        Tracked dup("fig");
+        affirm(!mySet.insert(std::move(dup)).second);
+        affirm(dup.name == "fig");
+
+        // elements move between sets through node handles
+        TreeSet<Tracked> other(t, 5);
+        TreeSet<Tracked>::node_type handle = mySet.extract(Tracked("kiwi"));
+        affirm(!handle.empty());
+        affirm(handle.value().name == "kiwi");
+        affirm(mySet.size() == 1);
+        affirm(other.insert(std::move(handle)).second);
+        affirm(handle.empty());
+        affirm(other.exists(Tracked("kiwi")));
+
+        // a handle whose element is already present keeps it
+        other.emplace("fig");
+        handle = mySet.extract(mySet.begin());
+        affirm(mySet.size() == 0);
+        affirm(!other.insert(std::move(handle)).second);
+        affirm(handle && handle.value().name == "fig");
+
+        affirm(mySet.extract(Tracked("pear")).empty());
+        affirm(Tracked::copies == 0);
+    }
+
+    return log.summarize();
+}
+
+bool statisticsTest() {
+    TestingLogger log("statistics");
+
+    TreeSet<int> empty;
+    TreeStatistics none = empty.statistics();
+    affirm(none.nodes == 0);
+    affirm(none.height == -1);
+    affirm(none.depthCounts.empty());
+
+    TreeSet<int> bushy;
+    for (int i : {4, 2, 6, 1, 3, 5, 7}) {
+        bushy.insert(i);
+    }
+    TreeStatistics full = bushy.statistics();
+    affirm(full.nodes == 7);
+    affirm(full.height == 2);
+    affirm(full.depthCounts == vector<size_t>({1, 2, 4}));
+    affirm(full.averageDepth == 10.0 / 7.0);
+    affirm(full.balance == 1.0);
+
+    // sorted inserts at the leaves make a path
+    TreeSet<int> path;
+    for (int i = 0; i < 7; ++i) {
+        path.insert(i);
+    }
+    TreeStatistics chain = path.statistics();
+    affirm(chain.height == 6);
+    affirm(chain.depthCounts == vector<size_t>(7, 1));
+    affirm(chain.averageDepth == 3.0);
+    affirm(chain.balance == 7.0 / 3.0);
+    affirm(path.height() == 6);
+
+    return log.summarize();
+}
+
+bool instrumentationTest() {
+    TestingLogger log("instrumentation");
+
+    // a LEAF tree built from sorted input is a path, so every count is known
+    TreeSet<int> path;
+    for (int i = 0; i < 10; ++i) {
+        path.insert(i);
+    }
+    affirm(path.counters().allocations == 10);
+    affirm(path.counters().rotations == 0);
+    affirm(path.counters().randomDraws == 0);
+
+    path.resetCounters();
+    affirm(path.exists(9));
+    OperationCounters work = path.lastOperation();
+    affirm(work.nodesVisited == 10);
+    affirm(work.comparisons == 11);  // one per level, one to confirm
+    affirm(path.counters().comparisons == 11);
+
+    // a duplicate insert allocates nothing
+    path.insert(4);
+    affirm(path.lastOperation().allocations == 0);
+
+    // nested calls (erase uses lower_bound) are reported once, as erase
+    vector<string> names;
+    path.setLatencyHook([&names](const char* operation, uint64_t,
+                                 const OperationCounters&) {
+        names.push_back(operation);
+    });
+    path.erase(3);
+    path.emplace(3);
+    affirm(names == vector<string>({"erase", "emplace"}));
+    affirm(path.lastOperation().allocations == 1);
+
+    // root insertion rotates; randomized insertion draws numbers
+    TreeSet<int> rooted(treetype::ROOT);
+    rooted.insert(1);
+    rooted.insert(2);
+    affirm(rooted.lastOperation().rotations == 1);
+    TreeSet<int> randomized(treetype::RANDOMIZED, 3);
+    randomized.insert(1);
+    affirm(randomized.lastOperation().randomDraws == 1);
+
+    return log.summarize();
+}
+
+bool batchLookupTest() {
+    TestingLogger log("batch lookup");
+
+    TreeSet<int> empty;
+    vector<int> keys = {5, 1, 9};
+    vector<bool> found;
+    empty.existsBatch(keys.data(), keys.size(), found);
+    affirm(found == vector<bool>({false, false, false}));
+
+    // more keys than lanes, unsorted, with repeats and misses
+    TreeSet<int> evens(treetype::RANDOMIZED, 3);
+    for (int i = 0; i < 100; i += 2) {
+        evens.insert(i);
+    }
+    keys.clear();
+    for (int i = 0; i < 60; ++i) {
+        keys.push_back((i * 37) % 103 - 1);
+    }
+    keys.push_back(keys.front());
+    evens.existsBatch(keys.data(), keys.size(), found);
+    vector<TreeSet<int>::iterator> bounds;
+    evens.lowerBoundBatch(keys.data(), keys.size(), bounds);
+    affirm(found.size() == keys.size());
+    affirm(bounds.size() == keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+        affirm(found[i] == evens.exists(keys[i]));
+        affirm(bounds[i] == evens.lower_bound(keys[i]));
+    }
+
+    // a batch visits exactly the nodes the single searches would
+    evens.resetCounters();
+    for (int key : keys) {
+        evens.lower_bound(key);
+    }
+    uint64_t visits = evens.counters().nodesVisited;
+    evens.resetCounters();
+    evens.lowerBoundBatch(keys.data(), keys.size(), bounds);
+    affirm(evens.counters().nodesVisited == visits);
+
+    // a sorted batch gets the same answers, walking shared prefixes once
+    TreeSet<int> many(treetype::WEIGHT_BALANCED);
+    for (int i = 0; i < 4000; i += 2) {
+        many.insert(i);
+    }
+    keys.clear();
+    for (int i = -5; i < 4005; i += 3) {
+        keys.push_back(i);
+        keys.push_back(i);
+    }
+    many.resetCounters();
+    for (int key : keys) {
+        many.lower_bound(key);
+    }
+    visits = many.counters().nodesVisited;
+    many.resetCounters();
+    many.lowerBoundBatch(keys.data(), keys.size(), bounds);
+    affirm(many.counters().nodesVisited * 4 < visits);
+    many.existsBatch(keys.data(), keys.size(), found);
+    for (size_t i = 0; i < keys.size(); ++i) {
+        affirm(found[i] == many.exists(keys[i]));
+        affirm(bounds[i] == many.lower_bound(keys[i]));
+    }
+
+    return log.summarize();
+}
+
+bool deepTreeTest() {
+    TestingLogger log("deep tree");
+
+    // sorted inserts at the root leave a path as deep as the set is big,
+    // far deeper than the call stack would allow a recursive walk to go
+    const int n = 200000;
+    TreeSet<int> path(treetype::ROOT);
+    for (int i = 0; i < n; ++i) {
+        path.insert(i);
+    }
+    affirm(path.height() == n - 1);
+
+    std::stringstream ss;
+    path.print(ss);
+    affirm(ss.str().size() > size_t(n));
+
+    TreeSet<int> ends;
+    ends.insert(-1);
+    ends.insert(n);
+    path.setUnion(ends);
+    affirm(path.size() == size_t(n) + 2);
+
+    TreeSet<int> greater;
+    path.split(n / 2, greater);
+    affirm(path.size() == size_t(n) / 2 + 1);
+    affirm(greater.size() == size_t(n) / 2 + 1);
+    path.join(greater);
+    affirm(path.size() == size_t(n) + 2);
+    affirm(path.exists(n / 2));
+
+    return log.summarize();
+}
+
+bool hintedInsertTest() {
+    TestingLogger log("hinted insert");
+
+    for (treetype t : {treetype::LEAF, treetype::ROOT, treetype::RANDOMIZED,
+                       treetype::TREAP, treetype::WEIGHT_BALANCED,
+                       treetype::SPLAY, treetype::SEMI_SPLAY}) {
+        TreeSet<int> mySet(t, 5);
+        vector<int> sorted;
+        for (int i = 0; i < 2000; ++i) {
+            sorted.push_back(i * 2);
+        }
+
+        // each element is next to the last, so it takes a few comparisons
+        // at most (a RANDOMIZED insert sometimes descends from higher up)
+        mySet.resetCounters();
+        mySet.appendSorted(sorted.begin(), sorted.end());
+        affirm(mySet.size() == 2000);
+        affirm(mySet.counters().nodesVisited < 3 * 2000);
+
+        // hints on either side, far away, at end(), and at duplicates
+        auto iter = mySet.insert(mySet.lower_bound(100), 99);
+        affirm(*iter == 99);
+        affirm(*mySet.insert(mySet.lower_bound(100), 101) == 101);
+        affirm(*mySet.insert(mySet.begin(), 3001) == 3001);
+        affirm(*mySet.insert(mySet.end(), -1) == -1);
+        affirm(*mySet.insert(mySet.lower_bound(50), 50) == 50);
+        affirm(*mySet.insert(mySet.begin(), 3000) == 3000);
+        affirm(mySet.size() == 2004);
+
+        int previous = -2;
+        for (int value : mySet) {
+            affirm(previous < value);
+            previous = value;
+        }
+        affirm(mySet.rank(100) == 52);
+    }
+
+    // sorted hinted inserts leave the balanced types balanced
+    for (treetype t : {treetype::RANDOMIZED, treetype::TREAP,
+                       treetype::WEIGHT_BALANCED}) {
+        TreeSet<int> mySet(t, 7);
+        vector<int> sorted;
+        for (int i = 0; i < 20000; ++i) {
+            sorted.push_back(i);
+        }
+        mySet.appendSorted(sorted.begin(), sorted.end());
+        affirm(mySet.height() < 60);
+    }
+
+    return log.summarize();
+}
+
 int main(int, char**) {
     TestingLogger alltests("All tests");
 
 
     affirm(insertTest());
 
+    affirm(insertResultTest());
+
     affirm(existsTest());
 
+    affirm(eraseTest());
+
+    affirm(eraseIteratorTest());
+
+    affirm(splitJoinTest());
+
+    affirm(setAlgebraTest());
+
+    affirm(setAlgebraPoolTest());
+
     affirm(beginTest());
 
     affirm(endTest());
@@ -287,10 +1291,24 @@ int main(int, char**) {
 
     affirm(iteratorPlusTest());
 
+    affirm(iteratorMinusTest());
+
+    affirm(sortedIterationTest());
+
+    affirm(orderStatisticsTest());
+
+    affirm(boundsTest());
+
+    affirm(rangeTest());
+
+    affirm(freezeTest());
+
     affirm(printTest());
 
     affirm(treeEqualsTest());
 
+    affirm(treeCompareTest());
+
     affirm(heightTest());
 
     affirm(depthTest());
@@ -301,8 +1319,34 @@ int main(int, char**) {
 
     affirm(rootInsertTest());
 
+    affirm(treapInsertTest());
+
+    affirm(weightBalancedTest());
+
+    affirm(splayTest());
+
     affirm(seedCreation());
 
+    affirm(manyInsertTest());
+
+    affirm(rangeConstructorTest());
+
+    affirm(assignTest());
+
+    affirm(comparatorTest());
+
+    affirm(moveInsertTest());
+
+    affirm(statisticsTest());
+
+    affirm(instrumentationTest());
+
+    affirm(deepTreeTest());
+
+    affirm(batchLookupTest());
+
+    affirm(hintedInsertTest());
+
     if (alltests.summarize(true)) {
         return 0;  // Error code of 0 == Success!
     } else {
@@ -4,26 +4,122 @@
 
 #include <cs70/randuint32.hpp>
 #include <cstddef>
-#include <queue>
+#include <cstdint>
+#include <functional>
+#include <iterator>
 #include <iostream>
+#include <type_traits>
 #include <utility>
 #include <string>
+#include <memory>
+#include <unordered_set>
+#include <optional>
+#include <vector>
+
+#include "frozenset.hpp"
+
+#ifdef TREESET_INSTRUMENT
+#include <chrono>
+#endif
 
 using namespace std;
 
-enum treetype { LEAF, ROOT, RANDOMIZED };
+// Define TREESET_INSTRUMENT before including this header to have every
+// TreeSet count the work its operations do. Without it the counting
+// statements below expand to nothing and TreeSet carries no counters.
+#ifdef TREESET_INSTRUMENT
+#define TREESET_COUNT(counter) (++counters_.counter)
+#define TREESET_OPERATION(name) OperationScope operationScope(this, name)
+#else
+#define TREESET_COUNT(counter) ((void)0)
+#define TREESET_OPERATION(name) ((void)0)
+#endif
+
+// SPLAY trees move every node that an insert, exists, bound or select
+// reaches up to the root; SEMI_SPLAY trees move it about halfway, which
+// restructures less per access. Either way lookups change the tree, so a
+// splay tree must not be read from several threads at once. Batch lookups
+// (existsBatch, lowerBoundBatch) leave the tree as it is.
+enum treetype { LEAF, ROOT, RANDOMIZED, TREAP, WEIGHT_BALANCED, SPLAY,
+                SEMI_SPLAY };
+
+/**
+* \brief Shape of a Tree, gathered in one walk by TreeSet::statistics()
+**/
+struct TreeStatistics {
+    size_t nodes = 0;  // number of elements
+    int height = -1;  // depth of the deepest node, -1 when empty
+    double averageDepth = 0.0;  // mean depth over every node
+    std::vector<size_t> depthCounts;  // depthCounts[d]: nodes at depth d
+    // levels used over the fewest levels that could hold nodes; 1.0 is
+    // perfectly balanced, and a degenerate tree approaches nodes / log n
+    double balance = 1.0;
+};
+
+/**
+* \brief Work done by TreeSet operations (counted under TREESET_INSTRUMENT)
+**/
+struct OperationCounters {
+    uint64_t comparisons = 0;  // calls to the comparator
+    uint64_t nodesVisited = 0;  // nodes looked at while descending
+    uint64_t rotations = 0;  // single rotations
+    uint64_t randomDraws = 0;  // random numbers drawn
+    uint64_t allocations = 0;  // Nodes taken from the pool
+
+    OperationCounters operator-(const OperationCounters& start) const {
+        OperationCounters delta;
+        delta.comparisons = comparisons - start.comparisons;
+        delta.nodesVisited = nodesVisited - start.nodesVisited;
+        delta.rotations = rotations - start.rotations;
+        delta.randomDraws = randomDraws - start.randomDraws;
+        delta.allocations = allocations - start.allocations;
+        return delta;
+    }
+};
 
-template <typename T>
+/**
+* \brief Sorted set of T, ordered by a strict weak ordering Compare
+*
+* Compare defaults to std::less<T>. With a transparent comparator such as
+* std::less<> (e.g. TreeSet<string, less<>>), lookups accept any key type
+* the comparator can order against T, such as string_view or const char*,
+* without building a temporary T.
+**/
+template <typename T, typename Compare = std::less<T>>
 class TreeSet {
  private:
-    // Forward declaration of private class.
+    // Forward declaration of private classes.
     class Iterator;
+    class Range;
+    class NodeHandle;
 
  public:
+    // allow users to iterate through Tree
+    using iterator = Iterator;
+    // a window of the Tree that can be used in a range-based for loop
+    using range_view = Range;
+    // an element taken out of a Tree, ready to go into another
+    using node_type = NodeHandle;
+
     TreeSet();
     ~TreeSet();
     TreeSet(treetype t);
     TreeSet(treetype t, size_t s);
+    TreeSet(treetype t, size_t s, const Compare& comp);
+
+    /**
+    * \brief Build a perfectly balanced Tree from a range of elements
+    * \param first, last range to copy, treetype and seed for later inserts,
+    *        comparator that orders the elements
+    *
+    * Runs in linear time when the range is already sorted; otherwise the
+    * elements are sorted first. Duplicates are dropped.
+    **/
+    template <typename InputIt, typename = typename
+              std::iterator_traits<InputIt>::iterator_category>
+    TreeSet(InputIt first, InputIt last, treetype t = treetype::LEAF,
+            size_t s = 0, const Compare& comp = Compare());
+
     TreeSet(const TreeSet& orig) = delete;
     TreeSet& operator=(const TreeSet& rhs) = delete;
 
@@ -36,11 +132,147 @@ class TreeSet {
     size_t size() const;
 
     /**
-    * \brief Insert element into current Tree
+    * \brief Insert element into current Tree unless already present
     * \param T to insert
+    * \returns iterator to the element, and whether it was inserted
+    **/
+    pair<iterator, bool> insert(const T &t);
+
+    /**
+    * \brief Insert element, moving it into the new node
+    * \param T to insert; left untouched if it is already present
+    * \returns iterator to the element, and whether it was inserted
+    **/
+    pair<iterator, bool> insert(T&& t);
+
+    /**
+    * \brief Insert an element taken out of a Tree by extract()
+    * \param handle to insert from; it keeps its element if not inserted
+    * \returns iterator to the element, and whether it was inserted
+    **/
+    pair<iterator, bool> insert(node_type&& handle);
+
+    /**
+    * \brief Insert element, searching outward from a nearby position
+    * \param hint iterator near where T belongs (end() is fine), T to add
+    * \returns iterator to the element, new or already present
+    *
+    * The search climbs from the hint only past the elements T lies beyond,
+    * then descends from there, so a T next to the hint costs O(1)
+    * comparisons. The node still goes where insert(t) would put it, and
+    * the sizes on its path to the root are updated, so the time is that
+    * of insert(t) less the comparisons: O(log n) expected for RANDOMIZED
+    * and TREAP, O(log n) for WEIGHT_BALANCED, O(log n) amortized for
+    * SPLAY and SEMI_SPLAY, and O(depth) for LEAF and ROOT. Appending in
+    * sorted order is O(1) amortized for ROOT, SPLAY and SEMI_SPLAY, whose
+    * largest element is at the root, and O(n) each for LEAF, whose
+    * largest element is at the end of a path of every element.
+    **/
+    iterator insert(iterator hint, const T& t);
+
+    /**
+    * \brief Insert a range that is sorted, or nearly so
+    * \param first, last range to insert; duplicates are dropped
+    * \returns void
+    *
+    * Each element is inserted with the previous one as its hint, so each
+    * costs what insert(hint, t) above says: O(log n) for the balanced
+    * treetypes, O(1) amortized for ROOT and the splay types, O(n) for LEAF.
+    **/
+    template <typename InputIt>
+    void appendSorted(InputIt first, InputIt last);
+
+    /**
+    * \brief Construct an element directly in a new node and insert it
+    * \param arguments for T's constructor
+    * \returns iterator to the element, and whether it was inserted
+    *
+    * The node is built before the search, since the key is needed to
+    * find its place; it is given back if the key is already present.
+    **/
+    template <typename... Args>
+    pair<iterator, bool> emplace(Args&&... args);
+
+    /**
+    * \brief Take an element out of the Tree without copying it
+    * \param T to remove
+    * \returns handle owning the element, empty if T was not present
+    **/
+    node_type extract(const T& t);
+
+    /**
+    * \brief Take the element at pos out of the Tree without copying it
+    * \param iterator to an element of this Tree (not end())
+    * \returns handle owning the element
+    **/
+    node_type extract(iterator pos);
+
+    /**
+    * \brief Remove element from current Tree if present
+    * \param T to remove
+    * \returns number of elements removed (0 or 1)
+    **/
+    size_t erase(const T& t);
+
+    /**
+    * \brief Remove the element an iterator refers to
+    * \param iterator to a valid element (not end())
+    * \returns iterator to the element after the removed one
+    **/
+    iterator erase(iterator pos);
+
+    /**
+    * \brief Split Tree at a key
+    * \param T to split at, Tree that receives the elements not less than T
+    * \returns void; *this keeps only the elements less than T
+    *
+    * Any previous contents of greater are discarded. O(height), unless
+    * greater has another treetype: then its part is rebuilt, in O(n).
+    **/
+    void split(const T& t, TreeSet& greater);
+
+    /**
+    * \brief Append a Tree whose elements are all greater than ours
+    * \param Tree to move from; it is left empty
+    * \returns void
+    *
+    * Falls back to setUnion if the two key ranges overlap. A right Tree
+    * of another treetype is rebuilt to suit ours first, in O(n).
+    **/
+    void join(TreeSet& right);
+
+    /**
+    * \brief Make Tree the union of itself and another Tree
+    * \param Tree to move elements from; it is left empty
+    * \returns void
+    *
+    * For RANDOMIZED and TREAP trees of sizes m <= n this takes
+    * O(m log(n/m + 1)) expected time, plus the cost of freeing any
+    * discarded duplicates.
+    **/
+    void setUnion(TreeSet& other);
+
+    /**
+    * \brief Keep only the elements that are also in another Tree
+    * \param Tree to intersect with; it is left empty
+    * \returns void
+    **/
+    void setIntersection(TreeSet& other);
+
+    /**
+    * \brief Remove every element that is also in another Tree
+    * \param Tree to subtract; it is left empty
+    * \returns void
+    **/
+    void setDifference(TreeSet& other);
+
+    /**
+    * \brief Replace the contents of Tree with a balanced build of a range
+    * \param first, last range to copy
     * \returns void
     **/
-    void insert(const T &t);
+    template <typename InputIt>
+    void assign(InputIt first, InputIt last);
 
     /**
     * \brief Check whether T exists in Tree
@@ -49,6 +281,113 @@ class TreeSet {
     **/
     bool exists(const T &t) const;
 
+    /**
+    * \brief Check whether an element equivalent to key exists in Tree
+    * \param key of any type Compare can order against T
+    * \returns boolean whether element exists or not
+    *
+    * Only available when Compare is transparent (has is_transparent).
+    **/
+    template <typename K, typename C = Compare,
+              typename = typename C::is_transparent>
+    bool exists(const K& key) const;
+
+    /**
+    * \brief Check a whole batch of keys, running the searches in lockstep
+    * \param keys and count of keys to check, found to receive one bit each
+    * \returns void; found[i] is whether keys[i] exists
+    *
+    * Several descents advance a level at a time in turn, each prefetching
+    * its next node, so their cache misses overlap instead of queueing.
+    * A sorted batch is cut into one run per descent, and each search in a
+    * run resumes from the previous key's path where the two part, so a
+    * shared prefix is walked once; checking for order costs count - 1
+    * comparisons.
+    **/
+    void existsBatch(const T* keys, size_t count, vector<bool>& found) const;
+
+    /**
+    * \brief Find the element with k smaller elements (0-based k-th smallest)
+    * \param k position in sorted order
+    * \returns iterator to that element, or end() if k >= size()
+    **/
+    iterator select(size_t k) const;
+
+    /**
+    * \brief Count the elements that are strictly less than T
+    * \param T to rank
+    * \returns number of elements less than T
+    **/
+    size_t rank(const T& t) const;
+
+    /**
+    * \brief Count the elements in the closed range [lo, hi]
+    * \param lo and hi bounds of the range
+    * \returns number of elements e with lo <= e <= hi
+    **/
+    size_t countBetween(const T& lo, const T& hi) const;
+
+    /**
+    * \brief Find the first element that is not less than T
+    * \param T to search for
+    * \returns iterator to that element, or end() if there is none
+    **/
+    iterator lower_bound(const T& t) const;
+    template <typename K, typename C = Compare,
+              typename = typename C::is_transparent>
+    iterator lower_bound(const K& key) const;
+
+    /**
+    * \brief lower_bound for a whole batch of keys, searched in lockstep
+    * \param keys and count of keys to search for, bounds to receive them
+    * \returns void; bounds[i] is lower_bound(keys[i])
+    *
+    * Sorted batches share path prefixes, as in existsBatch.
+    **/
+    void lowerBoundBatch(const T* keys, size_t count,
+                         vector<iterator>& bounds) const;
+
+    /**
+    * \brief Find the first element that is greater than T
+    * \param T to search for
+    * \returns iterator to that element, or end() if there is none
+    **/
+    iterator upper_bound(const T& t) const;
+    template <typename K, typename C = Compare,
+              typename = typename C::is_transparent>
+    iterator upper_bound(const K& key) const;
+
+    /**
+    * \brief Find the elements equal to T
+    * \param T to search for
+    * \returns lower_bound(t) and upper_bound(t)
+    **/
+    pair<iterator, iterator> equal_range(const T& t) const;
+
+    /**
+    * \brief View of the elements in the closed range [lo, hi]
+    * \param lo and hi bounds of the range
+    * \returns range_view that visits only the elements in the window
+    **/
+    range_view range(const T& lo, const T& hi) const;
+
+    /**
+    * \brief Copy Tree into an immutable, cache-friendly snapshot
+    * \param None
+    * \returns FrozenSet with the same elements, laid out for fast lookups
+    **/
+    FrozenSet<T, Compare> freeze() const;
+
+    /**
+    * \brief Measure the shape of Tree in a single walk
+    * \param None
+    * \returns node count, height, mean depth, nodes per depth, balance
+    *
+    * The walk follows parent links, so it needs no stack or recursion
+    * even on a degenerate Tree; only the histogram grows with height.
+    **/
+    TreeStatistics statistics() const;
+
     /**
     * \brief Calculate height of Tree
     * \param None
@@ -77,6 +416,15 @@ class TreeSet {
     **/
     ostream& printSizes(ostream& os) const;
 
+    /**
+    * \brief Bytes held by the node pool, including free slots
+    * \param None
+    * \returns slots in every slab the pool holds times the node size
+    *
+    * Slabs shared with another Tree after a split count in both.
+    **/
+    size_t bytesUsed() const;
+
     /**
     * \brief Calculate and print out statistics for a Tree
     * \param os stream to print to
@@ -84,130 +432,672 @@ class TreeSet {
     **/
     ostream& showStatistics(ostream& os) const;
 
-    // allow users to iterate through Tree
-    using iterator = Iterator;
-    // An iterator that refers to the first node
+    // An iterator that refers to the smallest element
     iterator begin() const;
-    // An iterator that refers to node just after last node
+    // An iterator that refers to just past the largest element
     iterator end() const;
 
+    /**
+    * \brief Compare two Trees lexicographically by their sorted elements
+    * \param rhs Tree to compare against
+    * \returns negative, zero or positive as *this is less, equal or greater
+    **/
+    int compare(const TreeSet& rhs) const;
+
     // operators
     bool operator==(const TreeSet& rhs) const;
     bool operator!=(const TreeSet& rhs) const;
+    bool operator<(const TreeSet& rhs) const;
+    bool operator<=(const TreeSet& rhs) const;
+    bool operator>(const TreeSet& rhs) const;
+    bool operator>=(const TreeSet& rhs) const;
+
+#ifdef TREESET_INSTRUMENT
+    // called after each public operation with its name, wall time in
+    // nanoseconds, and the work it did
+    using LatencyHook = std::function<void(const char* operation,
+                                           uint64_t nanoseconds,
+                                           const OperationCounters& work)>;
+
+    /**
+    * \brief Work done by every operation since construction or reset
+    * \param None
+    * \returns running totals
+    **/
+    const OperationCounters& counters() const;
+
+    /**
+    * \brief Work done by the most recent public operation
+    * \param None
+    * \returns that operation's counts
+    **/
+    const OperationCounters& lastOperation() const;
+
+    /**
+    * \brief Set every counter back to zero
+    * \param None
+    * \returns void
+    **/
+    void resetCounters();
+
+    /**
+    * \brief Install a callback to feed latency histograms
+    * \param hook to call after each operation (empty to remove it)
+    * \returns void
+    *
+    * The clock is only read while a hook is installed.
+    **/
+    void setLatencyHook(LatencyHook hook);
+#endif
 
-    // friend std::ostream& operator<<(std::ostream& os, const TreeSet<T>& c);
 
  private:
     struct Node {
         T value_;  // T value at node
+        // heap priority, only used by TREAP trees; placed here it fills the
+        // padding after a 4-byte T instead of adding 8 bytes to every node
+        uint32_t priority_;
         Node* leftChild_;  // left Tree of node
         Node* rightChild_;  // right Tree of node
+        Node* parent_;  // node above this one, nullptr at the root
         size_t size_;  // size of subtree with Node as root
 
-        Node(T t);
+        template <typename... Args>
+        explicit Node(Args&&... args);
         Node() = delete;
         Node(const Node&) = delete;
         Node& operator=(const Node&) = delete;
         ~Node() = default;
     };
 
-    Node* root_;  // root node of Tree
+    static_assert(!std::is_same<T, int>::value ||
+                  sizeof(Node) == 2 * sizeof(uint32_t) + 3 * sizeof(Node*) +
+                                  sizeof(size_t),
+                  "TreeSet<int> nodes should have no padding");
+
+    /**
+    * \brief Hands out Nodes carved from large contiguous slabs
+    *
+    * Freed Nodes go on a free list for reuse; slabs themselves are only
+    * returned to the heap, all at once, when the pool is destroyed.
+    * Slabs are shared, so Nodes can move to another Tree whose pool has
+    * adopted the slabs they live in.
+    **/
+    class NodePool {
+     public:
+        NodePool();
+        ~NodePool();
+        NodePool(const NodePool&) = delete;
+        NodePool& operator=(const NodePool&) = delete;
+
+        /**
+        * \brief Construct a new Node holding T(args...)
+        * \param arguments for T's constructor
+        * \returns pointer to the new Node
+        **/
+        template <typename... Args>
+        Node* allocate(Args&&... args);
+
+        /**
+        * \brief Destroy a Node and put its slot on the free list
+        * \param Node to give back
+        * \returns void
+        **/
+        void deallocate(Node* node);
+
+        /**
+        * \brief Give every slab back to the heap without running destructors
+        * \param None
+        * \returns void
+        **/
+        void release();
+
+        /**
+        * \brief Share ownership of another pool's slabs
+        * \param pool whose Nodes are about to move into our Tree
+        * \returns void
+        **/
+        void adopt(const NodePool& other);
+
+        /**
+        * \brief Make sure the next count allocations need no new slab
+        * \param count of Nodes about to be allocated
+        * \returns void
+        **/
+        void reserve(size_t count);
+
+        /**
+        * \brief Count the slots in every slab we hold, free or not
+        * \param None
+        * \returns number of slots
+        **/
+        size_t capacity() const;
+
+        /**
+        * \brief Exchange slabs and free slots with another pool
+        * \param pool to swap with
+        * \returns void
+        **/
+        void swap(NodePool& other);
+
+     private:
+        // A slot either holds a live Node or links to the next free slot
+        union Slot {
+            Slot* next_;
+            alignas(Node) unsigned char storage_[sizeof(Node)];
+        };
+
+        // A slab and the number of slots in it
+        struct Slab {
+            std::shared_ptr<Slot[]> slots_;
+            size_t size_;
+        };
+
+        static constexpr size_t FIRST_SLAB_SIZE = 32;
+        static constexpr size_t MAX_SLAB_SIZE = 65536;
+
+        /**
+        * \brief Allocate a slab and make it the one we carve from
+        * \param number of slots in it
+        * \returns void
+        **/
+        void addSlab(size_t slots);
+
+        std::vector<Slab> slabs_;  // every slab we own
+        std::unordered_set<const Slot*> owned_;  // slabs_, for adopt()
+        size_t capacity_;  // slots in all of slabs_
+        Slot* current_;  // newest slab we allocated, the one we carve from
+        Slot* freeList_;  // slots given back through deallocate
+        size_t used_;  // slots handed out from the newest slab
+        size_t slabSize_;  // number of slots in the newest slab
+    };
+
+    mutable Node* root_;  // root node of Tree; splay lookups move it
     treetype type_;
     RandUInt32 rand_;
+    uint64_t priorityState_;  // state for TREAP priorities
+    Compare comp_;  // orders elements; the only comparison we ever make
+    NodePool pool_;  // storage for every Node in the Tree
+#ifdef TREESET_INSTRUMENT
+    mutable OperationCounters counters_;  // totals, bumped by TREESET_COUNT
+    mutable OperationCounters lastOperation_;  // newest operation's work
+    mutable unsigned operationDepth_ = 0;  // public calls now in progress
+    LatencyHook latencyHook_;  // optional per-operation callback
+
+    /**
+    * \brief Records the work of one public operation, from construction
+    *        until destruction; nested operations fold into the outer one
+    **/
+    class OperationScope {
+     public:
+        OperationScope(const TreeSet* tree, const char* name);
+        ~OperationScope();
+        OperationScope(const OperationScope&) = delete;
+        OperationScope& operator=(const OperationScope&) = delete;
+
+     private:
+        const TreeSet* tree_;  // Tree whose counters we watch
+        const char* name_;  // operation name passed to the hook
+        OperationCounters start_;  // totals when the operation began
+        std::chrono::steady_clock::time_point began_;  // if a hook is set
+    };
+#endif
+
+    /**
+    * \brief Compare two keys with comp_, counting the call
+    * \param lhs and rhs to compare
+    * \returns whether lhs is ordered before rhs
+    **/
+    template <typename A, typename B>
+    bool precedes(const A& lhs, const B& rhs) const;
 
     /**
     * \brief Rotate tree right at root
     * \param root to rotate on
     * \returns void
     **/
-    void rotateRight(Node*& root);
+    void rotateRight(Node*& root) const;
 
     /**
     * \brief Rotate tree left at root
     * \param root to rotate on
     * \returns void
     **/
-    void rotateLeft(Node*& root);
+    void rotateLeft(Node*& root) const;
+
+    /**
+    * \brief Rotate a node above its parent
+    * \param node that has a parent
+    * \returns void
+    **/
+    void rotateUp(Node* node) const;
+
+    /**
+    * \brief Splay a node towards the root in SPLAY and SEMI_SPLAY trees
+    * \param node just accessed (nullptr, or any other treetype, does nothing)
+    * \returns void
+    *
+    * Lookups are const but still splay, which is why root_ is mutable.
+    **/
+    void splay(Node* node) const;
 
     /**
     * \brief Reset size of node
     * \param Node to set size of
     * \returns size of Tree
     **/
-    void setNodeSize(Node*& cur);
+    void setNodeSize(Node*& cur) const;
+
+    /**
+    * \brief Size of a possibly empty subtree
+    * \param root of the subtree
+    * \returns its size_, or 0 for nullptr
+    **/
+    static size_t sizeOf(const Node* cur);
+
+    /**
+    * \brief Count elements below T using subtree sizes
+    * \param T to compare with, whether elements equal to T also count
+    * \returns number of elements < T (or <= T if inclusive)
+    **/
+    size_t countBelow(const T& t, bool inclusive) const;
+
+    /**
+    * \brief Find the smallest node of a subtree
+    * \param root of the subtree (must not be nullptr)
+    * \returns leftmost node
+    **/
+    static Node* leftmost(Node* cur);
+
+    /**
+    * \brief Find the largest node of a subtree
+    * \param root of the subtree (must not be nullptr)
+    * \returns rightmost node
+    **/
+    static Node* rightmost(Node* cur);
 
 
     /**
     * \brief Insert element at leaf of given Tree
-    * \param Tree to push into, T to add
-    * \returns void
+    * \param Tree to push into, its parent, T to add, the last node the
+    *        descent went left at (the only one that can equal T), and
+    *        make, called once to build the new node when T is absent
+    * \returns inserted (or matching) Node, whether it was inserted
     **/
-    void insertAtLeaf(Node*& Tree, const T &t);
+    template <typename Make>
+    pair<Node*, bool> insertAtLeaf(Node*& tree, Node* parent, const T& t,
+                                   Node* candidate, Make& make);
 
     /**
     * \brief Insert element at random in given tree
-    * \param Tree to push into, T to add
-    * \returns void
+    * \param Tree to push into, its parent, T to add, the last node the
+    *        descent went left at (the only one that can equal T), and
+    *        make, called once to build the new node when T is absent
+    * \returns inserted (or matching) Node, whether it was inserted
     **/
-    void insertAtRandom(Node*& tree, const T& t);
+    template <typename Make>
+    pair<Node*, bool> insertAtRandom(Node*& tree, Node* parent, const T& t,
+                                     Node* candidate, Make& make);
 
     /**
     * \brief Insert element at root of given Tree
-    * \param Tree to push into, T to add
+    * \param Tree to push into, its parent, T to add, the last node the
+    *        descent went left at (the only one that can equal T), and
+    *        make, called once to build the new node when T is absent
+    * \returns inserted (or matching) Node, whether it was inserted
+    **/
+    template <typename Make>
+    pair<Node*, bool> insertAtRoot(Node*& tree, Node* parent, const T& t,
+                                   Node* candidate, Make& make);
+
+    /**
+    * \brief Insert using the helper for this Tree's treetype
+    * \param Tree to search (root_ or one found by fingerSearch), its
+    *        parent, T to add, make to build its node if T is absent
+    * \returns inserted (or matching) Node, whether it was inserted
+    **/
+    template <typename Make>
+    pair<Node*, bool> insertWith(Node*& tree, Node* parent, const T& t,
+                                 Make& make);
+
+    /**
+    * \brief Find the smallest subtree near a hint that T belongs in
+    * \param hint node to start from, T to place, output for the
+    *        subtree's parent
+    * \returns link holding that subtree, or the node equal to T
+    **/
+    Node*& fingerSearch(Node* hint, const T& t, Node*& parent) const;
+
+    /**
+    * \brief Find the link that points at a node
+    * \param node in the Tree
+    * \returns reference to root_ or to the parent's child pointer
+    **/
+    Node*& linkTo(Node* node) const;
+
+    /**
+    * \brief Unlink a node from the Tree, fix sizes, and free it
+    * \param node to remove
     * \returns void
     **/
-    void insertAtRoot(Node*& Tree, const T &t);
+    void eraseNode(Node* doomed);
+
+    /**
+    * \brief Unlink a node from the Tree without destroying it
+    * \param node in the Tree
+    * \returns void
+    **/
+    void detachNode(Node* doomed);
+
+    /**
+    * \brief Unlink the smallest node of a subtree, fixing sizes below it
+    * \param root of the subtree, updated if the root itself is removed
+    * \returns the detached node
+    **/
+    Node* detachMin(Node*& tree);
+
+    /**
+    * \brief Join two trees by promoting the successor (LEAF and ROOT)
+    * \param left and right trees, every left value below every right one
+    * \returns root of the joined tree (its parent_ is left to the caller)
+    **/
+    Node* joinBySuccessor(Node* left, Node* right);
+
+    /**
+    * \brief Join two trees, picking each root with size-weighted odds
+    * \param left and right trees, every left value below every right one
+    * \returns root of the joined tree (its parent_ is left to the caller)
+    **/
+    Node* joinRandom(Node* left, Node* right);
+
+    /**
+    * \brief Join two trees, using the strategy for this Tree's treetype
+    * \param left and right trees, every left value below every right one
+    * \returns root of the joined tree (its parent_ is left to the caller)
+    **/
+    Node* joinSubtrees(Node* left, Node* right);
+
+    /**
+    * \brief Join two trees around a single node that sits between them
+    * \param left tree, detached middle node, right tree
+    * \returns root of the joined tree (its parent_ is left to the caller)
+    **/
+    Node* joinWithRoot(Node* left, Node* mid, Node* right);
+
+    /**
+    * \brief Split a tree into the parts less and greater than a key
+    * \param tree to split, key, outputs for the two parts
+    * \returns detached node equal to the key, or nullptr if there is none
+    *
+    * This is the descent insertAtRoot makes, relinking the two sides
+    * directly instead of rotating the key up. WEIGHT_BALANCED trees use
+    * splitByWeight instead, so that both parts stay balanced.
+    **/
+    Node* splitHelper(Node* tree, const T& key, Node*& less, Node*& greater);
+
+    /**
+    * \brief Decide whether a's root should be the root of a combination
+    * \param roots of the two trees being combined (both non-null)
+    * \returns true with probability |a| / (|a| + |b|) for RANDOMIZED trees,
+    *          true if a's priority is higher for TREAP trees
+    **/
+    bool pickFirstRoot(const Node* a, const Node* b);
+
+    // The set operations combineTrees can run
+    enum setop { UNION, INTERSECTION, DIFFERENCE };
+
+    // One pending step of a set operation: its two inputs, the root they
+    // were split around, and the result for each side once it is known
+    struct SetStep {
+        Node* a;  // first input tree
+        Node* b;  // second input tree
+        Node* pivot = nullptr;  // root the inputs were split around
+        Node* match = nullptr;  // node equal to pivot from the other input
+        bool pivotFromA = false;  // whether pivot is a's root
+        Node* lowA = nullptr;  // part of a below pivot
+        Node* lowB = nullptr;  // part of b below pivot
+        Node* highA = nullptr;  // part of a above pivot
+        Node* highB = nullptr;  // part of b above pivot
+        Node* low = nullptr;  // result below pivot
+        Node* high = nullptr;  // result above pivot
+        int stage = 0;  // 0 before splitting, then 1 / 2 solving low / high
+    };
+
+    /**
+    * \brief Union / intersection / difference of two trees, reusing nodes
+    * \param operation, roots of the two trees, which are consumed
+    * \returns root of the result (its parent_ is left to the caller)
+    **/
+    Node* combineTrees(setop op, Node* a, Node* b);
+
+    /**
+    * \brief Split a step's inputs around one root, or finish the step
+    * \param operation, step to split, output for an immediate result
+    * \returns whether the step was finished without splitting
+    **/
+    bool splitStep(setop op, SetStep& step, Node*& result);
+
+    /**
+    * \brief Put a split step back together from its two solved sides
+    * \param operation, step whose low and high results are known
+    * \returns root of the step's result
+    **/
+    Node* joinStep(setop op, SetStep& step);
+
+    /**
+    * \brief Move another Tree's nodes out of it and into this one
+    * \param Tree to empty
+    * \returns root of its nodes, ready to be linked into this Tree
+    *
+    * A Tree no larger than ours is copied into our pool, so its slabs go
+    * when it does; a larger one's slabs are shared instead. The shape of
+    * a Tree of another treetype need not meet our treetype's invariants,
+    * so its nodes are rebuilt into a balanced tree first, at O(n) cost.
+    **/
+    Node* takeNodes(TreeSet& other);
 
     /**
-    * \brief Check whether value exists in current Tree
-    * \param Tree and T to check
-    * \returns whether T is in Tree
+    * \brief Copy a Tree into our pool, keeping its shape and priorities
+    * \param Tree to copy; its values are moved if that cannot throw
+    * \returns root of the copy
     **/
-    bool existsHelper(const Node* Tree, const T& str) const;
+    Node* copyNodes(Node* tree);
+
+    // compactPool copies the Tree once its pool holds more than this many
+    // slots per element, counting a little slack for small Trees
+    static constexpr size_t SPARSE_POOL_FACTOR = 4;
 
     /**
-    * \brief Delete Tree
-    * \param Tree to delete
+    * \brief Copy the Tree into a fresh pool if its slabs are mostly empty
+    * \param None
     * \returns void
     **/
-    void deleteHelper(Node*& Tree);
+    void compactPool();
 
     /**
-    * \brief Print Tree using CS70 rules
-    * \param Tree to print, os stream to print into
-    * \returns ostream&
+    * \brief Destroy Tree and give its slots back to the pool
+    * \param Tree to free
+    * \returns void
     **/
-    ostream& printerHelper(const Node* Tree, ostream& os) const;
+    void releaseHelper(Node* tree);
 
     /**
-    * \brief Print Tree sizes helper using recursion
-    * \param os stream to print into
-    * \returns ostream&
+    * \brief Insert element at a leaf, then rotate it up to heap order
+    * \param Tree to push into, its parent, T to add, the last node the
+    *        descent went left at (the only one that can equal T), and
+    *        make, called once to build the new node when T is absent
+    * \returns inserted (or matching) Node, whether it was inserted
     **/
-    ostream& printSizesHelper(ostream& os, Node*& cur) const;
+    template <typename Make>
+    pair<Node*, bool> insertAtTreap(Node*& tree, Node* parent, const T& t,
+                                    Node* candidate, Make& make);
 
     /**
-    * \brief Calculate average depth of Tree
-    * \param Node position, current height
-    * \returns Average depth of Tree
+    * \brief Draw a random priority for a new TREAP node
+    * \param None
+    * \returns next value of a splitmix64 generator
     **/
-    double depthHelper(const Node* cur, double& h) const;
+    uint32_t nextPriority();
 
     /**
-    * \brief Calculate height of Tree
-    * \param current node
-    * \returns height of Tree
+    * \brief Give a balanced TREAP tree random, heap-ordered priorities
+    * \param root of the tree
+    * \returns void
+    **/
+    void assignHeapPriorities(Node* tree);
+
+    /**
+    * \brief Join two treaps, keeping the higher priority on top
+    * \param left and right trees, every left value below every right one
+    * \returns root of the joined tree (its parent_ is left to the caller)
+    **/
+    Node* joinByPriority(Node* left, Node* right);
+
+    // WEIGHT_BALANCED trees keep, at every node, each child's weight (size
+    // + 1) within WEIGHT_DELTA times the other's; a fix rotates twice when
+    // the inner grandchild weighs at least WEIGHT_GAMMA times the outer
+    // one. These are the integer parameters (3, 2) for which one pass of
+    // single and double rotations restores balance after an insert or
+    // erase, and they bound the height by log base 4/3 of n.
+    static constexpr size_t WEIGHT_DELTA = 3;
+    static constexpr size_t WEIGHT_GAMMA = 2;
+
+    /**
+    * \brief Insert element at a leaf, then restore weight balance on the
+    *        way up to root_
+    * \param Tree to push into, its parent, T to add, the last node the
+    *        descent went left at (the only one that can equal T), and
+    *        make, called once to build the new node when T is absent
+    * \returns inserted (or matching) Node, whether it was inserted
+    **/
+    template <typename Make>
+    pair<Node*, bool> insertAtWeight(Node*& tree, Node* parent, const T& t,
+                                     Node* candidate, Make& make);
+
+    /**
+    * \brief Fix the size and weight balance of one node
+    * \param link holding the node, whose subtrees are already balanced
+    * \returns root of the subtree afterwards
+    **/
+    Node* rebalanceAt(Node*& link);
+
+    /**
+    * \brief Fix sizes and weight balance from a node up to a tree's root
+    * \param node to start at, link holding the root of its tree
+    * \returns void
+    **/
+    void rebalanceUp(Node* node, Node*& tree);
+
+    /**
+    * \brief Join two weight-balanced trees around a middle node
+    * \param left tree, detached middle node, right tree
+    * \returns root of the joined tree (its parent_ is left to the caller)
+    *
+    * The middle node goes down the heavier tree's inner spine until the
+    * lighter tree balances the subtree there, so only that spine changes.
+    **/
+    Node* joinByWeight(Node* left, Node* mid, Node* right);
+
+    /**
+    * \brief Split a weight-balanced tree, joining the pieces back up
+    * \param tree to split, key, outputs for the two parts
+    * \returns detached node equal to the key, or nullptr if there is none
+    **/
+    Node* splitByWeight(Node* tree, const T& key, Node*& less,
+                        Node*& greater);
+
+    /**
+    * \brief Find the first node not less than key, one comparison a level
+    * \param key to search for (T, or any type a transparent Compare takes)
+    * \returns that node, or nullptr if every element is less
+    **/
+    template <typename K>
+    Node* lowerBoundNode(const K& key) const;
+
+    /**
+    * \brief Find the first node greater than key, one comparison a level
+    * \param key to search for (T, or any type a transparent Compare takes)
+    * \returns that node, or nullptr if no element is greater
+    **/
+    template <typename K>
+    Node* upperBoundNode(const K& key) const;
+
+    // How many searches lowerBoundNodes keeps in flight at once
+    static constexpr size_t BATCH_LANES = 8;
+
+    /**
+    * \brief lowerBoundNode for a batch of keys, interleaving the searches
+    * \param keys and count of keys, nodes to receive one result per key
+    * \returns void
     **/
-    int heightHelper(const Node* current) const;
+    void lowerBoundNodes(const T* keys, size_t count,
+                         vector<Node*>& nodes) const;
+
+    /**
+    * \brief lowerBoundNodes for sorted keys, one run of them per lane,
+    *        each search resuming where the previous one's path parts
+    * \param keys (in order) and count of keys, nodes to receive results
+    * \returns void
+    **/
+    void lowerBoundSorted(const T* keys, size_t count,
+                          vector<Node*>& nodes) const;
+
+    /**
+    * \brief Run Node destructors for Tree (storage belongs to pool_)
+    * \param Tree to delete; its links are scrambled on the way
+    * \returns void
+    **/
+    void deleteHelper(Node* tree);
+
+    /**
+    * \brief Destroy every Node and leave the Tree empty
+    * \param None
+    * \returns void
+    **/
+    void clear();
+
+    /**
+    * \brief Build a balanced subtree from sorted, duplicate-free values
+    * \param values (moved from), half-open range [lo, hi), subtree parent
+    * \returns root of the new subtree
+    **/
+    Node* buildBalanced(std::vector<T>& values, size_t lo, size_t hi,
+                        Node* parent);
+
+    /**
+    * \brief Relink a tree's nodes into a balanced shape, as a bulk build
+    *        of this Tree's treetype would leave them
+    * \param root of the tree (its parent_ is left to the caller)
+    * \returns root of the rebuilt tree
+    **/
+    Node* rebuildBalanced(Node* tree);
+
+    /**
+    * \brief Link a balanced subtree from nodes in sorted order
+    * \param nodes, half-open range [lo, hi), subtree parent
+    * \returns root of the new subtree
+    **/
+    Node* linkBalanced(std::vector<Node*>& nodes, size_t lo, size_t hi,
+                       Node* parent);
+
+    /**
+    * \brief Print Tree using CS70 rules, without recursion
+    * \param Tree to print, os stream to print into, whether to print
+    *        subtree sizes instead of values
+    * \returns ostream&
+    **/
+    ostream& printerHelper(const Node* Tree, ostream& os, bool sizes) const;
 
     bool consistent() const;
 
     class Iterator {
      public:
+        // elements are keys, so they may be read but never modified
         using value_type = T;
-        using reference = value_type&;
-        using pointer = value_type*;
-        using iterator_category = std::forward_iterator_tag;
+        using reference = const value_type&;
+        using pointer = const value_type*;
+        using difference_type = std::ptrdiff_t;
+        using iterator_category = std::bidirectional_iterator_tag;
 
         Iterator() = default;
         Iterator(const Iterator&) = default;
@@ -215,6 +1105,9 @@ class TreeSet {
         ~Iterator() = default;
 
         Iterator& operator++();
+        Iterator operator++(int);
+        Iterator& operator--();
+        Iterator operator--(int);
         reference operator*() const;
         bool operator==(const Iterator& rhs) const;
         bool operator!=(const Iterator& rhs) const;
@@ -222,15 +1115,58 @@ class TreeSet {
 
      private:
         friend class TreeSet;
-        explicit Iterator(Node* current);
+        Iterator(Node* current, const TreeSet* tree);
         // Friends create non-default iterators
-        Node* current_;  // The current list node
-        std::queue<Node*> pending_;
+        Node* current_;  // The current node, nullptr at end()
+        const TreeSet* tree_;  // Tree we walk, so --end() can find the max
+    };
+
+    class Range {
+     public:
+        Range(const Range&) = default;
+        Range& operator=(const Range&) = default;
+        ~Range() = default;
+
+        Iterator begin() const;
+        Iterator end() const;
+        bool empty() const;
+
+     private:
+        friend class TreeSet;
+        Range(Iterator first, Iterator last);
+        Iterator first_;  // first element in the window
+        Iterator last_;  // just past the last element in the window
+    };
+
+    // Nodes live in slabs owned by their Tree's pool, so a handle owns
+    // the element itself; moving it between Trees never copies it.
+    class NodeHandle {
+     public:
+        NodeHandle() = default;
+        NodeHandle(NodeHandle&&) = default;
+        NodeHandle& operator=(NodeHandle&&) = default;
+        NodeHandle(const NodeHandle&) = delete;
+        NodeHandle& operator=(const NodeHandle&) = delete;
+        ~NodeHandle() = default;
+
+        bool empty() const;
+        explicit operator bool() const;
+        // the element, which may be changed before it is inserted again
+        T& value();
+        const T& value() const;
+
+     private:
+        friend class TreeSet;
+        // CompactTreeSet hands out the same handles
+        template <typename, typename> friend class CompactTreeSet;
+        explicit NodeHandle(T&& val);
+        std::optional<T> value_;  // the element, if the handle has one
     };
 };
 
-template <typename T>
-typename std::ostream& operator<<(std::ostream& os, const TreeSet<T>& c);
+template <typename T, typename Compare>
+typename std::ostream& operator<<(std::ostream& os,
+                                  const TreeSet<T, Compare>& c);
 
 #endif  // TreeSET_HPP_INCLUDED
 